@@ -0,0 +1,852 @@
+/*
+ *  PaperFrame
+ *  Batch converter of photos to uploads, with the rules of the web page, and push to a frame or a simulator
+ *  ./paperframe_convert -o frames/ photos/
+ *  ./paperframe_convert --push 192.168.4.1 photos/
+ *  ./paperframe_convert --serve 8081 photos/
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <jpeglib.h>
+#include <png.h>
+#include <zlib.h>
+
+#include "display_config.h"
+#include "http_client.h"
+
+// Upload format, see frame_upload.h, for the panel of the build
+#define PLANE_SIZE              FRAMEBUFFER_PLANE_SIZE
+#define HEADER_SIZE             16U
+#define ENCODING_PLANAR         0U
+#define ENCODING_XOR_DELTA      2U
+#define PLANE_BW                (1U << 0)
+#define PLANE_RED               (1U << 1)
+#define ROTATION_0              0U
+#define ROTATION_90             1U
+
+// Palette indexes of script.js
+#define INDEX_BLACK             0U
+#define INDEX_WHITE             1U
+#define INDEX_RED               2U
+
+// A refresh of the panel takes about 20 s
+#define REFRESH_TIMEOUT_S       60.0
+
+typedef struct
+{
+    const char*     path;
+    uint8_t*        upload;         // Header and room for both planes, NULL when the conversion failed
+    size_t          len;
+    double          decode_s;
+    double          dither_s;
+    double          done_at;
+    bool            done;
+} job_t;
+
+typedef struct
+{
+    uint8_t*        rgb;            // RGB888
+    uint32_t        width;
+    uint32_t        height;
+} image_t;
+
+static job_t*           jobs        = NULL;
+static uint32_t         job_count   = 0;
+static atomic_uint      next_job    = 0;
+static bool             color       = true;
+
+static pthread_mutex_t  done_lock   = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   done_cond   = PTHREAD_COND_INITIALIZER;
+
+static double convert_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool convert_has_ext(const char* name, const char* ext)
+{
+    size_t len = strlen(name);
+    size_t ext_len = strlen(ext);
+    return (len > ext_len) && (strcasecmp(name + len - ext_len, ext) == 0);
+}
+
+typedef struct
+{
+    struct jpeg_error_mgr   mgr;
+    jmp_buf                 jump;
+} jpeg_error_t;
+
+static void convert_jpeg_error(j_common_ptr cinfo)
+{
+    longjmp(((jpeg_error_t*) cinfo->err)->jump, 1);
+}
+
+// Decode a JPEG, downscaled by the decoder as long as it still covers the frame
+static bool convert_load_jpeg(const char* path, image_t* img)
+{
+    struct jpeg_decompress_struct cinfo;
+    jpeg_error_t err;
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    img->rgb = NULL;
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = convert_jpeg_error;
+    if (setjmp(err.jump))
+    {
+        jpeg_destroy_decompress(&cinfo);
+        fclose(file);
+        free(img->rgb);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, file);
+    jpeg_read_header(&cinfo, TRUE);
+
+    uint32_t w = cinfo.image_width;
+    uint32_t h = cinfo.image_height;
+    uint32_t frame_short = DISPLAY_HEIGHT;
+    uint32_t frame_long  = DISPLAY_WIDTH;
+    uint32_t img_short   = (w < h) ? w : h;
+    uint32_t img_long    = (w < h) ? h : w;
+
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.scale_num   = 1;
+    cinfo.scale_denom = 8;
+    while ((cinfo.scale_denom > 1) && (((img_short / cinfo.scale_denom) < frame_short)
+                                       || ((img_long / cinfo.scale_denom) < frame_long)))
+    {
+        cinfo.scale_denom >>= 1;
+    }
+
+    jpeg_start_decompress(&cinfo);
+    img->width  = cinfo.output_width;
+    img->height = cinfo.output_height;
+    img->rgb    = malloc((size_t) img->width * img->height * 3U);
+    if (img->rgb == NULL)
+    {
+        longjmp(err.jump, 1);
+    }
+
+    while (cinfo.output_scanline < cinfo.output_height)
+    {
+        JSAMPROW row = img->rgb + (size_t) cinfo.output_scanline * img->width * 3U;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    fclose(file);
+    return true;
+}
+
+// Decode a PNG of any format, blended on black like a canvas reads it without alpha
+static bool convert_load_png(const char* path, image_t* img)
+{
+    png_image png = { .version = PNG_IMAGE_VERSION };
+
+    if (!png_image_begin_read_from_file(&png, path))
+    {
+        return false;
+    }
+
+    png.format  = PNG_FORMAT_RGB;
+    img->width  = png.width;
+    img->height = png.height;
+    img->rgb    = malloc(PNG_IMAGE_SIZE(png));
+
+    png_color black = { 0, 0, 0 };
+    if ((img->rgb == NULL) || !png_image_finish_read(&png, &black, img->rgb, 0, NULL))
+    {
+        png_image_free(&png);
+        free(img->rgb);
+        return false;
+    }
+
+    return true;
+}
+
+// Crop the center to the frame ratio and resize it, averaging the pixels each one covers
+static void convert_resize(const image_t* img, uint8_t* out, uint32_t frame_w, uint32_t frame_h)
+{
+    uint32_t clip_w = img->width;
+    uint32_t clip_h = img->height;
+
+    if ((uint64_t) img->width * frame_h > (uint64_t) img->height * frame_w)
+    {
+        clip_w = (uint64_t) img->height * frame_w / frame_h;
+    }
+    else
+    {
+        clip_h = (uint64_t) img->width * frame_h / frame_w;
+    }
+
+    uint32_t clip_x = (img->width - clip_w) / 2U;
+    uint32_t clip_y = (img->height - clip_h) / 2U;
+
+    for (uint32_t y = 0; y < frame_h; y++)
+    {
+        uint32_t y0 = clip_y + (uint64_t) y * clip_h / frame_h;
+        uint32_t y1 = clip_y + (uint64_t) (y + 1U) * clip_h / frame_h;
+        y1 = (y1 > y0) ? y1 : y0 + 1U;
+
+        for (uint32_t x = 0; x < frame_w; x++)
+        {
+            uint32_t x0 = clip_x + (uint64_t) x * clip_w / frame_w;
+            uint32_t x1 = clip_x + (uint64_t) (x + 1U) * clip_w / frame_w;
+            x1 = (x1 > x0) ? x1 : x0 + 1U;
+
+            uint32_t sum[3] = { 0, 0, 0 };
+            for (uint32_t sy = y0; sy < y1; sy++)
+            {
+                const uint8_t* p = img->rgb + ((size_t) sy * img->width + x0) * 3U;
+                for (uint32_t sx = x0; sx < x1; sx++, p += 3)
+                {
+                    sum[0] += p[0];
+                    sum[1] += p[1];
+                    sum[2] += p[2];
+                }
+            }
+
+            uint32_t count = (y1 - y0) * (x1 - x0);
+            uint8_t* o = out + ((size_t) y * frame_w + x) * 3U;
+            o[0] = (sum[0] + count / 2U) / count;
+            o[1] = (sum[1] + count / 2U) / count;
+            o[2] = (sum[2] + count / 2U) / count;
+        }
+    }
+}
+
+// Longest frame line, landscape or portrait
+#define FRAME_LINE_MAX          ((DISPLAY_WIDTH > DISPLAY_HEIGHT) ? DISPLAY_WIDTH : DISPLAY_HEIGHT)
+
+// Palette colors as RGB, in index order
+static const int16_t palette[3][3] = {
+    [INDEX_BLACK]   = { 0,   0,   0   },
+    [INDEX_WHITE]   = { 255, 255, 255 },
+    [INDEX_RED]     = { 255, 0,   0   },
+};
+
+static inline int16_t convert_clamp(int32_t value)
+{
+    return (value < 0) ? 0 : ((value > 255) ? 255 : value);
+}
+
+// Quantize and dither as script.js does, into the black/white and red planes
+// Nearest palette color, Floyd-Steinberg error kept on the current and next lines
+static void convert_dither(uint8_t* px, uint32_t w, uint32_t h, uint8_t* bw_plane, uint8_t* red_plane)
+{
+    // 3 channels, with a pixel of margin on each side
+    int16_t lines[2][(FRAME_LINE_MAX + 2U) * 3U];
+    int16_t* line = lines[0];
+    int16_t* next = lines[1];
+    uint8_t  colors = color ? 3U : 2U;
+
+    memset(bw_plane, 0, PLANE_SIZE);
+    memset(red_plane, 0, PLANE_SIZE);
+    memset(lines, 0, sizeof(lines));
+
+    for (uint32_t y = 0; y < h; y++)
+    {
+        for (uint32_t x = 0; x < w; x++)
+        {
+            const uint8_t* p = px + ((size_t) y * w + x) * 3U;
+            uint32_t e = (x + 1U) * 3U;
+            int16_t value[3];
+
+            // Clamped once the errors are summed, see script.js
+            for (uint8_t k = 0; k < 3U; k++)
+            {
+                value[k] = convert_clamp(p[k] + line[e + k]);
+            }
+
+            uint8_t  index = INDEX_BLACK;
+            uint32_t best  = UINT32_MAX;
+            for (uint8_t c = 0; c < colors; c++)
+            {
+                uint32_t distance = 0;
+                for (uint8_t k = 0; k < 3U; k++)
+                {
+                    int32_t d = value[k] - palette[c][k];
+                    distance += d * d;
+                }
+                if (distance < best)
+                {
+                    best  = distance;
+                    index = c;
+                }
+            }
+
+            uint32_t bit = y * w + x;
+            if (index == INDEX_WHITE)
+            {
+                bw_plane[bit >> 3] |= 0x80U >> (bit & 7U);
+            }
+            else if (index == INDEX_RED)
+            {
+                red_plane[bit >> 3] |= 0x80U >> (bit & 7U);
+            }
+
+            // Floyd-Steinberg, the margins take the errors out of the frame
+            for (uint8_t k = 0; k < 3U; k++)
+            {
+                int32_t err = value[k] - palette[index][k];
+                line[e + 3U + k] += (err * 7) >> 4;
+                next[e - 3U + k] += (err * 3) >> 4;
+                next[e + k]      += (err * 5) >> 4;
+                next[e + 3U + k] += err >> 4;
+            }
+        }
+
+        int16_t* done = line;
+        line = next;
+        next = done;
+        memset(next, 0, sizeof(lines[0]));
+    }
+}
+
+// Photo to upload: portrait ones are kept as 480x800 and turned by the device
+static void convert_job(job_t* job, uint8_t* px)
+{
+    image_t img;
+    double start = convert_now();
+
+    bool loaded = (convert_has_ext(job->path, ".png") ? convert_load_png(job->path, &img)
+                                                      : convert_load_jpeg(job->path, &img));
+    job->decode_s = convert_now() - start;
+    if (!loaded)
+    {
+        fprintf(stderr, "%s: cannot decode\n", job->path);
+        return;
+    }
+
+    start = convert_now();
+    bool portrait = (img.width < img.height);
+    uint32_t frame_w = portrait ? DISPLAY_HEIGHT : DISPLAY_WIDTH;
+    uint32_t frame_h = portrait ? DISPLAY_WIDTH : DISPLAY_HEIGHT;
+
+    convert_resize(&img, px, frame_w, frame_h);
+    free(img.rgb);
+
+    // Black and white frames are sent without their red plane, as from the page
+    size_t payload_len = color ? 2U * PLANE_SIZE : PLANE_SIZE;
+    uint8_t* upload = malloc(HEADER_SIZE + 2U * PLANE_SIZE);
+    if (upload == NULL)
+    {
+        return;
+    }
+
+    uint8_t* payload = upload + HEADER_SIZE;
+    convert_dither(px, frame_w, frame_h, payload, payload + PLANE_SIZE);
+
+    uint32_t crc = crc32(0, payload, payload_len);
+    const uint8_t header[HEADER_SIZE] = {
+        'P', 'F', 1, ENCODING_PLANAR,
+        frame_w & 0xFF, frame_w >> 8, frame_h & 0xFF, frame_h >> 8,
+        PLANE_BW | (color ? PLANE_RED : 0), portrait ? ROTATION_90 : ROTATION_0, 0, 0,
+        crc, crc >> 8, crc >> 16, crc >> 24,
+    };
+    memcpy(upload, header, HEADER_SIZE);
+
+    job->upload   = upload;
+    job->len      = HEADER_SIZE + payload_len;
+    job->dither_s = convert_now() - start;
+}
+
+static void* convert_worker(void* arg)
+{
+    uint8_t* px = malloc(DISPLAY_WIDTH * DISPLAY_HEIGHT * 3U);
+
+    for (uint32_t i = atomic_fetch_add(&next_job, 1); i < job_count; i = atomic_fetch_add(&next_job, 1))
+    {
+        if (px != NULL)
+        {
+            convert_job(&jobs[i], px);
+        }
+
+        pthread_mutex_lock(&done_lock);
+        jobs[i].done_at = convert_now();
+        jobs[i].done    = true;
+        pthread_cond_broadcast(&done_cond);
+        pthread_mutex_unlock(&done_lock);
+    }
+
+    free(px);
+    return NULL;
+}
+
+static void convert_add_path(const char* path)
+{
+    jobs = realloc(jobs, (job_count + 1U) * sizeof(job_t));
+    if (jobs == NULL)
+    {
+        exit(1);
+    }
+
+    jobs[job_count++] = (job_t) { .path = strdup(path) };
+}
+
+static int convert_compare_names(const struct dirent** a, const struct dirent** b)
+{
+    return strcmp((*a)->d_name, (*b)->d_name);
+}
+
+// A photo, or the JPEG and PNG photos of a directory by name
+static void convert_add_arg(const char* arg)
+{
+    struct dirent** entries;
+    int count = scandir(arg, &entries, NULL, convert_compare_names);
+
+    if (count < 0)
+    {
+        convert_add_path(arg);
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        const char* name = entries[i]->d_name;
+        if (convert_has_ext(name, ".jpg") || convert_has_ext(name, ".jpeg") || convert_has_ext(name, ".png"))
+        {
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/%s", arg, name);
+            convert_add_path(path);
+        }
+        free(entries[i]);
+    }
+    free(entries);
+}
+
+// Output file: the upload itself, so that curl --data-binary @file.pf can send it
+static bool convert_save(const char* dir, const job_t* job)
+{
+    const char* base = strrchr(job->path, '/');
+    base = base ? base + 1 : job->path;
+
+    const char* dot = strrchr(base, '.');
+    int base_len = dot ? (int) (dot - base) : (int) strlen(base);
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%.*s.pf", dir, base_len, base);
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    bool ok = (fwrite(job->upload, 1, job->len, file) == job->len);
+    return (fclose(file) == 0) && ok;
+}
+
+static uint8_t* convert_varint(uint8_t* out, uint32_t value)
+{
+    while (value >= 0x80U)
+    {
+        *out++ = value | 0x80U;
+        value >>= 7;
+    }
+    *out++ = value;
+
+    return out;
+}
+
+// Upload of the changes from base to the frame of job, both planes in framebuffer layout
+// Return its length, 0 if it is not smaller than the upload of the whole frame
+static size_t convert_delta(const uint8_t* base, const job_t* job, uint8_t* out)
+{
+    const uint8_t* frame = job->upload + HEADER_SIZE;
+    uint8_t* payload = out + HEADER_SIZE;
+    uint8_t* end = out + job->len;
+    uint8_t* p = payload;
+
+    uint32_t base_crc = crc32(0, base, 2U * PLANE_SIZE);
+    memcpy(p, &base_crc, sizeof(base_crc));
+    p += sizeof(base_crc);
+
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < 2U * PLANE_SIZE; i++)
+    {
+        if (frame[i] == base[i])
+        {
+            continue;
+        }
+
+        // Changed bytes with up to 2 unchanged ones between them, a new record costs as much
+        uint32_t last = i;
+        for (uint32_t j = i + 1U; (j < 2U * PLANE_SIZE) && (j <= last + 3U); j++)
+        {
+            if (frame[j] != base[j])
+            {
+                last = j;
+            }
+        }
+
+        // Room for two varints of up to 3 bytes
+        uint32_t count = last + 1U - i;
+        if (p + 6U + count >= end)
+        {
+            return 0;
+        }
+
+        p = convert_varint(p, i - pos);
+        p = convert_varint(p, count);
+        for (uint32_t j = i; j <= last; j++)
+        {
+            *p++ = frame[j] ^ base[j];
+        }
+
+        pos = last + 1U;
+        i   = last;
+    }
+
+    size_t payload_len = p - payload;
+    uint32_t crc = crc32(0, payload, payload_len);
+    memcpy(out, job->upload, HEADER_SIZE);
+    out[3]  = ENCODING_XOR_DELTA;
+    out[8]  = PLANE_BW | PLANE_RED;
+    out[12] = crc;
+    out[13] = crc >> 8;
+    out[14] = crc >> 16;
+    out[15] = crc >> 24;
+
+    return HEADER_SIZE + payload_len;
+}
+
+// Upload and wait for the end of its update job, the frame takes one upload at a time
+// Only the changes are sent when shown, the frame on the panel, is known and the delta is smaller
+static bool convert_push(int* sock, const char* host, uint16_t port, const job_t* job, const uint8_t* shown)
+{
+    static uint8_t delta[HEADER_SIZE + 2U * PLANE_SIZE];
+    size_t delta_len = (shown != NULL) ? convert_delta(shown, job, delta) : 0;
+
+    if ((delta_len > 0) && (http_upload(*sock, "/upload", delta, delta_len, REFRESH_TIMEOUT_S) == 200))
+    {
+        printf("%s: delta of %zu bytes\n", job->path, delta_len);
+        return true;
+    }
+
+    // A refused delta ends the connection, 409 if the frame does not have the base anymore
+    if (delta_len > 0)
+    {
+        close(*sock);
+        *sock = http_connect(host, port);
+    }
+
+    return (*sock >= 0) && (http_upload(*sock, "/upload", job->upload, job->len, REFRESH_TIMEOUT_S) == 200);
+}
+
+// Answer GET /frame with the frames in turn, each one for period seconds, as frames in station mode pull them
+// The ETag is the CRC32 of the planes in framebuffer layout, as in the frame store
+// A frame that has one of the served frames is sent the changes from it when they are smaller
+static int convert_serve(uint16_t port, uint32_t period)
+{
+    static uint8_t delta[HEADER_SIZE + 2U * PLANE_SIZE];
+    job_t* served[job_count];
+    char etags[job_count][16];
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < job_count; i++)
+    {
+        if (jobs[i].upload != NULL)
+        {
+            snprintf(etags[count], sizeof(etags[count]), "\"%08lx\"",
+                     crc32(0, jobs[i].upload + HEADER_SIZE, 2U * PLANE_SIZE));
+            served[count++] = &jobs[i];
+        }
+    }
+
+    int one = 1;
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port   = htons(port),
+        .sin_addr   = { htonl(INADDR_ANY) },
+    };
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if ((count == 0) || (bind(listen_fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) || (listen(listen_fd, 4) < 0))
+    {
+        fprintf(stderr, "Cannot serve on port %u\n", port);
+        return 1;
+    }
+    printf("serving:    %u frames on http://0.0.0.0:%u/frame, %u s each\n", count, port, period);
+    fflush(stdout);
+
+    for (;;)
+    {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        struct timeval timeout = { .tv_sec = 5 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        char request[4096];
+        size_t have = 0;
+        while ((have < sizeof(request) - 1) && ((have < 4) || (memcmp(request + have - 4, "\r\n\r\n", 4) != 0)))
+        {
+            ssize_t len = recv(fd, request + have, 1, 0);
+            if (len <= 0)
+            {
+                break;
+            }
+            have += len;
+        }
+        request[have] = '\0';
+
+        uint32_t index = (time(NULL) / period) % count;
+        const job_t* job = served[index];
+        const char* etag = etags[index];
+
+        const char* match = strcasestr(request, "\r\nIf-None-Match:");
+        const char* match_end = match ? strstr(match + 2, "\r\n") : NULL;
+        const char* found = match ? strstr(match, etag) : NULL;
+
+        // The frame it has, if it is one of those served
+        const uint8_t* base = NULL;
+        for (uint32_t i = 0; (match != NULL) && (i < count) && (base == NULL); i++)
+        {
+            const char* other = strstr(match, etags[i]);
+            if ((other != NULL) && (other < match_end))
+            {
+                base = served[i]->upload + HEADER_SIZE;
+            }
+        }
+
+        const uint8_t* body = job->upload;
+        size_t body_len = job->len;
+        size_t delta_len = (base != NULL) ? convert_delta(base, job, delta) : 0;
+        if (delta_len > 0)
+        {
+            body = delta;
+            body_len = delta_len;
+        }
+
+        char head[256];
+        int head_len;
+        int status;
+        if (strncmp(request, "GET /frame ", 11) != 0)
+        {
+            status = 404;
+            head_len = snprintf(head, sizeof(head), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        }
+        else if ((found != NULL) && (found < match_end))
+        {
+            status = 304;
+            head_len = snprintf(head, sizeof(head), "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nConnection: close\r\n\r\n", etag);
+        }
+        else
+        {
+            status = 200;
+            head_len = snprintf(head, sizeof(head),
+                                "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: %zu\r\n"
+                                "ETag: %s\r\nConnection: close\r\n\r\n", body_len, etag);
+        }
+
+        bool sent = http_send(fd, head, head_len) && ((status != 200) || http_send(fd, body, body_len));
+        printf("%s %s: %d%s%s\n", job->path, etag, status, ((status == 200) && (body == delta)) ? ", delta" : "",
+               sent ? "" : ", not sent");
+        fflush(stdout);
+        close(fd);
+    }
+}
+
+static void convert_usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-j threads] [--bw] [-o dir] [--push host[:port]] [--serve port [--period s]] photo|dir...\n",
+            name);
+    exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char* out_dir = NULL;
+    char* push_host = NULL;
+    uint16_t push_port = 80;
+    uint16_t serve_port = 0;
+    uint32_t period = 3600;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if ((strcmp(argv[i], "-j") == 0) && has_value)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--bw") == 0)
+        {
+            color = false;
+        }
+        else if ((strcmp(argv[i], "-o") == 0) && has_value)
+        {
+            out_dir = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--push") == 0) && has_value)
+        {
+            push_host = argv[++i];
+            char* colon = strchr(push_host, ':');
+            if (colon != NULL)
+            {
+                *colon = '\0';
+                push_port = atoi(colon + 1);
+            }
+        }
+        else if ((strcmp(argv[i], "--serve") == 0) && has_value)
+        {
+            serve_port = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--period") == 0) && has_value)
+        {
+            period = atoi(argv[++i]);
+        }
+        else if (argv[i][0] == '-')
+        {
+            convert_usage(argv[0]);
+        }
+        else
+        {
+            convert_add_arg(argv[i]);
+        }
+    }
+
+    if ((job_count == 0) || (threads < 1) || (period < 1))
+    {
+        convert_usage(argv[0]);
+    }
+
+    int sock = -1;
+    if ((push_host != NULL) && ((sock = http_connect(push_host, push_port)) < 0))
+    {
+        fprintf(stderr, "Cannot connect to %s:%u\n", push_host, push_port);
+        return 1;
+    }
+
+    double start = convert_now();
+    pthread_t* pool = calloc(threads, sizeof(pthread_t));
+    for (long t = 0; t < threads; t++)
+    {
+        pthread_create(&pool[t], NULL, convert_worker, NULL);
+    }
+
+    // Results in order, saved and pushed while the next ones are converted
+    uint32_t converted = 0;
+    uint32_t failed = 0;
+    uint32_t pushed = 0;
+    double push_s = 0;
+    double decode_s = 0;
+    double dither_s = 0;
+    double converted_at = start;
+
+    // Planes of the frame on the panel, for deltas
+    static uint8_t shown[2U * PLANE_SIZE];
+    bool shown_known = false;
+
+    for (uint32_t i = 0; i < job_count; i++)
+    {
+        job_t* job = &jobs[i];
+
+        pthread_mutex_lock(&done_lock);
+        while (!job->done)
+        {
+            pthread_cond_wait(&done_cond, &done_lock);
+        }
+        pthread_mutex_unlock(&done_lock);
+
+        if (job->upload == NULL)
+        {
+            continue;
+        }
+
+        converted++;
+        decode_s += job->decode_s;
+        dither_s += job->dither_s;
+        converted_at = (job->done_at > converted_at) ? job->done_at : converted_at;
+
+        if ((out_dir != NULL) && !convert_save(out_dir, job))
+        {
+            fprintf(stderr, "%s: cannot save in %s\n", job->path, out_dir);
+            failed++;
+        }
+
+        if (sock >= 0)
+        {
+            double push_start = convert_now();
+            shown_known = convert_push(&sock, push_host, push_port, job, shown_known ? shown : NULL);
+            if (shown_known)
+            {
+                pushed++;
+                memcpy(shown, job->upload + HEADER_SIZE, sizeof(shown));
+                printf("%s: shown\n", job->path);
+            }
+            else
+            {
+                fprintf(stderr, "%s: push failed\n", job->path);
+            }
+            push_s += convert_now() - push_start;
+        }
+
+        // Kept to be served
+        if (serve_port == 0)
+        {
+            free(job->upload);
+            job->upload = NULL;
+        }
+    }
+
+    for (long t = 0; t < threads; t++)
+    {
+        pthread_join(pool[t], NULL);
+    }
+    free(pool);
+
+    // Conversion time is up to the last result, without the pushes
+    double elapsed = converted_at - start;
+    printf("converted:  %u of %u photos in %.2f s, %ld worker threads, %.1f images/s\n",
+           converted, job_count, elapsed, threads, (elapsed > 0) ? converted / elapsed : 0);
+    if (converted > 0)
+    {
+        printf("per photo:  decode %.1f ms, resize and dither %.1f ms\n",
+               decode_s * 1e3 / converted, dither_s * 1e3 / converted);
+    }
+    if (push_host != NULL)
+    {
+        printf("pushed:     %u photos, %.2f s each until shown\n", pushed, pushed ? push_s / pushed : 0);
+        if (sock >= 0)
+        {
+            close(sock);
+        }
+    }
+
+    if (serve_port != 0)
+    {
+        return convert_serve(serve_port, period);
+    }
+
+    return ((converted == job_count) && (failed == 0) && ((push_host == NULL) || (pushed == converted))) ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+// PaperFrame
+// Benchmark of the dithering kernel of the web page against the one it replaced, in node
+// node dither_bench.js panel.js ../main/webpage/script.js
+
+"use strict";
+
+const fs = require("fs");
+const vm = require("vm");
+
+const ITERATIONS = 20;
+
+// Just enough of a browser for script.js to load, nothing is drawn nor sent
+function loadPage(panel_path, script_path) {
+    const element = {
+        getContext: () => ({}),
+        addEventListener: () => {},
+    };
+    const context = {
+        document: {
+            querySelector: () => element,
+            getElementById: () => element,
+        },
+        XMLHttpRequest: function () {
+            this.open = () => {};
+            this.send = () => {};
+        },
+    };
+
+    vm.createContext(context);
+    vm.runInContext(fs.readFileSync(panel_path, "utf8") + fs.readFileSync(script_path, "utf8") +
+                    "\nthis.ditherFrame = ditherFrame; this.dest_width = dest_width; this.dest_height = dest_height;",
+                    context);
+    return context;
+}
+
+// Kernel of the page before it was rebuilt, taken out of its upload handler as is
+// The red error is NaN and the diffused errors are clipped by the Uint8ClampedArray
+function ditherBefore(pixels, frame_width, frame_height, color_mode, output_array) {
+    const index_black = 0x0;
+    const index_white = 0x1;
+    const index_red   = 0x2;
+    let error_gb, error_r;
+
+    output_array.fill(0);
+
+    const bits_per_pixel = color_mode ? 2 : 1;
+    const pixels_per_byte = 8 / bits_per_pixel;
+
+    for (let y = 0; y < frame_height; y++) {
+        for (let x = 0; x < frame_width; x++) {
+            let i = y*frame_width*4 + x*4;
+
+            pixels[i+3] = 255;
+
+            const gb = Math.sqrt(Math.pow(pixels[i + 1], 2) + Math.pow(pixels[i + 2],2));
+            const rgb = Math.sqrt(Math.pow(pixels[i], 2) + Math.pow(pixels[i + 1], 2) + Math.pow(pixels[i + 2],2));
+
+            let newpixel_gb = (gb > 128) ? 255 : 0;
+            let newpixel_r  = (rgb > 128) ? 255 : 0;
+
+            let index = index_black;
+
+            if (color_mode)
+            {
+                if ((pixels[i] >= 128) && (gb < 128))
+                {
+                    newpixel_r  = 255;
+                    newpixel_gb = 0;
+                    index = index_red;
+                }
+                else if (newpixel_gb)
+                {
+                    index = index_white;
+                }
+            }
+            else
+            {
+                newpixel_gb = newpixel_r;
+                index = newpixel_gb ? index_white : index_black;
+            }
+
+            const p = y*frame_width + x;
+            const shift = 8 - bits_per_pixel*(1 + p % pixels_per_byte);
+            output_array[Math.floor(p / pixels_per_byte)] |= index << shift;
+
+            pixels[i] = newpixel_r;
+            pixels[i + 1] = newpixel_gb;
+            pixels[i + 2] = newpixel_gb;
+
+            error_gb = gb - newpixel_gb;
+            error_r = Math.sqrt(Math.pow(pixels[i]) - Math.pow(newpixel_r));
+
+            if ((x+1) < frame_width)
+            {
+                let right = y*frame_width*4 + (x+1)*4;
+                pixels[right] += (error_r * 7) >> 4;
+                pixels[right + 1] += (error_gb * 7) >> 4;
+                pixels[right + 2] += (error_gb * 7) >> 4;
+            }
+
+            if ((y+1) != frame_height)
+            {
+                if (x > 0)
+                {
+                    let bottomleft = (y+1)*frame_width*4 + (x-1)*4;
+                    pixels[bottomleft] += (error_r *  3) >> 4;
+                    pixels[bottomleft + 1] += (error_gb * 3) >> 4;
+                    pixels[bottomleft + 2] += (error_gb * 3) >> 4;
+                }
+
+                let bottom = (y+1)*frame_width*4 + x*4;
+                pixels[bottom] += (error_r * 5) >> 4;
+                pixels[bottom + 1] += (error_gb * 5) >> 4;
+                pixels[bottom + 2] += (error_gb * 5) >> 4;
+
+                if ((x+1) < (frame_width-1))
+                {
+                    let bottomright = (y+1)*frame_width*4 + (x+1)*4;
+                    pixels[bottomright] += error_r >> 4;
+                    pixels[bottomright + 1] += error_gb >> 4;
+                    pixels[bottomright + 2] += error_gb >> 4;
+                }
+            }
+        }
+    }
+}
+
+// Red across, green down and blue the other way, every palette color is hit
+function gradient(width, height) {
+    const pixels = new Uint8ClampedArray(width * height * 4);
+
+    for (let y = 0, i = 0; y < height; y++) {
+        for (let x = 0; x < width; x++, i += 4) {
+            pixels[i]     = x * 255 / (width - 1);
+            pixels[i + 1] = y * 255 / (height - 1);
+            pixels[i + 2] = 255 - pixels[i];
+            pixels[i + 3] = 255;
+        }
+    }
+
+    return pixels;
+}
+
+// Median time of a kernel on fresh copies of the frame, in ms
+function bench(kernel, source, width, height, color) {
+    const output = new Uint8Array(width * height / 4);
+    const times = [];
+
+    for (let n = 0; n < ITERATIONS + 2; n++) {
+        const pixels = new Uint8ClampedArray(source);
+        const start = process.hrtime.bigint();
+        kernel(pixels, width, height, color, output);
+        times.push(Number(process.hrtime.bigint() - start) / 1e6);
+    }
+
+    // The first runs warm the JIT up
+    times.splice(0, 2);
+    times.sort((a, b) => a - b);
+    return times[times.length >> 1];
+}
+
+const page   = loadPage(process.argv[2] || "panel.js", process.argv[3] || "../main/webpage/script.js");
+const width  = page.dest_width;
+const height = page.dest_height;
+const source = gradient(width, height);
+
+for (const color of [true, false]) {
+    const before = bench(ditherBefore, source, width, height, color);
+    const after  = bench(page.ditherFrame, source, width, height, color);
+
+    console.log(`${color ? "color" : "black & white"} ${width} x ${height}: ${after.toFixed(1)} ms, ` +
+                `was ${before.toFixed(1)} ms (${(before / after).toFixed(1)}x)`);
+}
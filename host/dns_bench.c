@@ -0,0 +1,187 @@
+/*
+ *  PaperFrame
+ *  Host benchmark of the DNS server: runs its task on POSIX sockets and floods it over loopback
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "dns_server.h"
+
+#define LATENCY_QUERIES     20000U
+#define THROUGHPUT_SECONDS  2U
+#define THROUGHPUT_WINDOW   32U
+#define REPLY_ITERATIONS    1000000U
+
+typedef struct
+{
+    const char* name;
+    uint16_t    type;
+    bool        edns;
+} bench_query_t;
+
+// What phones send when joining a captive portal, and our own name
+static const bench_query_t queries[] = {
+    {"paperframe.io",                   1,  true},
+    {"PaperFrame.IO",                   1,  false},
+    {"connectivitycheck.gstatic.com",   1,  true},
+    {"captive.apple.com",               28, false},
+    {"www.msftconnecttest.com",         65, true},
+};
+#define QUERY_COUNT (sizeof(queries) / sizeof(queries[0]))
+
+static uint8_t  packets[QUERY_COUNT][128];
+static size_t   packet_lens[QUERY_COUNT];
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Build a standard query with recursion desired, optionally with an EDNS OPT record
+static size_t bench_build_query(uint8_t* p, uint16_t id, const bench_query_t* query)
+{
+    uint8_t* start = p;
+    const char* label = query->name;
+
+    *p++ = id >> 8;
+    *p++ = id;
+    *p++ = 0x01;
+    *p++ = 0x00;
+    *p++ = 0;   *p++ = 1;
+    *p++ = 0;   *p++ = 0;
+    *p++ = 0;   *p++ = 0;
+    *p++ = 0;   *p++ = query->edns;
+
+    while (*label)
+    {
+        const char* dot = strchr(label, '.');
+        size_t len = dot ? (size_t) (dot - label) : strlen(label);
+        *p++ = len;
+        memcpy(p, label, len);
+        p += len;
+        label += len + (dot != NULL);
+    }
+    *p++ = 0;
+    *p++ = query->type >> 8;
+    *p++ = query->type;
+    *p++ = 0;
+    *p++ = 1;
+
+    if (query->edns)
+    {
+        static const uint8_t opt[] = {0, 0, 41, 0x04, 0xD0, 0, 0, 0, 0, 0, 0};
+        memcpy(p, opt, sizeof(opt));
+        p += sizeof(opt);
+    }
+
+    return p - start;
+}
+
+static int bench_compare(const void* a, const void* b)
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+static bool bench_check_reply(const uint8_t* reply, int len, const uint8_t* query)
+{
+    return (len >= 12) && (reply[0] == query[0]) && (reply[1] == query[1]) && (reply[2] & 0x80);
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < QUERY_COUNT; i++)
+    {
+        packet_lens[i] = bench_build_query(packets[i], i, &queries[i]);
+    }
+
+    // Reply building alone
+    uint8_t work[512];
+    double start = bench_now();
+    for (uint32_t i = 0; i < REPLY_ITERATIONS; i++)
+    {
+        size_t q = i % QUERY_COUNT;
+        memcpy(work, packets[q], packet_lens[q]);
+        if (dns_server_reply(work, packet_lens[q], sizeof(work)) <= 0)
+        {
+            fprintf(stderr, "No reply to %s\n", queries[q].name);
+            return 1;
+        }
+    }
+    printf("reply:      %.1f ns/query\n", (bench_now() - start) * 1e9 / REPLY_ITERATIONS);
+
+    start_dns_server();
+    usleep(100000);
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in server = {
+        .sin_family = AF_INET,
+        .sin_port   = htons(DNS_PORT),
+        .sin_addr   = { htonl(INADDR_LOOPBACK) },
+    };
+    struct timeval timeout = { .tv_sec = 1 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (connect(sock, (struct sockaddr*) &server, sizeof(server)) < 0)
+    {
+        perror("connect");
+        return 1;
+    }
+
+    // One query at a time
+    static double latencies[LATENCY_QUERIES];
+    for (uint32_t i = 0; i < LATENCY_QUERIES; i++)
+    {
+        size_t q = i % QUERY_COUNT;
+        double sent = bench_now();
+        send(sock, packets[q], packet_lens[q], 0);
+        int len = recv(sock, work, sizeof(work), 0);
+        latencies[i] = bench_now() - sent;
+
+        if (!bench_check_reply(work, len, packets[q]))
+        {
+            fprintf(stderr, "Bad reply to %s\n", queries[q].name);
+            return 1;
+        }
+    }
+    qsort(latencies, LATENCY_QUERIES, sizeof(double), bench_compare);
+    printf("latency:    p50 %.1f us, p99 %.1f us\n",
+           latencies[LATENCY_QUERIES / 2] * 1e6, latencies[LATENCY_QUERIES * 99 / 100] * 1e6);
+
+    // Keep a window of queries in flight
+    uint32_t answered = 0;
+    uint32_t in_flight = 0;
+    start = bench_now();
+    while (bench_now() - start < THROUGHPUT_SECONDS)
+    {
+        while (in_flight < THROUGHPUT_WINDOW)
+        {
+            size_t q = (answered + in_flight) % QUERY_COUNT;
+            send(sock, packets[q], packet_lens[q], 0);
+            in_flight++;
+        }
+
+        if (recv(sock, work, sizeof(work), 0) <= 0)
+        {
+            // Lost on the loopback, send another one
+            in_flight--;
+            continue;
+        }
+        in_flight--;
+        answered++;
+    }
+    printf("throughput: %.0f queries/s\n", answered / (bench_now() - start));
+
+    close(sock);
+    return 0;
+}
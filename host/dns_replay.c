@@ -0,0 +1,240 @@
+/*
+ *  PaperFrame
+ *  Replay query bursts of phones joining the softAP against the DNS server and check its replies
+ *  ./dns_replay dns_bursts.txt
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "dns_server.h"
+
+#define MAX_QUERIES     64U
+#define REPLY_TIMEOUT_S 1U
+
+typedef struct
+{
+    char        burst[32];
+    char        name[128];
+    uint16_t    type;
+    char        expected[16];
+    bool        answered;
+} replay_query_t;
+
+static const struct
+{
+    const char* name;
+    uint16_t    type;
+} types[] = {
+    {"A", 1}, {"PTR", 12}, {"TXT", 16}, {"AAAA", 28}, {"SVCB", 64}, {"HTTPS", 65},
+};
+
+static replay_query_t queries[MAX_QUERIES];
+
+static double replay_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t replay_build_query(uint8_t* p, uint16_t id, const replay_query_t* query)
+{
+    uint8_t* start = p;
+    const char* label = query->name;
+
+    memset(p, 0, 12);
+    p[0] = id >> 8;
+    p[1] = id;
+    p[2] = 0x01;
+    p[5] = 1;
+    p += 12;
+
+    while (*label)
+    {
+        const char* dot = strchr(label, '.');
+        size_t len = dot ? (size_t) (dot - label) : strlen(label);
+        *p++ = len;
+        memcpy(p, label, len);
+        p += len;
+        label += len + (dot != NULL);
+    }
+    *p++ = 0;
+    *p++ = query->type >> 8;
+    *p++ = query->type;
+    *p++ = 0;
+    *p++ = 1;
+
+    return p - start;
+}
+
+// Tell what the reply says: A, NODATA, NXDOMAIN or why it is invalid
+static const char* replay_classify(const uint8_t* reply, int len, size_t query_len)
+{
+    if (len < 12 || !(reply[2] & 0x80))
+    {
+        return "INVALID";
+    }
+
+    uint8_t  rcode    = reply[3] & 0x0F;
+    uint16_t qd_count = (reply[4] << 8) | reply[5];
+    uint16_t an_count = (reply[6] << 8) | reply[7];
+    uint16_t ns_count = (reply[8] << 8) | reply[9];
+
+    // One record after the question: a 4-byte A or a 22-byte SOA, owned by the question name
+    const uint8_t* record = reply + query_len;
+    if ((qd_count != 1) || (an_count + ns_count != 1) || (len < (int) query_len + 12) || (record[0] != 0xC0))
+    {
+        return "MALFORMED";
+    }
+
+    uint16_t type      = (record[2] << 8) | record[3];
+    uint16_t rdata_len = (record[10] << 8) | record[11];
+    if (len != (int) query_len + 12 + rdata_len)
+    {
+        return "MALFORMED";
+    }
+
+    if ((an_count == 1) && (type == 1) && (rdata_len == 4) && (rcode == 0))
+    {
+        return "A";
+    }
+    if ((ns_count == 1) && (type == 6))
+    {
+        return (rcode == 3) ? "NXDOMAIN" : (rcode == 0) ? "NODATA" : "MALFORMED";
+    }
+
+    return "MALFORMED";
+}
+
+static uint16_t replay_parse_type(const char* name)
+{
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    {
+        if (strcasecmp(types[i].name, name) == 0)
+        {
+            return types[i].type;
+        }
+    }
+    return 0;
+}
+
+static size_t replay_load(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    char line[256];
+    char type[16];
+    size_t count = 0;
+
+    if (file == NULL)
+    {
+        perror(path);
+        exit(1);
+    }
+
+    while (fgets(line, sizeof(line), file) && (count < MAX_QUERIES))
+    {
+        replay_query_t* query = &queries[count];
+        if ((line[0] == '#')
+            || (sscanf(line, "%31s %127s %15s %15s", query->burst, query->name, type, query->expected) != 4))
+        {
+            continue;
+        }
+
+        query->type = replay_parse_type(type);
+        if (query->type == 0)
+        {
+            fprintf(stderr, "Unknown type %s\n", type);
+            exit(1);
+        }
+        count++;
+    }
+
+    fclose(file);
+    return count;
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = replay_load((argc > 1) ? argv[1] : "dns_bursts.txt");
+    uint32_t failures = 0;
+
+    start_dns_server();
+    usleep(100000);
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in server = {
+        .sin_family = AF_INET,
+        .sin_port   = htons(DNS_PORT),
+        .sin_addr   = { htonl(INADDR_LOOPBACK) },
+    };
+    struct timeval timeout = { .tv_sec = REPLY_TIMEOUT_S };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    connect(sock, (struct sockaddr*) &server, sizeof(server));
+
+    for (size_t first = 0; first < count; )
+    {
+        size_t last = first;
+        uint8_t packet[512];
+        size_t lens[MAX_QUERIES];
+
+        // Send the whole burst, query ids are their index
+        double start = replay_now();
+        while ((last < count) && (strcmp(queries[last].burst, queries[first].burst) == 0))
+        {
+            lens[last] = replay_build_query(packet, last, &queries[last]);
+            send(sock, packet, lens[last], 0);
+            last++;
+        }
+
+        size_t pending = last - first;
+        while (pending > 0)
+        {
+            int len = recv(sock, packet, sizeof(packet), 0);
+            if (len < 0)
+            {
+                break;
+            }
+
+            size_t id = (packet[0] << 8) | packet[1];
+            if ((id < first) || (id >= last) || queries[id].answered)
+            {
+                continue;
+            }
+
+            const char* result = replay_classify(packet, len, lens[id]);
+            queries[id].answered = true;
+            pending--;
+
+            if (strcmp(result, queries[id].expected) != 0)
+            {
+                printf("  FAIL %s %u: %s instead of %s\n", queries[id].name, queries[id].type, result, queries[id].expected);
+                failures++;
+            }
+        }
+
+        for (size_t i = first; i < last; i++)
+        {
+            if (!queries[i].answered)
+            {
+                printf("  FAIL %s %u: no reply\n", queries[i].name, queries[i].type);
+                failures++;
+            }
+        }
+
+        printf("%-10s %2zu queries answered in %.1f us\n", queries[first].burst, last - first, (replay_now() - start) * 1e6);
+        first = last;
+    }
+
+    close(sock);
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,225 @@
+/*
+ *  PaperFrame
+ *  Host test and benchmark of the plane blitter: checks blits, fills, text and captions against a per-pixel reference
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "display_config.h"
+#include "display_manager.h"
+#include "frame_draw.h"
+#include "frame_font.h"
+
+#include "test.h"
+
+#define BENCH_ITERATIONS    200U
+#define BLIT_CASES          2000U
+#define SRC_WIDTH           123U    // Rows end inside a byte, padding bits are random
+#define SRC_HEIGHT          77U
+#define SRC_STRIDE          ((SRC_WIDTH + 7U) / 8U)
+
+static uint8_t  framebuffer[FRAMEBUFFER_SIZE];
+static uint8_t  expected[FRAMEBUFFER_SIZE];
+static uint8_t  src_data[SRC_STRIDE * SRC_HEIGHT];
+static uint8_t  mask_data[SRC_STRIDE * SRC_HEIGHT];
+static frame_rotation_t rotation = FRAME_ROTATION_0;
+
+// Only what frame_draw uses
+uint8_t* display_manager_get_framebuffer(void)
+{
+    return framebuffer;
+}
+
+frame_rotation_t display_manager_get_rotation(void)
+{
+    return rotation;
+}
+
+static int32_t test_random(int32_t min, int32_t max)
+{
+    return min + rand() % (max - min + 1);
+}
+
+// Pixels out of the plane read as 0
+static bool test_get(const frame_plane_t* plane, int32_t x, int32_t y)
+{
+    if ((x < 0) || (y < 0) || (x >= plane->width) || (y >= plane->height))
+    {
+        return false;
+    }
+    return (plane->data[y * plane->stride + x / 8] >> (7 - x % 8)) & 1U;
+}
+
+// Pixels out of the plane are dropped
+static void test_set(const frame_plane_t* plane, int32_t x, int32_t y, bool value)
+{
+    if ((x < 0) || (y < 0) || (x >= plane->width) || (y >= plane->height))
+    {
+        return;
+    }
+
+    uint8_t* byte = &plane->data[y * plane->stride + x / 8];
+    uint8_t  bit  = 0x80U >> (x % 8);
+    *byte = value ? (*byte | bit) : (*byte & ~bit);
+}
+
+// One pixel at a time: src is NULL for a fill with value, the mask is read at (mx, my) + (i, j)
+static void test_reference(const frame_plane_t* dst, int32_t x, int32_t y, const frame_plane_t* src, int32_t sx, int32_t sy,
+                           int32_t w, int32_t h, const frame_plane_t* mask, int32_t mx, int32_t my, bool value)
+{
+    for (int32_t j = 0; j < h; j++)
+    {
+        for (int32_t i = 0; i < w; i++)
+        {
+            if ((mask == NULL) || test_get(mask, mx + i, my + j))
+            {
+                test_set(dst, x + i, y + j, (src != NULL) ? test_get(src, sx + i, sy + j) : value);
+            }
+        }
+    }
+}
+
+// Text of the 5x7 font, each pixel a scale x scale square
+static void test_reference_text(int32_t x, int32_t y, const char* text, uint8_t scale, frame_color_t color)
+{
+    frame_plane_t bw  = { expected, DISPLAY_WIDTH, DISPLAY_HEIGHT, DISPLAY_WIDTH / 8U };
+    frame_plane_t red = { expected + FRAMEBUFFER_PLANE_SIZE, DISPLAY_WIDTH, DISPLAY_HEIGHT, DISPLAY_WIDTH / 8U };
+
+    if (rotation == FRAME_ROTATION_90)
+    {
+        bw.width  = red.width  = DISPLAY_HEIGHT;
+        bw.height = red.height = DISPLAY_WIDTH;
+        bw.stride = red.stride = DISPLAY_HEIGHT / 8U;
+    }
+
+    for (; *text != '\0'; text++, x += FRAME_FONT_ADVANCE * scale)
+    {
+        char c = ((*text < FRAME_FONT_FIRST) || (*text > FRAME_FONT_LAST)) ? '?' : *text;
+
+        for (int32_t row = 0; row < (int32_t) (FRAME_FONT_HEIGHT * scale); row++)
+        {
+            for (int32_t col = 0; col < (int32_t) (FRAME_FONT_WIDTH * scale); col++)
+            {
+                if ((frame_font[c - FRAME_FONT_FIRST][row / scale] >> (7 - col / scale)) & 1U)
+                {
+                    test_set(&bw, x + col, y + row, color == FRAME_COLOR_WHITE);
+                    test_set(&red, x + col, y + row, color == FRAME_COLOR_RED);
+                }
+            }
+        }
+    }
+}
+
+static void test_random_fill(uint8_t* data, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        data[i] = rand();
+    }
+}
+
+// Random blits and fills, clipped on every side, against the reference
+static bool test_blits(bool fill, bool masked)
+{
+    frame_plane_t dst  = { framebuffer, DISPLAY_WIDTH, DISPLAY_HEIGHT, DISPLAY_WIDTH / 8U };
+    frame_plane_t ref  = { expected, DISPLAY_WIDTH, DISPLAY_HEIGHT, DISPLAY_WIDTH / 8U };
+    frame_plane_t src  = { src_data, SRC_WIDTH, SRC_HEIGHT, SRC_STRIDE };
+    frame_plane_t mask = { mask_data, SRC_WIDTH, SRC_HEIGHT, SRC_STRIDE };
+
+    for (uint32_t n = 0; n < BLIT_CASES; n++)
+    {
+        int16_t  x  = test_random(-150, DISPLAY_WIDTH + 20);
+        int16_t  y  = test_random(-100, DISPLAY_HEIGHT + 20);
+        int16_t  sx = test_random(-20, SRC_WIDTH);
+        int16_t  sy = test_random(-20, SRC_HEIGHT);
+        uint16_t w  = test_random(0, 200);
+        uint16_t h  = test_random(0, 100);
+        bool value  = rand() & 1;
+
+        if (fill)
+        {
+            frame_plane_fill(&dst, x, y, w, h, masked ? &mask : NULL, value);
+            test_reference(&ref, x, y, NULL, 0, 0, w, h, masked ? &mask : NULL, 0, 0, value);
+        }
+        else
+        {
+            frame_plane_blit(&dst, x, y, &src, sx, sy, w, h, masked ? &mask : NULL);
+            test_reference(&ref, x, y, &src, sx, sy, w, h, masked ? &mask : NULL, sx, sy, false);
+        }
+
+        if (memcmp(framebuffer, expected, FRAMEBUFFER_PLANE_SIZE) != 0)
+        {
+            printf("x %d y %d sx %d sy %d w %u h %u\n", x, y, sx, sy, w, h);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(void)
+{
+    srand(1);
+    test_random_fill(src_data, sizeof(src_data));
+    test_random_fill(mask_data, sizeof(mask_data));
+    test_random_fill(framebuffer, sizeof(framebuffer));
+    memcpy(expected, framebuffer, sizeof(expected));
+
+    test_expect(test_blits(false, false), "blits, clipped");
+    test_expect(test_blits(false, true), "masked blits, clipped");
+    test_expect(test_blits(true, false), "fills, clipped");
+    test_expect(test_blits(true, true), "masked fills, clipped");
+
+    // Text at every scale and across the edges, in both planes
+    bool ok = true;
+    for (uint8_t scale = 1; scale <= 6; scale++)
+    {
+        int16_t x = test_random(-20, DISPLAY_WIDTH - 40);
+        int16_t y = test_random(-10, DISPLAY_HEIGHT - 10);
+        frame_color_t color = scale % 3;
+
+        frame_draw_text(x, y, "PaperFrame 0~ \x7f", scale, color);
+        test_reference_text(x, y, "PaperFrame 0~ \x7f", scale, color);
+        ok &= (memcmp(framebuffer, expected, sizeof(expected)) == 0);
+    }
+    test_expect(ok, "text, every scale");
+
+    // Captions: a white band at the bottom of the frame as it is turned, centered black text
+    static const char* const captions[] = { "Summer 2026", "", "A caption far too long to fit across a portrait frame" };
+    uint16_t band = FRAME_FONT_HEIGHT * FRAME_CAPTION_SCALE + 2U * FRAME_CAPTION_MARGIN;
+
+    ok = true;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        rotation = (i == 2) ? FRAME_ROTATION_90 : FRAME_ROTATION_0;
+
+        uint16_t width  = (rotation == FRAME_ROTATION_90) ? DISPLAY_HEIGHT : DISPLAY_WIDTH;
+        uint16_t height = (rotation == FRAME_ROTATION_90) ? DISPLAY_WIDTH : DISPLAY_HEIGHT;
+        uint16_t text   = strlen(captions[i]) * FRAME_FONT_ADVANCE * FRAME_CAPTION_SCALE;
+        frame_plane_t bw  = { expected, width, height, width / 8U };
+        frame_plane_t red = { expected + FRAMEBUFFER_PLANE_SIZE, width, height, width / 8U };
+
+        frame_draw_caption(captions[i]);
+        test_reference(&bw, 0, height - band, NULL, 0, 0, width, band, NULL, 0, 0, true);
+        test_reference(&red, 0, height - band, NULL, 0, 0, width, band, NULL, 0, 0, false);
+        test_reference_text((text < width - 2U * FRAME_CAPTION_MARGIN) ? (width - text) / 2U : FRAME_CAPTION_MARGIN,
+                            height - band + FRAME_CAPTION_MARGIN, captions[i], FRAME_CAPTION_SCALE, FRAME_COLOR_BLACK);
+        ok &= (memcmp(framebuffer, expected, sizeof(expected)) == 0);
+    }
+    test_expect(ok, "captions, landscape and portrait");
+
+    // Throughput: a whole plane from a shifted copy of itself, then a caption
+    frame_plane_t plane = { framebuffer, DISPLAY_WIDTH, DISPLAY_HEIGHT, DISPLAY_WIDTH / 8U };
+    frame_plane_t copy  = { expected, DISPLAY_WIDTH, DISPLAY_HEIGHT, DISPLAY_WIDTH / 8U };
+    rotation = FRAME_ROTATION_0;
+
+    double blit_us = TEST_BENCH_US(BENCH_ITERATIONS, frame_plane_blit(&plane, 0, 0, &copy, 3, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, NULL));
+    double caption_us = TEST_BENCH_US(BENCH_ITERATIONS, frame_draw_caption("Summer 2026"));
+
+    printf("unaligned plane blit %.1f us, caption %.1f us (%u x %u)\n", blit_us, caption_us, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+    return test_result();
+}
@@ -0,0 +1,276 @@
+/*
+ *  PaperFrame
+ *  Host test and benchmark of the frame images: decodes the BMP, the PNG and the thumbnails of a frame
+ *  and checks them against a per-pixel reference, needs zlib
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include "display_config.h"
+#include "frame_image.h"
+
+#include "test.h"
+
+#define BENCH_ITERATIONS    200U
+#define OUTPUT_SIZE         (256U * 1024U)
+#define THUMB_WIDTH         (DISPLAY_WIDTH / FRAME_THUMB_BLOCK)
+#define THUMB_HEIGHT        (DISPLAY_HEIGHT / FRAME_THUMB_BLOCK)
+
+static uint8_t  planes[FRAMEBUFFER_SIZE];
+static uint8_t  output[OUTPUT_SIZE];
+static uint32_t output_len;
+static uint8_t  idat[OUTPUT_SIZE];
+static uint8_t  rows[DISPLAY_HEIGHT * (1U + DISPLAY_WIDTH / 4U)];
+static uint8_t  thumb[THUMB_WIDTH * THUMB_HEIGHT];
+
+// CRC32 of the ROM, the same as zlib
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len)
+{
+    return crc32(crc, buf, len);
+}
+
+static bool test_write(void* ctx, const uint8_t* data, uint32_t len)
+{
+    if (len > OUTPUT_SIZE - output_len)
+    {
+        return false;
+    }
+
+    memcpy(output + output_len, data, len);
+    output_len += len;
+    return true;
+}
+
+static uint32_t test_get32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint32_t test_get32_be(const uint8_t* p)
+{
+    return ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static bool test_bit(const uint8_t* plane, uint16_t x, uint16_t y)
+{
+    return (plane[y * (DISPLAY_WIDTH / 8U) + x / 8U] >> (7U - x % 8U)) & 1U;
+}
+
+// Palette index of a pixel: black 0, white 1, red 2 whatever the B/W plane says
+static uint8_t test_index(uint16_t x, uint16_t y)
+{
+    return test_bit(planes + FRAMEBUFFER_PLANE_SIZE, x, y) ? 2U : test_bit(planes, x, y);
+}
+
+// Encode the whole frame into output
+static bool test_encode(frame_image_format_t format)
+{
+    static frame_image_encoder_t enc;
+    const uint16_t stride = DISPLAY_WIDTH / 8U;
+
+    output_len = 0;
+    if (!frame_image_begin(&enc, format, DISPLAY_WIDTH, DISPLAY_HEIGHT, test_write, NULL))
+    {
+        return false;
+    }
+
+    for (uint16_t y = 0; y < DISPLAY_HEIGHT; y++)
+    {
+        if (!frame_image_row(&enc, planes + y * stride, planes + FRAMEBUFFER_PLANE_SIZE + y * stride))
+        {
+            return false;
+        }
+    }
+
+    return frame_image_end(&enc);
+}
+
+static void test_thumbnail(void)
+{
+    const uint16_t stride = DISPLAY_WIDTH / 8U;
+
+    for (uint16_t row = 0; row < THUMB_HEIGHT; row++)
+    {
+        uint32_t offset = row * FRAME_THUMB_BLOCK * stride;
+        frame_image_thumb_row(planes + offset, planes + FRAMEBUFFER_PLANE_SIZE + offset, stride, thumb + row * THUMB_WIDTH);
+    }
+}
+
+// 4-bpp top-down BMP with a 3 colors palette
+static bool test_check_bmp(void)
+{
+    static const uint8_t palette[3][4] = { {0x00, 0x00, 0x00, 0}, {0xFF, 0xFF, 0xFF, 0}, {0x00, 0x00, 0xFF, 0} };
+    const uint32_t offset = FRAME_IMAGE_BMP_SIZE(3U);
+    const uint8_t* p = output;
+
+    if ((output_len != offset + FRAMEBUFFER_PLANE_SIZE * 4U) || (p[0] != 'B') || (p[1] != 'M')
+        || (test_get32(p + 2) != output_len) || (test_get32(p + 10) != offset)
+        || (test_get32(p + 18) != DISPLAY_WIDTH) || ((int32_t) test_get32(p + 22) != -(int32_t) DISPLAY_HEIGHT)
+        || (p[28] != 4) || (test_get32(p + 46) != 3) || (memcmp(p + 54, palette, sizeof(palette)) != 0))
+    {
+        return false;
+    }
+
+    p += offset;
+    for (uint16_t y = 0; y < DISPLAY_HEIGHT; y++)
+    {
+        for (uint16_t x = 0; x < DISPLAY_WIDTH; x++)
+        {
+            uint8_t index = (p[(y * DISPLAY_WIDTH + x) / 2U] >> ((x % 2U) ? 0 : 4)) & 0x0FU;
+            if (index != test_index(x, y))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// 2-bpp indexed PNG: chunks and their CRC, then the inflated rows
+static bool test_check_png(void)
+{
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    const uint8_t* p   = output + sizeof(signature);
+    const uint8_t* end = output + output_len;
+    uint32_t idat_len  = 0;
+    bool ended = false;
+
+    if ((output_len < sizeof(signature)) || (memcmp(output, signature, sizeof(signature)) != 0))
+    {
+        return false;
+    }
+
+    while (!ended && (p + 12 <= end))
+    {
+        uint32_t len = test_get32_be(p);
+        const uint8_t* type = p + 4;
+        const uint8_t* data = p + 8;
+
+        if ((data + len + 4 > end) || (test_get32_be(data + len) != crc32(0, type, len + 4)))
+        {
+            return false;
+        }
+
+        if (memcmp(type, "IHDR", 4) == 0)
+        {
+            if ((test_get32_be(data) != DISPLAY_WIDTH) || (test_get32_be(data + 4) != DISPLAY_HEIGHT)
+                || (data[8] != 2) || (data[9] != 3))
+            {
+                return false;
+            }
+        }
+        else if (memcmp(type, "IDAT", 4) == 0)
+        {
+            memcpy(idat + idat_len, data, len);
+            idat_len += len;
+        }
+        else if (memcmp(type, "IEND", 4) == 0)
+        {
+            ended = true;
+        }
+
+        p = data + len + 4;
+    }
+
+    uLongf rows_len = sizeof(rows);
+    if (!ended || (p != end) || (uncompress(rows, &rows_len, idat, idat_len) != Z_OK) || (rows_len != sizeof(rows)))
+    {
+        return false;
+    }
+
+    for (uint16_t y = 0; y < DISPLAY_HEIGHT; y++)
+    {
+        const uint8_t* row = rows + y * (1U + DISPLAY_WIDTH / 4U);
+
+        if (row[0] != 0)
+        {
+            return false;
+        }
+
+        for (uint16_t x = 0; x < DISPLAY_WIDTH; x++)
+        {
+            if (((row[1U + x / 4U] >> (6U - 2U * (x % 4U))) & 0x3U) != test_index(x, y))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// White level in the high nibble, red in the low one, of the pixels of each 8x8 block
+static bool test_check_thumbnail(void)
+{
+    for (uint16_t by = 0; by < THUMB_HEIGHT; by++)
+    {
+        for (uint16_t bx = 0; bx < THUMB_WIDTH; bx++)
+        {
+            uint32_t white = 0;
+            uint32_t red   = 0;
+
+            for (uint16_t y = by * FRAME_THUMB_BLOCK; y < (by + 1U) * FRAME_THUMB_BLOCK; y++)
+            {
+                for (uint16_t x = bx * FRAME_THUMB_BLOCK; x < (bx + 1U) * FRAME_THUMB_BLOCK; x++)
+                {
+                    uint8_t index = test_index(x, y);
+                    white += (index == 1U);
+                    red   += (index == 2U);
+                }
+            }
+
+            uint8_t expected = (((white * 15U + 32U) >> 6) << 4) | ((red * 15U + 32U) >> 6);
+            if (thumb[by * THUMB_WIDTH + bx] != expected)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int main(void)
+{
+    srand(1);
+
+    // Random pixels, then sparse ones
+    for (uint8_t frame = 0; frame < 2; frame++)
+    {
+        for (uint32_t i = 0; i < FRAMEBUFFER_SIZE; i++)
+        {
+            planes[i] = (frame == 0) ? rand() : (rand() & rand() & rand());
+        }
+
+        const char* name = (frame == 0) ? "random frame" : "sparse frame";
+        char what[64];
+
+        snprintf(what, sizeof(what), "BMP, %s", name);
+        test_expect(test_encode(FRAME_IMAGE_BMP) && test_check_bmp(), what);
+
+        snprintf(what, sizeof(what), "PNG, %s", name);
+        test_expect(test_encode(FRAME_IMAGE_PNG) && test_check_png(), what);
+
+        snprintf(what, sizeof(what), "thumbnail, %s", name);
+        test_thumbnail();
+        test_expect(test_check_thumbnail(), what);
+    }
+
+    // Throughput, the output goes to memory
+    double bmp_us = TEST_BENCH_US(BENCH_ITERATIONS, test_encode(FRAME_IMAGE_BMP));
+    uint32_t bmp_len = output_len;
+    double png_us = TEST_BENCH_US(BENCH_ITERATIONS, test_encode(FRAME_IMAGE_PNG));
+    uint32_t png_len = output_len;
+    double thumb_us = TEST_BENCH_US(BENCH_ITERATIONS, test_thumbnail());
+
+    printf("BMP %.1f us (%lu bytes), PNG %.1f us (%lu bytes), thumbnail %.1f us (%u x %u)\n",
+           bmp_us, (unsigned long) bmp_len, png_us, (unsigned long) png_len, thumb_us, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+    return test_result();
+}
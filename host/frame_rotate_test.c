@@ -0,0 +1,110 @@
+/*
+ *  PaperFrame
+ *  Host test and benchmark of plane rotation: checks every band against a per-pixel reference
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "display_config.h"
+#include "frame_rotate.h"
+
+#include "test.h"
+
+#define BENCH_ITERATIONS    200U
+#define BAND_COUNT          (DISPLAY_HEIGHT / FRAME_ROTATE_BAND_ROWS)
+
+static uint8_t  plane[FRAMEBUFFER_PLANE_SIZE];
+static uint8_t  rotated[FRAMEBUFFER_PLANE_SIZE];
+static uint8_t  expected[FRAMEBUFFER_PLANE_SIZE];
+
+static const char* const rotation_names[] = { "0", "90", "180", "270" };
+
+static inline bool test_get(const uint8_t* src, uint16_t width, uint16_t x, uint16_t y)
+{
+    return (src[y * (width / 8U) + x / 8U] >> (7U - x % 8U)) & 1U;
+}
+
+// Display pixel (x, y) one at a time. Quarter turns read a DISPLAY_HEIGHT x DISPLAY_WIDTH portrait plane
+static void test_reference(const uint8_t* src, uint8_t* dst, frame_rotation_t rotation)
+{
+    memset(dst, 0, FRAMEBUFFER_PLANE_SIZE);
+
+    for (uint16_t y = 0; y < DISPLAY_HEIGHT; y++)
+    {
+        for (uint16_t x = 0; x < DISPLAY_WIDTH; x++)
+        {
+            bool pixel;
+
+            switch (rotation)
+            {
+                case FRAME_ROTATION_90:
+                    pixel = test_get(src, DISPLAY_HEIGHT, y, DISPLAY_WIDTH - 1U - x);
+                    break;
+
+                case FRAME_ROTATION_180:
+                    pixel = test_get(src, DISPLAY_WIDTH, DISPLAY_WIDTH - 1U - x, DISPLAY_HEIGHT - 1U - y);
+                    break;
+
+                case FRAME_ROTATION_270:
+                    pixel = test_get(src, DISPLAY_HEIGHT, DISPLAY_HEIGHT - 1U - y, x);
+                    break;
+
+                default:
+                    pixel = test_get(src, DISPLAY_WIDTH, x, y);
+                    break;
+            }
+
+            if (pixel)
+            {
+                dst[y * (DISPLAY_WIDTH / 8U) + x / 8U] |= 0x80U >> (x % 8U);
+            }
+        }
+    }
+}
+
+static void test_rotate(const uint8_t* src, uint8_t* dst, frame_rotation_t rotation)
+{
+    for (uint16_t band = 0; band < BAND_COUNT; band++)
+    {
+        frame_rotate_band(src, dst + band * FRAME_ROTATE_BAND_SIZE, band, rotation);
+    }
+}
+
+int main(void)
+{
+    char what[64];
+
+    srand(1);
+    for (uint32_t i = 0; i < sizeof(plane); i++)
+    {
+        plane[i] = rand();
+    }
+
+    for (uint8_t rotation = FRAME_ROTATION_0; rotation <= FRAME_ROTATION_270; rotation++)
+    {
+        test_reference(plane, expected, rotation);
+        memset(rotated, 0xAA, sizeof(rotated));
+        test_rotate(plane, rotated, rotation);
+
+        snprintf(what, sizeof(what), "rotation %s, random plane", rotation_names[rotation]);
+        test_expect(memcmp(rotated, expected, sizeof(expected)) == 0, what);
+    }
+
+    // Turning twice by a half or four times by a quarter gives the plane back
+    test_rotate(plane, rotated, FRAME_ROTATION_180);
+    test_rotate(rotated, expected, FRAME_ROTATION_180);
+    test_expect(memcmp(plane, expected, sizeof(plane)) == 0, "two half turns");
+
+    // Throughput of a whole plane, band by band as the driver asks for them
+    for (uint8_t rotation = FRAME_ROTATION_0; rotation <= FRAME_ROTATION_270; rotation++)
+    {
+        double us = TEST_BENCH_US(BENCH_ITERATIONS, test_rotate(plane, rotated, rotation));
+
+        printf("rotation %-3s %7.1f us per plane (%u x %u)\n", rotation_names[rotation], us, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    }
+
+    return test_result();
+}
@@ -0,0 +1,314 @@
+/*
+ *  PaperFrame
+ *  Host test and benchmark of packed 2-bpp uploads: checks the plane split against a per-pixel reference
+ *  and deltas against a stored base
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_rom_crc.h"
+
+#include "display_config.h"
+#include "display_manager.h"
+#include "frame_store.h"
+#include "frame_upload.h"
+
+#include "test.h"
+
+#define BENCH_ITERATIONS    500U
+
+static uint8_t  framebuffer[FRAMEBUFFER_SIZE];
+static uint8_t  payload[FRAMEBUFFER_SIZE];
+static uint8_t  expected[FRAMEBUFFER_SIZE];
+
+// A store of one frame, in slot 0
+static uint8_t              stored[FRAMEBUFFER_SIZE];
+static frame_store_entry_t  stored_entry;
+static frame_rotation_t     rotation = FRAME_ROTATION_0;
+static bool                 stored_readable = true;
+
+// CRC32 of the ROM, with a table: the bitwise one of the simulator would take most of the time measured
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len)
+{
+    static uint32_t table[256];
+
+    if (table[1] == 0)
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (uint8_t k = 0; k < 8; k++)
+            {
+                c = (c >> 1) ^ (0xEDB88320U & -(c & 1U));
+            }
+            table[n] = c;
+        }
+    }
+
+    crc = ~crc;
+    while (len--)
+    {
+        crc = table[(crc ^ *buf++) & 0xFFU] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Only what frame_upload uses
+uint8_t* display_manager_get_framebuffer(void)
+{
+    return framebuffer;
+}
+
+void display_manager_set_rotation(frame_rotation_t r)
+{
+    rotation = r;
+}
+
+frame_rotation_t display_manager_get_rotation(void)
+{
+    return rotation;
+}
+
+bool frame_store_get(uint8_t id, frame_store_entry_t* entry)
+{
+    *entry = stored_entry;
+    return (id == 0);
+}
+
+bool frame_store_load(uint8_t id, uint8_t* buff)
+{
+    memcpy(buff, stored, sizeof(stored));
+    return (id == 0) && stored_readable;
+}
+
+// Split one pixel at a time: pixel n is bits 7-2k..6-2k of byte n/4, bit 0 white, bit 1 red
+static void test_reference(const uint8_t* packed, uint8_t* planes)
+{
+    memset(planes, 0, FRAMEBUFFER_SIZE);
+
+    for (uint32_t n = 0; n < DISPLAY_WIDTH * DISPLAY_HEIGHT; n++)
+    {
+        uint8_t pixel = (packed[n / 4U] >> (6U - 2U * (n % 4U))) & 0x3U;
+        uint8_t bit   = 0x80U >> (n % 8U);
+
+        if (pixel & 0x1U)
+        {
+            planes[n / 8U] |= bit;
+        }
+        if (pixel & 0x2U)
+        {
+            planes[FRAMEBUFFER_PLANE_SIZE + n / 8U] |= bit;
+        }
+    }
+}
+
+// Upload the payload with an encoding, in chunks of chunk bytes, random sizes up to 64 if 0
+// The header CRC is off by crc_error
+static bool test_upload_encoding(frame_encoding_t encoding, uint32_t chunk, uint32_t crc_error)
+{
+    frame_upload_header_t header = {
+        .magic      = { FRAME_UPLOAD_MAGIC_0, FRAME_UPLOAD_MAGIC_1 },
+        .version    = FRAME_UPLOAD_VERSION,
+        .encoding   = encoding,
+        .width      = DISPLAY_WIDTH,
+        .height     = DISPLAY_HEIGHT,
+        .planes     = FRAME_PLANE_BW | FRAME_PLANE_RED,
+        .crc32      = esp_rom_crc32_le(0, payload, FRAMEBUFFER_SIZE) ^ crc_error,
+    };
+
+    if (!frame_upload_begin((const uint8_t*) &header, FRAME_UPLOAD_HEADER_SIZE + FRAMEBUFFER_SIZE))
+    {
+        return false;
+    }
+
+    for (uint32_t pos = 0; pos < FRAMEBUFFER_SIZE; )
+    {
+        uint32_t len = chunk ? chunk : 1U + (uint32_t) rand() % 64U;
+        if (len > FRAMEBUFFER_SIZE - pos)
+        {
+            len = FRAMEBUFFER_SIZE - pos;
+        }
+
+        if (!frame_upload_write(payload + pos, len))
+        {
+            return false;
+        }
+        pos += len;
+    }
+
+    return frame_upload_end();
+}
+
+// Upload a delta of len bytes from payload, in one chunk, for a frame turned by r
+static bool test_upload_delta(uint32_t len, frame_rotation_t r, uint32_t crc_error)
+{
+    bool portrait = (r == FRAME_ROTATION_90) || (r == FRAME_ROTATION_270);
+    frame_upload_header_t header = {
+        .magic      = { FRAME_UPLOAD_MAGIC_0, FRAME_UPLOAD_MAGIC_1 },
+        .version    = FRAME_UPLOAD_VERSION,
+        .encoding   = FRAME_ENCODING_XOR_DELTA,
+        .width      = portrait ? DISPLAY_HEIGHT : DISPLAY_WIDTH,
+        .height     = portrait ? DISPLAY_WIDTH : DISPLAY_HEIGHT,
+        .planes     = FRAME_PLANE_BW | FRAME_PLANE_RED,
+        .rotation   = r,
+        .crc32      = esp_rom_crc32_le(0, payload, len) ^ crc_error,
+    };
+
+    return frame_upload_begin((const uint8_t*) &header, FRAME_UPLOAD_HEADER_SIZE + len)
+           && frame_upload_write(payload, len) && frame_upload_end();
+}
+
+// Delta against the stored frame: its CRC, then one record XORing 4 bytes at offset, in payload
+static uint32_t test_delta(uint32_t offset)
+{
+    uint32_t crc = esp_rom_crc32_le(0, stored, sizeof(stored));
+    uint32_t len = 0;
+
+    memcpy(payload, &crc, sizeof(crc));
+    len += sizeof(crc);
+
+    // Skip and count as LEB128
+    for (uint32_t value = offset; ; value >>= 7)
+    {
+        payload[len++] = (value & 0x7FU) | ((value > 0x7FU) ? 0x80U : 0);
+        if (value <= 0x7FU)
+        {
+            break;
+        }
+    }
+    payload[len++] = 4;
+    memset(payload + len, 0xFF, 4);
+
+    return len + 4U;
+}
+
+static bool test_upload(uint32_t chunk)
+{
+    return test_upload_encoding(FRAME_ENCODING_PACKED_2BPP, chunk, 0);
+}
+
+// Time of an upload in one chunk, in us
+static double test_bench(frame_encoding_t encoding)
+{
+    return TEST_BENCH_US(BENCH_ITERATIONS, test_upload_encoding(encoding, sizeof(payload), 0));
+}
+
+// Upload and compare with the reference split
+static bool test_frame(uint32_t chunk)
+{
+    test_reference(payload, expected);
+    memset(framebuffer, 0xAA, sizeof(framebuffer));
+
+    return test_upload(chunk) && (memcmp(framebuffer, expected, FRAMEBUFFER_SIZE) == 0);
+}
+
+int main(void)
+{
+    const uint32_t words = FRAMEBUFFER_SIZE / 4U;
+    bool ok;
+
+    srand(1);
+
+    // Exhaustive: every value of each half of a 32-bit word, 16 pixels, in both halves at once
+    ok = true;
+    for (uint32_t first = 0; first < 0x10000U; first += words)
+    {
+        for (uint32_t i = 0; i < words; i++)
+        {
+            uint32_t value = (first + i) & 0xFFFFU;
+            payload[4U * i]      = value >> 8;
+            payload[4U * i + 1U] = value;
+            payload[4U * i + 2U] = (value ^ 0x5A5AU) >> 8;
+            payload[4U * i + 3U] = value ^ 0x5A5AU;
+        }
+        ok &= test_frame(sizeof(payload));
+    }
+    test_expect(ok, "every 16-bit half-word pattern");
+
+    // Chunks that cut words anywhere, the tail is carried to the next chunk
+    for (uint32_t i = 0; i < FRAMEBUFFER_SIZE; i++)
+    {
+        payload[i] = rand();
+    }
+    ok = true;
+    for (uint32_t chunk = 1; chunk <= 9; chunk++)
+    {
+        ok &= test_frame(chunk);
+    }
+    test_expect(ok, "random frame, chunks of 1 to 9 bytes");
+    test_expect(test_frame(0), "random frame, random chunks");
+    test_expect(test_frame(1436), "random frame, TCP segment chunks");
+
+    // A payload that does not match its CRC is refused
+    test_expect(!test_upload_encoding(FRAME_ENCODING_PACKED_2BPP, sizeof(payload), 1U), "CRC mismatch refused");
+
+    // Deltas: the stored frame, turned, is not in the framebuffer
+    for (uint32_t i = 0; i < FRAMEBUFFER_SIZE; i++)
+    {
+        stored[i] = rand();
+    }
+    stored_entry = (frame_store_entry_t) {
+        .id         = 0,
+        .rotation   = FRAME_ROTATION_90,
+        .crc32      = esp_rom_crc32_le(0, stored, sizeof(stored)),
+    };
+
+    uint16_t first_row, last_row;
+    uint32_t offset = 10U * (DISPLAY_HEIGHT / 8U);     // Row 10 of the portrait frame
+    uint32_t len = test_delta(offset);
+
+    memcpy(expected, stored, sizeof(expected));
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        expected[offset + i] ^= 0xFFU;
+    }
+
+    memset(framebuffer, 0xAA, sizeof(framebuffer));
+    rotation = FRAME_ROTATION_90;
+    ok = test_upload_delta(len, FRAME_ROTATION_90, 0) && (memcmp(framebuffer, expected, FRAMEBUFFER_SIZE) == 0);
+    ok &= frame_upload_changed_rows(&first_row, &last_row) && (first_row == 0) && (last_row == DISPLAY_WIDTH - 1U);
+    test_expect(ok, "delta against a stored frame changes every row");
+
+    // Against the framebuffer, as it is shown, only its row changes
+    memcpy(framebuffer, stored, sizeof(framebuffer));
+    rotation = FRAME_ROTATION_90;
+    ok = test_upload_delta(len, FRAME_ROTATION_90, 0) && (memcmp(framebuffer, expected, FRAMEBUFFER_SIZE) == 0);
+    ok &= frame_upload_changed_rows(&first_row, &last_row) && (first_row == 10) && (last_row == 10);
+    test_expect(ok, "delta against the framebuffer changes its rows");
+
+    // A payload that does not match its CRC was applied, the base is read again
+    memset(framebuffer, 0xAA, sizeof(framebuffer));
+    rotation = FRAME_ROTATION_0;
+    ok = !test_upload_delta(len, FRAME_ROTATION_0, 1U) && (memcmp(framebuffer, stored, FRAMEBUFFER_SIZE) == 0);
+    ok &= (rotation == FRAME_ROTATION_90);
+    test_expect(ok, "delta CRC mismatch restores the stored base");
+
+    // A base the store cannot give back is reported missing
+    memcpy(framebuffer, stored, sizeof(framebuffer));
+    stored_readable = false;
+    ok = !test_upload_delta(len, FRAME_ROTATION_90, 1U) && frame_upload_base_missing();
+    stored_readable = true;
+    test_expect(ok, "delta CRC mismatch with the base lost reported");
+
+    // A base only in the framebuffer could not be restored, the delta is refused before it changes it
+    memcpy(framebuffer, stored, sizeof(framebuffer));
+    framebuffer[0] ^= 0xFFU;
+    memcpy(expected, framebuffer, sizeof(expected));
+    uint32_t unstored_crc = esp_rom_crc32_le(0, framebuffer, sizeof(framebuffer));
+    memcpy(payload, &unstored_crc, sizeof(unstored_crc));
+    ok = !test_upload_delta(len, FRAME_ROTATION_90, 0) && frame_upload_base_missing();
+    ok &= (memcmp(framebuffer, expected, FRAMEBUFFER_SIZE) == 0);
+    test_expect(ok, "delta against a framebuffer not stored refused");
+
+    // Throughput, whole frame in one chunk. Planar is a copy, the difference is the split
+    double packed_us = test_bench(FRAME_ENCODING_PACKED_2BPP);
+    double planar_us = test_bench(FRAME_ENCODING_PLANAR);
+
+    printf("packed upload %.1f us, planar %.1f us per frame, split %.1f us (%u x %u)\n",
+           packed_us, planar_us, packed_us - planar_us, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+    return test_result();
+}
@@ -0,0 +1,267 @@
+/*
+ *  PaperFrame
+ *  Minimal HTTP/1.1 client for the host tools, over kept-alive connections
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "http_client.h"
+
+// Responses are read here, the tools use one connection at a time
+static char response[1 << 20];
+
+int http_connect(const char* host, uint16_t port)
+{
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo* addr;
+    char service[8];
+
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host, service, &hints, &addr) != 0)
+    {
+        return -1;
+    }
+
+    int sock = socket(addr->ai_family, addr->ai_socktype, 0);
+    if ((sock < 0) || (connect(sock, addr->ai_addr, addr->ai_addrlen) < 0))
+    {
+        freeaddrinfo(addr);
+        if (sock >= 0)
+        {
+            close(sock);
+        }
+        return -1;
+    }
+    freeaddrinfo(addr);
+
+    int one = 1;
+    struct timeval timeout = { .tv_sec = 30 };
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    return sock;
+}
+
+bool http_send(int sock, const void* data, size_t len)
+{
+    const char* p = data;
+    while (len > 0)
+    {
+        ssize_t sent = send(sock, p, len, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            return false;
+        }
+        p   += sent;
+        len -= sent;
+    }
+
+    return true;
+}
+
+// Read until at least need bytes are in the buffer
+static bool http_fill(int sock, size_t* have, size_t need)
+{
+    if (need >= sizeof(response))
+    {
+        return false;
+    }
+
+    while (*have < need)
+    {
+        ssize_t len = recv(sock, response + *have, sizeof(response) - 1 - *have, 0);
+        if (len <= 0)
+        {
+            return false;
+        }
+        *have += len;
+    }
+
+    return true;
+}
+
+int http_response(int sock, const char** body, size_t* body_len)
+{
+    size_t have = 0;
+    char*  end  = NULL;
+
+    // Headers
+    while (end == NULL)
+    {
+        if (!http_fill(sock, &have, have + 1))
+        {
+            return -1;
+        }
+        response[have] = '\0';
+        end = strstr(response, "\r\n\r\n");
+    }
+
+    // Only look at the headers
+    *end = '\0';
+    int status = atoi(response + 9);
+    bool chunked = (strstr(response, "Transfer-Encoding: chunked") != NULL);
+    const char* length = strstr(response, "Content-Length:");
+    size_t pos = end + 4 - response;
+
+    if (!chunked)
+    {
+        size_t total = pos + (length ? strtoul(length + 15, NULL, 10) : 0);
+        if (!http_fill(sock, &have, total))
+        {
+            return -1;
+        }
+        response[total] = '\0';
+
+        if (body != NULL)
+        {
+            *body = response + pos;
+        }
+        if (body_len != NULL)
+        {
+            *body_len = total - pos;
+        }
+        return status;
+    }
+
+    // Chunks, each one moved out of the buffer once counted
+    size_t count = 0;
+    memmove(response, response + pos, have - pos);
+    have -= pos;
+    for (;;)
+    {
+        char* line_end;
+        while ((line_end = memmem(response, have, "\r\n", 2)) == NULL)
+        {
+            if (!http_fill(sock, &have, have + 1))
+            {
+                return -1;
+            }
+        }
+
+        size_t chunk = strtoul(response, NULL, 16);
+        size_t need  = line_end + 2 - response + chunk + 2;
+        if (!http_fill(sock, &have, need))
+        {
+            return -1;
+        }
+
+        memmove(response, response + need, have - need);
+        have  -= need;
+        count += chunk;
+        if (chunk == 0)
+        {
+            if (body != NULL)
+            {
+                *body = NULL;
+            }
+            if (body_len != NULL)
+            {
+                *body_len = count;
+            }
+            return status;
+        }
+    }
+}
+
+int http_get(int sock, const char* uri, const char** body, size_t* body_len)
+{
+    char request[256];
+    int len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: paperframe.io\r\n\r\n", uri);
+    if (!http_send(sock, request, len))
+    {
+        return -1;
+    }
+
+    return http_response(sock, body, body_len);
+}
+
+static bool http_send_post(int sock, const char* uri, const void* data, size_t len)
+{
+    char request[256];
+    int head_len = snprintf(request, sizeof(request),
+                            "POST %s HTTP/1.1\r\nHost: paperframe.io\r\nContent-Length: %zu\r\n\r\n", uri, len);
+    return http_send(sock, request, head_len) && http_send(sock, data, len);
+}
+
+int http_post(int sock, const char* uri, const void* data, size_t len)
+{
+    return http_send_post(sock, uri, data, len) ? http_response(sock, NULL, NULL) : -1;
+}
+
+int http_upload(int sock, const char* uri, const void* data, size_t len, double timeout_s)
+{
+    const char* body;
+    unsigned long id;
+
+    int status = http_send_post(sock, uri, data, len) ? http_response(sock, &body, NULL) : -1;
+    if (status != 200)
+    {
+        return status;
+    }
+    if ((body == NULL) || (sscanf(body, "{\"job\":%lu}", &id) != 1))
+    {
+        return -1;
+    }
+
+    // Each request returns when the job moves on, or after a few seconds
+    char state[16] = "receiving";
+    time_t start = time(NULL);
+    while (difftime(time(NULL), start) <= timeout_s)
+    {
+        char uri_job[64];
+        snprintf(uri_job, sizeof(uri_job), "/jobs/%lu?after=%s", id, state);
+        if (http_get(sock, uri_job, &body, NULL) != 200)
+        {
+            return -1;
+        }
+
+        const char* value = (body != NULL) ? strstr(body, "\"state\":\"") : NULL;
+        if ((value == NULL) || (sscanf(value, "\"state\":\"%15[a-z]", state) != 1))
+        {
+            return -1;
+        }
+
+        if (strcmp(state, "refreshed") == 0)
+        {
+            return 200;
+        }
+        if (strcmp(state, "failed") == 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+long http_metric(int sock, const char* name)
+{
+    const char* body;
+    if ((http_get(sock, "/metrics", &body, NULL) != 200) || (body == NULL))
+    {
+        return -1;
+    }
+
+    // Lines are "<name> <count> ..."
+    size_t name_len = strlen(name);
+    for (const char* line = body; line != NULL; line = strchr(line, '\n'))
+    {
+        line += (*line == '\n');
+        if ((strncmp(line, name, name_len) == 0) && (line[name_len] == ' '))
+        {
+            return strtol(line + name_len + 1, NULL, 10);
+        }
+    }
+
+    return -1;
+}
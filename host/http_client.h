@@ -0,0 +1,29 @@
+/*
+ *  PaperFrame
+ *  Minimal HTTP/1.1 client for the host tools, over kept-alive connections
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Connect to a frame or a simulator, -1 on error
+int     http_connect(const char* host, uint16_t port);
+
+bool    http_send(int sock, const void* data, size_t len);
+
+// Read a response, return its status, -1 on error
+// A body sent with its length is kept until the next call, chunked ones are only counted
+int     http_response(int sock, const char** body, size_t* body_len);
+
+int     http_get(int sock, const char* uri, const char** body, size_t* body_len);
+int     http_post(int sock, const char* uri, const void* data, size_t len);
+
+// POST an upload and long-poll its update job, see GET /jobs/<id>
+// Return 200 once the frame is shown, 0 if it is not within timeout_s, the status of a refused upload, else -1
+int     http_upload(int sock, const char* uri, const void* data, size_t len, double timeout_s);
+
+// Count of a /metrics line, like "refresh" for the panel refreshes, -1 on error
+long    http_metric(int sock, const char* name);
@@ -0,0 +1,16 @@
+// Host build: no wake up pin, the simulator wakes up by itself
+#pragma once
+
+#include "esp_err.h"
+
+static inline esp_err_t rtc_gpio_pullup_en(int gpio)
+{
+    (void) gpio;
+    return ESP_OK;
+}
+
+static inline esp_err_t rtc_gpio_pulldown_dis(int gpio)
+{
+    (void) gpio;
+    return ESP_OK;
+}
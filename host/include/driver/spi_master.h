@@ -0,0 +1,2 @@
+// Host build: the panel is simulated above the SPI bus, see sim_panel.c
+#pragma once
@@ -0,0 +1,39 @@
+// Host build: TJpgDec of the ESP32 ROM, decoded with libjpeg by sim_tjpgd.c
+// Output is RGB888, blocks of one MCU given left to right, top to bottom
+#pragma once
+
+#include <stdint.h>
+
+typedef enum
+{
+    JDR_OK = 0,     // Succeeded
+    JDR_INTR,       // Interrupted by the output function
+    JDR_INP,        // Input stream ended or failed
+    JDR_MEM1,       // Not enough memory in the pool
+    JDR_MEM2,       // Input buffer too small
+    JDR_PAR,        // Wrong parameter
+    JDR_FMT1,       // Data format error
+    JDR_FMT2,       // Right format but not supported
+    JDR_FMT3,       // Not supported JPEG standard, progressive
+} JRESULT;
+
+typedef struct
+{
+    uint16_t    left, right, top, bottom;
+} JRECT;
+
+typedef struct JDEC JDEC;
+
+struct JDEC
+{
+    uint8_t     scale;          // Output scale, 1/(1 << scale)
+    uint8_t     msx, msy;       // MCU size in blocks of 8x8 pixels
+    uint16_t    width, height;  // Picture size in pixels
+    void*       pool;           // Work pool given to jd_prepare
+    uint32_t    sz_pool;
+    uint32_t    (*infunc)(JDEC*, uint8_t*, uint32_t);
+    void*       device;         // Context of the caller
+};
+
+JRESULT jd_prepare(JDEC* jd, uint32_t (*infunc)(JDEC*, uint8_t*, uint32_t), void* pool, uint32_t sz_pool, void* dev);
+JRESULT jd_decomp(JDEC* jd, uint32_t (*outfunc)(JDEC*, void*, JRECT*), uint8_t scale);
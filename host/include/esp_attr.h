@@ -0,0 +1,6 @@
+// Host build: no memory sections, RTC memory is lost when the simulator restarts
+#pragma once
+
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
+#define DRAM_ATTR
@@ -0,0 +1,117 @@
+// Host build: the subset of the ESP-IDF HTTP server we use, on POSIX sockets, see sim_httpd.c
+// Like on the device, a single task serves all sockets, one request at a time
+#pragma once
+
+#include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "esp_err.h"
+
+#define HTTPD_MAX_URI_LEN       512
+
+#define HTTPD_SOCK_ERR_FAIL     -1
+#define HTTPD_SOCK_ERR_INVALID  -2
+#define HTTPD_SOCK_ERR_TIMEOUT  -3
+
+typedef void* httpd_handle_t;
+
+typedef enum
+{
+    HTTP_DELETE = 0,
+    HTTP_GET    = 1,
+    HTTP_HEAD   = 2,
+    HTTP_POST   = 3,
+    HTTP_PUT    = 4,
+} httpd_method_t;
+
+typedef enum
+{
+    HTTPD_500_INTERNAL_SERVER_ERROR = 0,
+    HTTPD_501_METHOD_NOT_IMPLEMENTED,
+    HTTPD_505_VERSION_NOT_SUPPORTED,
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_401_UNAUTHORIZED,
+    HTTPD_403_FORBIDDEN,
+    HTTPD_404_NOT_FOUND,
+    HTTPD_405_METHOD_NOT_ALLOWED,
+    HTTPD_408_REQ_TIMEOUT,
+    HTTPD_411_LENGTH_REQUIRED,
+    HTTPD_414_URI_TOO_LONG,
+    HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE,
+} httpd_err_code_t;
+
+typedef bool (*httpd_uri_match_func_t)(const char* reference_uri, const char* uri_to_match, size_t match_upto);
+
+typedef struct
+{
+    uint16_t                server_port;        // Set from the simulator --http-port
+    uint16_t                max_open_sockets;
+    uint16_t                max_uri_handlers;
+    uint16_t                recv_wait_timeout;  // In seconds
+    uint16_t                send_wait_timeout;
+    size_t                  stack_size;
+    bool                    lru_purge_enable;
+    httpd_uri_match_func_t  uri_match_fn;
+} httpd_config_t;
+
+extern uint16_t sim_http_port;
+
+#define HTTPD_DEFAULT_CONFIG() {            \
+        .server_port        = sim_http_port,\
+        .max_open_sockets   = 7,            \
+        .max_uri_handlers   = 8,            \
+        .recv_wait_timeout  = 5,            \
+        .send_wait_timeout  = 5,            \
+        .stack_size         = 4096,         \
+        .lru_purge_enable   = false,        \
+        .uri_match_fn       = NULL,         \
+    }
+
+typedef struct httpd_req
+{
+    httpd_handle_t  handle;
+    int             method;
+    const char      uri[HTTPD_MAX_URI_LEN + 1];
+    size_t          content_len;
+    void*           aux;                // Connection state of the simulator
+    void*           user_ctx;
+} httpd_req_t;
+
+typedef struct httpd_uri
+{
+    const char*     uri;
+    httpd_method_t  method;
+    esp_err_t       (*handler)(httpd_req_t* r);
+    void*           user_ctx;
+} httpd_uri_t;
+
+esp_err_t   httpd_start(httpd_handle_t* handle, const httpd_config_t* config);
+esp_err_t   httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler);
+bool        httpd_uri_match_wildcard(const char* uri_template, const char* uri_to_match, size_t match_upto);
+
+// The copy is answered from another task, the socket is served again once it completes
+esp_err_t   httpd_req_async_handler_begin(httpd_req_t* r, httpd_req_t** out);
+esp_err_t   httpd_req_async_handler_complete(httpd_req_t* r);
+
+int         httpd_req_recv(httpd_req_t* r, char* buf, size_t buf_len);
+esp_err_t   httpd_req_get_url_query_str(httpd_req_t* r, char* buf, size_t buf_len);
+esp_err_t   httpd_query_key_value(const char* qry, const char* key, char* val, size_t val_size);
+
+esp_err_t   httpd_resp_set_type(httpd_req_t* r, const char* type);
+esp_err_t   httpd_resp_set_status(httpd_req_t* r, const char* status);
+esp_err_t   httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t buf_len);
+esp_err_t   httpd_resp_send_chunk(httpd_req_t* r, const char* buf, ssize_t buf_len);
+esp_err_t   httpd_resp_send_err(httpd_req_t* req, httpd_err_code_t error, const char* msg);
+
+static inline esp_err_t httpd_resp_sendstr(httpd_req_t* r, const char* str)
+{
+    return httpd_resp_send(r, str, (str == NULL) ? 0 : (ssize_t) __builtin_strlen(str));
+}
+
+static inline esp_err_t httpd_resp_sendstr_chunk(httpd_req_t* r, const char* str)
+{
+    return httpd_resp_send_chunk(r, str, (str == NULL) ? 0 : (ssize_t) __builtin_strlen(str));
+}
@@ -0,0 +1,26 @@
+// Host build: ESP-IDF logging on stderr
+#pragma once
+
+#include <stdio.h>
+
+typedef enum
+{
+    ESP_LOG_NONE = 0,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) fprintf(stderr, "I %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) do {} while (0)
+
+// Every level is shown
+static inline void esp_log_level_set(const char* tag, esp_log_level_t level)
+{
+    (void) tag;
+    (void) level;
+}
@@ -0,0 +1,9 @@
+// Host build: all memory is DMA capable
+#pragma once
+
+#include <stdbool.h>
+
+static inline bool esp_ptr_dma_capable(const void* p)
+{
+    return p != NULL;
+}
@@ -0,0 +1,42 @@
+// Host build: a single interface with the default softAP address, 192.168.4.1
+#pragma once
+
+#include <stdint.h>
+
+#include "lwip/sockets.h"
+
+typedef struct { uint32_t addr; } esp_ip4_addr_t;
+
+typedef struct
+{
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+typedef struct esp_netif_obj esp_netif_t;
+
+static inline int esp_netif_init(void)
+{
+    return 0;
+}
+
+static inline esp_netif_t* esp_netif_create_default_wifi_ap(void)
+{
+    return NULL;
+}
+
+static inline esp_netif_t* esp_netif_get_handle_from_ifkey(const char* if_key)
+{
+    (void) if_key;
+    return NULL;
+}
+
+static inline int esp_netif_get_ip_info(esp_netif_t* esp_netif, esp_netif_ip_info_t* ip_info)
+{
+    (void) esp_netif;
+    ip_info->ip.addr      = htonl(0xC0A80401);
+    ip_info->netmask.addr = htonl(0xFFFFFF00);
+    ip_info->gw.addr      = htonl(0xC0A80401);
+    return 0;
+}
@@ -0,0 +1,15 @@
+// Host build: deep sleep ends the simulator, or restarts it with --wake
+#pragma once
+
+#include "esp_err.h"
+
+typedef enum
+{
+    ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+    ESP_SLEEP_WAKEUP_ALL,
+    ESP_SLEEP_WAKEUP_EXT0,
+} esp_sleep_wakeup_cause_t;
+
+esp_sleep_wakeup_cause_t    esp_sleep_get_wakeup_cause(void);
+esp_err_t                   esp_sleep_enable_ext0_wakeup(int gpio, int level);
+void                        esp_deep_sleep_start(void) __attribute__((noreturn));
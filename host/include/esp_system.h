@@ -0,0 +1,22 @@
+// Host build: reset reason set by the simulator
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+typedef enum
+{
+    ESP_RST_UNKNOWN = 0,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+} esp_reset_reason_t;
+
+esp_reset_reason_t esp_reset_reason(void);
@@ -0,0 +1,15 @@
+// Host build: esp_timer time is the monotonic clock, from esp_timer_boot_us when set
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// Monotonic time of the boot, set by hosts that simulate one
+__attribute__((weak)) int64_t esp_timer_boot_us = 0;
+
+static inline int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000 - esp_timer_boot_us;
+}
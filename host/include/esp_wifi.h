@@ -0,0 +1,78 @@
+// Host build: no radio, the softAP start is reported right away and a station joins with the first HTTP client
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+
+extern esp_event_base_t const WIFI_EVENT;
+
+typedef enum
+{
+    WIFI_EVENT_AP_START = 12,
+    WIFI_EVENT_AP_STOP,
+    WIFI_EVENT_AP_STACONNECTED,
+    WIFI_EVENT_AP_STADISCONNECTED,
+} wifi_event_t;
+
+typedef enum
+{
+    WIFI_MODE_NULL = 0,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA,
+} wifi_mode_t;
+
+typedef enum
+{
+    WIFI_IF_STA = 0,
+    WIFI_IF_AP,
+} wifi_interface_t;
+
+#define ESP_IF_WIFI_STA         WIFI_IF_STA
+#define ESP_IF_WIFI_AP          WIFI_IF_AP
+
+typedef enum
+{
+    WIFI_AUTH_OPEN = 0,
+    WIFI_AUTH_WEP,
+    WIFI_AUTH_WPA_PSK,
+    WIFI_AUTH_WPA2_PSK,
+} wifi_auth_mode_t;
+
+typedef struct
+{
+    int     unused;
+} wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT()  { 0 }
+
+typedef struct
+{
+    uint8_t             ssid[32];
+    uint8_t             password[64];
+    uint8_t             ssid_len;
+    uint8_t             channel;
+    wifi_auth_mode_t    authmode;
+    uint8_t             max_connection;
+} wifi_ap_config_t;
+
+typedef union
+{
+    wifi_ap_config_t    ap;
+} wifi_config_t;
+
+typedef struct
+{
+    uint8_t     mac[6];
+    uint8_t     aid;
+} wifi_event_ap_staconnected_t;
+
+typedef wifi_event_ap_staconnected_t wifi_event_ap_stadisconnected_t;
+
+esp_err_t esp_wifi_init(const wifi_init_config_t* config);
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t* config);
+esp_err_t esp_wifi_start(void);
+esp_err_t esp_wifi_stop(void);
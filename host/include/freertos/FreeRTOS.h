@@ -0,0 +1,32 @@
+// Host build: FreeRTOS tasks run as POSIX threads
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+typedef int         BaseType_t;
+typedef unsigned    UBaseType_t;
+typedef uint32_t    TickType_t;
+typedef void*       TaskHandle_t;
+typedef void        (*TaskFunction_t)(void*);
+
+#define pdPASS      1
+#define pdFAIL      0
+#define pdTRUE      1
+#define pdFALSE     0
+
+// Same tick as the firmware
+#define configTICK_RATE_HZ      100
+#define portTICK_PERIOD_MS      (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY           ((TickType_t) 0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms)       ((TickType_t) ((ms) * configTICK_RATE_HZ / 1000))
+
+// Spinlocks of critical sections are mutexes
+typedef pthread_mutex_t portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    PTHREAD_MUTEX_INITIALIZER
+
+// Every thread runs on core 0
+static inline BaseType_t xPortGetCoreID(void)
+{
+    return 0;
+}
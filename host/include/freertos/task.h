@@ -0,0 +1,163 @@
+// Host build: FreeRTOS tasks run as detached POSIX threads
+#pragma once
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+
+// Kept for the life of the program, the handle of the task
+typedef struct
+{
+    TaskFunction_t  code;
+    void*           param;
+    pthread_mutex_t lock;
+    pthread_cond_t  notified;
+    uint32_t        notifications;
+} host_task_t;
+
+static __thread host_task_t* host_task_current = NULL;
+
+static inline void* host_task_entry(void* arg)
+{
+    host_task_t* task = arg;
+    host_task_current = task;
+    task->code(task->param);
+    return NULL;
+}
+
+static inline BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stack_depth,
+                                     void* param, UBaseType_t priority, TaskHandle_t* handle)
+{
+    pthread_t thread;
+    host_task_t* task = calloc(1, sizeof(host_task_t));
+
+    (void) name;
+    (void) stack_depth;
+    (void) priority;
+
+    if (task == NULL)
+    {
+        return pdFAIL;
+    }
+
+    task->code  = code;
+    task->param = param;
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_cond_init(&task->notified, NULL);
+    if (pthread_create(&thread, NULL, host_task_entry, task) != 0)
+    {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+
+    if (handle != NULL)
+    {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+static inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stack_depth,
+                                                 void* param, UBaseType_t priority, TaskHandle_t* handle,
+                                                 BaseType_t core)
+{
+    (void) core;
+    return xTaskCreate(code, name, stack_depth, param, priority, handle);
+}
+
+static inline void vTaskDelete(TaskHandle_t task)
+{
+    (void) task;
+    pthread_exit(NULL);
+}
+
+// Critical sections only keep the other threads out
+#define taskENTER_CRITICAL(mux)         pthread_mutex_lock(mux)
+#define taskEXIT_CRITICAL(mux)          pthread_mutex_unlock(mux)
+
+// Ticks from the monotonic clock
+static inline TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t) (ts.tv_sec * configTICK_RATE_HZ + ts.tv_nsec / (1000000000 / configTICK_RATE_HZ));
+}
+
+static inline void vTaskDelay(TickType_t ticks)
+{
+    usleep(ticks * portTICK_PERIOD_MS * 1000);
+}
+
+// NULL out of the tasks created by xTaskCreate
+static inline TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return host_task_current;
+}
+
+static inline BaseType_t xTaskNotifyGive(TaskHandle_t handle)
+{
+    host_task_t* task = handle;
+
+    pthread_mutex_lock(&task->lock);
+    task->notifications++;
+    pthread_cond_signal(&task->notified);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+// Only from a task created by xTaskCreate
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    host_task_t* task = host_task_current;
+    struct timespec until;
+    int ret = 0;
+
+    clock_gettime(CLOCK_REALTIME, &until);
+    uint64_t ns    = until.tv_nsec + (uint64_t) ticks * portTICK_PERIOD_MS * 1000000U;
+    until.tv_sec  += ns / 1000000000U;
+    until.tv_nsec  = ns % 1000000000U;
+
+    pthread_mutex_lock(&task->lock);
+    while ((task->notifications == 0) && (ret == 0))
+    {
+        ret = (ticks == portMAX_DELAY) ? pthread_cond_wait(&task->notified, &task->lock)
+                                       : pthread_cond_timedwait(&task->notified, &task->lock, &until);
+    }
+
+    uint32_t count = task->notifications;
+    task->notifications = clear ? 0 : (count ? count - 1 : 0);
+    pthread_mutex_unlock(&task->lock);
+
+    return count;
+}
+
+// Task states come from the test defining uxTaskGetSystemState
+typedef enum
+{
+    eRunning = 0,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid,
+} eTaskState;
+
+typedef struct
+{
+    TaskHandle_t    xHandle;
+    const char*     pcTaskName;
+    UBaseType_t     xTaskNumber;
+    eTaskState      eCurrentState;
+    UBaseType_t     uxCurrentPriority;
+    UBaseType_t     uxBasePriority;
+    uint32_t        ulRunTimeCounter;
+    uint8_t*        pxStackBase;
+    uint32_t        usStackHighWaterMark;
+    BaseType_t      xCoreID;
+} TaskStatus_t;
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* status, UBaseType_t count, uint32_t* total_run_time);
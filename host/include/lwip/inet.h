@@ -0,0 +1,12 @@
+// Host build: lwIP address helpers
+#pragma once
+
+#include <stdint.h>
+
+#include "lwip/sockets.h"
+
+static inline char* inet_ntoa_r(uint32_t addr, char* buf, int buflen)
+{
+    struct in_addr in = { .s_addr = addr };
+    return (char*) inet_ntop(AF_INET, &in, buf, buflen);
+}
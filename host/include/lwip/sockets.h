@@ -0,0 +1,8 @@
+// Host build: lwIP sockets are BSD sockets
+#pragma once
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
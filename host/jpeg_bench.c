@@ -0,0 +1,227 @@
+/*
+ *  PaperFrame
+ *  Host benchmark of JPEG uploads: time per frame and peak heap of jpeg_upload.c, decoded by sim_tjpgd.c
+ *  Pictures are encoded with libjpeg and streamed in TCP segments, uniform ones check the dithered planes
+ */
+
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <jpeglib.h>
+
+#include "esp_heap_caps.h"
+
+#include "display_config.h"
+#include "display_manager.h"
+#include "jpeg_upload.h"
+
+#include "test.h"
+
+#define BENCH_ITERATIONS    5U
+#define BENCH_HEAP_SIZE     (100U * 1024U)  // Free heap of the device with the framebuffer and WiFi up
+#define BENCH_SEGMENT_SIZE  1436U           // Bytes per read, as httpd_req_recv gets them
+
+static uint8_t          framebuffer[FRAMEBUFFER_SIZE];
+static frame_rotation_t rotation = FRAME_ROTATION_0;
+
+// Heap of the firmware sources, linked with --wrap: libjpeg and libc allocate from their own calls
+static size_t   heap_used = 0;
+static size_t   heap_peak = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void  __real_free(void* ptr);
+
+static void* bench_count(void* ptr)
+{
+    if (ptr != NULL)
+    {
+        heap_used += malloc_usable_size(ptr);
+        heap_peak  = (heap_used > heap_peak) ? heap_used : heap_peak;
+    }
+    return ptr;
+}
+
+void* __wrap_malloc(size_t size)
+{
+    return bench_count(__real_malloc(size));
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    return bench_count(__real_calloc(count, size));
+}
+
+void __wrap_free(void* ptr)
+{
+    heap_used -= (ptr != NULL) ? malloc_usable_size(ptr) : 0;
+    __real_free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return (heap_used < BENCH_HEAP_SIZE) ? BENCH_HEAP_SIZE - heap_used : 0;
+}
+
+// Only what jpeg_upload and frame_dither use
+uint8_t* display_manager_get_framebuffer(void)
+{
+    return framebuffer;
+}
+
+void display_manager_set_rotation(frame_rotation_t r)
+{
+    rotation = r;
+}
+
+// A JPEG being received
+typedef struct
+{
+    const uint8_t*  data;
+    uint32_t        len;
+    uint32_t        pos;
+} bench_stream_t;
+
+static int bench_read(void* ctx, uint8_t* buff, uint32_t len)
+{
+    bench_stream_t* stream = ctx;
+    uint32_t count = stream->len - stream->pos;
+
+    count = (count < len) ? count : len;
+    count = (count < BENCH_SEGMENT_SIZE) ? count : BENCH_SEGMENT_SIZE;
+    memcpy(buff, stream->data + stream->pos, count);
+    stream->pos += count;
+
+    return count;
+}
+
+// Encode a picture, a photo-like gradient with noise, or a uniform color when rgb is given
+// The buffer is libjpeg's, released with __real_free
+static uint8_t* bench_encode(uint16_t width, uint16_t height, const uint8_t* rgb, bool progressive, unsigned long* len)
+{
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr err;
+    uint8_t* out = NULL;
+    uint8_t* row = __real_malloc(width * 3U);
+
+    cinfo.err = jpeg_std_error(&err);
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &out, len);
+
+    cinfo.image_width       = width;
+    cinfo.image_height      = height;
+    cinfo.input_components  = 3;
+    cinfo.in_color_space    = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 85, TRUE);
+    if (progressive)
+    {
+        jpeg_simple_progression(&cinfo);
+    }
+    jpeg_start_compress(&cinfo, TRUE);
+
+    srand(1);
+    while (cinfo.next_scanline < height)
+    {
+        uint32_t y = cinfo.next_scanline;
+
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint8_t noise = rand() & 0x1FU;
+            row[x * 3U]      = rgb ? rgb[0] : (x * 223U) / width + noise;
+            row[x * 3U + 1U] = rgb ? rgb[1] : (y * 223U) / height + noise;
+            row[x * 3U + 2U] = rgb ? rgb[2] : ((x + y) * 111U) / (width + height) + noise;
+        }
+
+        JSAMPROW rows[1] = { row };
+        jpeg_write_scanlines(&cinfo, rows, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    __real_free(row);
+
+    return out;
+}
+
+// Decode a picture as the JPEG upload handler does
+static bool bench_decode(const uint8_t* data, unsigned long len, frame_palette_t palette)
+{
+    bench_stream_t stream = { .data = data, .len = len };
+
+    return jpeg_upload_decode(bench_read, &stream, palette);
+}
+
+// A uniform picture is dithered to uniform planes
+// JPEG gives pure colors back rounded, red is 254: up to 1% of the pixels may dither to another color
+static bool bench_uniform(const uint8_t rgb[3], uint8_t bw, uint8_t red)
+{
+    unsigned long len;
+    uint8_t* jpeg = bench_encode(64, 48, rgb, false, &len);
+    bool ok = bench_decode(jpeg, len, FRAME_PALETTE_KWR) && (rotation == FRAME_ROTATION_0);
+    uint32_t wrong = 0;
+
+    for (uint32_t i = 0; i < FRAMEBUFFER_PLANE_SIZE; i++)
+    {
+        wrong += __builtin_popcount((framebuffer[i] ^ bw) | (framebuffer[FRAMEBUFFER_PLANE_SIZE + i] ^ red));
+    }
+
+    __real_free(jpeg);
+    return ok && (wrong <= (DISPLAY_WIDTH * DISPLAY_HEIGHT) / 100U);
+}
+
+// Time per frame and peak heap of one picture
+static bool bench_picture(const char* name, uint16_t width, uint16_t height, frame_rotation_t expected)
+{
+    unsigned long len;
+    uint8_t* jpeg = bench_encode(width, height, NULL, false, &len);
+    bool ok = true;
+
+    heap_peak = heap_used;
+    size_t heap_base = heap_used;
+    double us = TEST_BENCH_US(BENCH_ITERATIONS, ok &= bench_decode(jpeg, len, FRAME_PALETTE_KWR));
+
+    char what[64];
+    snprintf(what, sizeof(what), "%s %ux%u decoded", name, width, height);
+    test_expect(ok && (rotation == expected) && (heap_used == heap_base), what);
+    printf("  %lu KiB, %.1f ms per frame, peak heap %zu bytes\n", len / 1024U, us / 1000.0, heap_peak - heap_base);
+
+    __real_free(jpeg);
+    return ok;
+}
+
+int main(void)
+{
+    static const uint8_t white[3] = { 255, 255, 255 };
+    static const uint8_t black[3] = { 0, 0, 0 };
+    static const uint8_t red[3]   = { 255, 0, 0 };
+
+    // jpeg_upload logs every frame
+    freopen("/dev/null", "w", stderr);
+
+    test_expect(bench_uniform(white, 0xFF, 0x00), "white picture, white plane set");
+    test_expect(bench_uniform(black, 0x00, 0x00), "black picture, both planes clear");
+    test_expect(bench_uniform(red, 0x00, 0xFF), "red picture, red plane set");
+
+    unsigned long len;
+    uint8_t* jpeg = bench_encode(DISPLAY_WIDTH, DISPLAY_HEIGHT, NULL, true, &len);
+    test_expect(!bench_decode(jpeg, len, FRAME_PALETTE_KWR), "progressive picture refused");
+    __real_free(jpeg);
+
+    jpeg = bench_encode(DISPLAY_WIDTH, DISPLAY_HEIGHT, NULL, false, &len);
+    test_expect(!bench_decode(jpeg, len / 2U, FRAME_PALETTE_KWR), "truncated picture refused");
+    __real_free(jpeg);
+
+    // Phone photos are decoded at 1/4, the smaller ones upscaled by the sampling
+    bench_picture("landscape photo", 4032, 3024, FRAME_ROTATION_0);
+    bench_picture("portrait photo", 3024, 4032, FRAME_ROTATION_90);
+    bench_picture("landscape", 1600, 1200, FRAME_ROTATION_0);
+    bench_picture("small", 640, 480, FRAME_ROTATION_0);
+    bench_picture("thumbnail", 160, 120, FRAME_ROTATION_0);
+    bench_picture("portrait thumbnail", 120, 160, FRAME_ROTATION_90);
+
+    return test_result();
+}
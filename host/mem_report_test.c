@@ -0,0 +1,108 @@
+/*
+ *  PaperFrame
+ *  Host test of the RAM report: feeds it heaps and tasks and checks its text and budget warnings
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "display_config.h"
+#include "mem_report.h"
+
+#include "test.h"
+
+// Heaps and tasks of the order of an ESP32 with the portal up, framebuffer in static RAM
+static multi_heap_info_t fake_internal  = { .total_free_bytes = 112000, .largest_free_block = 65536, .minimum_free_bytes = 98000 };
+static multi_heap_info_t fake_dma       = { .total_free_bytes = 104000, .largest_free_block = 65536, .minimum_free_bytes = 90000 };
+static multi_heap_info_t fake_32bit     = { .total_free_bytes = 140000, .largest_free_block = 65536, .minimum_free_bytes = 126000 };
+static multi_heap_info_t fake_spiram    = { 0 };
+
+static TaskStatus_t fake_tasks[] = {
+    { .pcTaskName = "main",         .usStackHighWaterMark = 1800 },
+    { .pcTaskName = "httpd",        .usStackHighWaterMark = 1300 },
+    { .pcTaskName = "dns_server",   .usStackHighWaterMark = 2900 },
+    { .pcTaskName = "wifi",         .usStackHighWaterMark = 2200 },
+    { .pcTaskName = "IDLE0",        .usStackHighWaterMark = 700 },
+};
+static UBaseType_t fake_task_count = sizeof(fake_tasks) / sizeof(fake_tasks[0]);
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps)
+{
+    *info = (caps & MALLOC_CAP_SPIRAM) ? fake_spiram
+          : (caps & MALLOC_CAP_DMA) ? fake_dma
+          : (caps & MALLOC_CAP_INTERNAL) ? fake_internal
+          : fake_32bit;
+}
+
+size_t heap_caps_get_total_size(uint32_t caps)
+{
+    return (caps & MALLOC_CAP_SPIRAM) ? 0 : 300000;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* status, UBaseType_t count, uint32_t* total_run_time)
+{
+    if (count < fake_task_count)
+    {
+        return 0;
+    }
+
+    memcpy(status, fake_tasks, fake_task_count * sizeof(TaskStatus_t));
+    return fake_task_count;
+}
+
+int main(void)
+{
+    static mem_report_t report;
+    char text[1024];
+    uint32_t warnings;
+
+    // Nominal
+    mem_report_collect(&report);
+    warnings = mem_report_check(&report, 0);
+    mem_report_format(&report, warnings, text, sizeof(text));
+
+    test_expect(warnings == 0, "nominal budget holds");
+    test_expect(strstr(text, "internal 300000 112000 98000 65536\n") != NULL, "internal heap line");
+    test_expect(strstr(text, "spiram 0 0 0 0\n") != NULL, "empty PSRAM line");
+    test_expect(strstr(text, "# task stack_free\nIDLE0 700\nhttpd 1300\nmain 1800\n") != NULL, "tasks sorted by stack left");
+    test_expect(strstr(text, "warnings none\n") != NULL, "no warnings line");
+
+    // On demand, the framebuffer does not fit the largest block
+    warnings = mem_report_check(&report, FRAMEBUFFER_SIZE);
+    test_expect(warnings == MEM_LOW_BLOCK, "framebuffer without a large enough block");
+
+    fake_dma.largest_free_block = FRAMEBUFFER_SIZE;
+    mem_report_collect(&report);
+    test_expect(mem_report_check(&report, FRAMEBUFFER_SIZE) == 0, "framebuffer in a DMA block");
+
+    fake_dma.largest_free_block = 65536;
+    fake_spiram.largest_free_block = 4000000;
+    mem_report_collect(&report);
+    test_expect(mem_report_check(&report, FRAMEBUFFER_SIZE) == 0, "framebuffer in PSRAM");
+
+    // Tight RAM and stacks
+    fake_internal.minimum_free_bytes = MEM_REPORT_MIN_INTERNAL - 1;
+    fake_tasks[1].usStackHighWaterMark = MEM_REPORT_MIN_STACK - 1;
+    mem_report_collect(&report);
+    warnings = mem_report_check(&report, 0);
+    mem_report_format(&report, warnings, text, sizeof(text));
+    test_expect(warnings == (MEM_LOW_INTERNAL | MEM_LOW_STACK), "low internal RAM and stack");
+    test_expect(strstr(text, "warnings low_internal low_stack\n") != NULL, "warnings line");
+
+    // More tasks than reported
+    fake_task_count = MEM_REPORT_MAX_TASKS + 1;
+    mem_report_collect(&report);
+    test_expect((report.task_count == 0) && (mem_report_check(&report, 0) & MEM_TASKS_UNKNOWN), "too many tasks");
+
+    // Truncated output stays terminated
+    char small[40];
+    size_t len = mem_report_format(&report, 0, small, sizeof(small));
+    test_expect((len == sizeof(small) - 1) && (strlen(small) == len), "truncated report");
+
+    return test_result();
+}
@@ -0,0 +1,24 @@
+/*
+ *  PaperFrame
+ *  Simulator of the whole firmware on Linux, settings shared by its parts
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct
+{
+    const char*     flash_path;     // File of the frames partition
+    const char*     panel_path;     // PNG written at each panel refresh
+    uint32_t        refresh_ms;     // Time a refresh takes, 0 for none
+    bool            wake;           // Restart on deep sleep instead of exiting
+    bool            woken;          // Started by a deep sleep wake up
+    char**          argv;
+} sim_options_t;
+
+extern sim_options_t sim_options;
+
+// Firmware entry point, from main.c
+void app_main(void);
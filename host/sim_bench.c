@@ -0,0 +1,165 @@
+/*
+ *  PaperFrame
+ *  End-to-end benchmark of the simulated frame: page loads, uploads until the panel shows them, and frame downloads
+ *  Start the simulator first, for instance ./paperframe_sim --refresh-ms 0 & ./sim_bench
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "display_config.h"
+#include "http_client.h"
+
+#define PAGE_REQUESTS       2000U
+#define UPLOADS             20U
+#define DOWNLOADS           20U
+#define PANEL_TIMEOUT_S     10.0
+
+// Same layout as frame_upload_header_t
+#define FRAME_WIDTH         DISPLAY_WIDTH
+#define FRAME_HEIGHT        DISPLAY_HEIGHT
+#define FRAME_PLANE_SIZE    (FRAME_WIDTH * FRAME_HEIGHT / 8U)
+#define FRAME_HEADER_SIZE   16U
+#define FRAME_SIZE          (FRAME_HEADER_SIZE + 2U * FRAME_PLANE_SIZE)
+
+static uint16_t port = 8080;
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int bench_compare(const void* a, const void* b)
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+static void bench_print(const char* name, double* times, uint32_t count)
+{
+    qsort(times, count, sizeof(double), bench_compare);
+    printf("%-12s p50 %8.1f us, p99 %8.1f us\n", name, times[count / 2] * 1e6, times[count * 99 / 100] * 1e6);
+}
+
+// A planar frame with both planes, different for each upload, CRC32 as zlib
+static void bench_build_frame(uint8_t* frame, uint32_t seed)
+{
+    uint8_t* payload = frame + FRAME_HEADER_SIZE;
+    uint32_t state   = seed * 2654435761U + 1U;
+    for (uint32_t i = 0; i < 2U * FRAME_PLANE_SIZE; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        payload[i] = state;
+    }
+
+    uint32_t crc = 0xFFFFFFFFU;
+    for (uint32_t i = 0; i < 2U * FRAME_PLANE_SIZE; i++)
+    {
+        crc ^= payload[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1U));
+        }
+    }
+    crc = ~crc;
+
+    const uint8_t header[FRAME_HEADER_SIZE] = {
+        'P', 'F', 1, 0,
+        FRAME_WIDTH & 0xFF, FRAME_WIDTH >> 8, FRAME_HEIGHT & 0xFF, FRAME_HEIGHT >> 8,
+        3, 0, 0, 0,
+        crc, crc >> 8, crc >> 16, crc >> 24,
+    };
+    memcpy(frame, header, sizeof(header));
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1)
+    {
+        port = atoi(argv[1]);
+    }
+
+    int sock = http_connect("127.0.0.1", port);
+    size_t body_len;
+
+    if (sock < 0)
+    {
+        perror("connect");
+        return 1;
+    }
+
+    // Page loads, as the phone does when the portal opens
+    static double page_times[PAGE_REQUESTS];
+    for (uint32_t i = 0; i < PAGE_REQUESTS; i++)
+    {
+        double start = bench_now();
+        if (http_get(sock, "/", NULL, &body_len) != 200)
+        {
+            fprintf(stderr, "GET / failed\n");
+            return 1;
+        }
+        page_times[i] = bench_now() - start;
+    }
+    bench_print("GET /", page_times, PAGE_REQUESTS);
+
+    // Uploads, until the response and until the panel is refreshed
+    static uint8_t frame[FRAME_SIZE];
+    static double upload_times[UPLOADS];
+    static double shown_times[UPLOADS];
+    for (uint32_t i = 0; i < UPLOADS; i++)
+    {
+        bench_build_frame(frame, i);
+        long before = http_metric(sock, "refresh");
+
+        double start = bench_now();
+        if (http_post(sock, "/upload", frame, FRAME_SIZE) != 200)
+        {
+            fprintf(stderr, "POST /upload failed\n");
+            return 1;
+        }
+        upload_times[i] = bench_now() - start;
+
+        while (http_metric(sock, "refresh") == before)
+        {
+            if (bench_now() - start > PANEL_TIMEOUT_S)
+            {
+                fprintf(stderr, "Panel not refreshed\n");
+                return 1;
+            }
+            usleep(200);
+        }
+        shown_times[i] = bench_now() - start;
+    }
+    bench_print("upload", upload_times, UPLOADS);
+    bench_print("shown", shown_times, UPLOADS);
+    printf("upload:      %.1f MB/s\n", FRAME_SIZE / upload_times[UPLOADS / 2] / 1e6);
+
+    // Frame downloads, encoded while sent
+    static double download_times[DOWNLOADS];
+    size_t png_len = 0;
+    for (uint32_t i = 0; i < DOWNLOADS; i++)
+    {
+        double start = bench_now();
+        if (http_get(sock, "/frame.png", NULL, &png_len) != 200)
+        {
+            fprintf(stderr, "GET /frame.png failed\n");
+            return 1;
+        }
+        download_times[i] = bench_now() - start;
+    }
+    bench_print("frame.png", download_times, DOWNLOADS);
+    printf("frame.png:   %zu bytes, %.1f MB/s\n", png_len, png_len / download_times[DOWNLOADS / 2] / 1e6);
+
+    close(sock);
+    return 0;
+}
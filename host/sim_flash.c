@@ -0,0 +1,196 @@
+/*
+ *  PaperFrame
+ *  Simulator: the frames partition of partitions.csv in a file, with NOR flash rules
+ *  Erased bytes are 0xFF and writes only clear bits
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+
+#include "frame_store.h"
+#include "sim.h"
+
+#define SIM_SECTOR_SIZE         4096U
+#define SIM_MAX_MAPS            4U
+
+typedef struct
+{
+    void*   base;
+    size_t  len;
+} sim_map_t;
+
+static const char* TAG = "sim_flash";
+
+static esp_partition_t frames = {
+    .type       = ESP_PARTITION_TYPE_DATA,
+    .subtype    = FRAME_STORE_SUBTYPE,
+    .address    = 0x110000,
+    .size       = 0x2F0000,
+    .erase_size = SIM_SECTOR_SIZE,
+    .label      = FRAME_STORE_PARTITION,
+};
+
+static int flash_fd = -1;
+static sim_map_t maps[SIM_MAX_MAPS];
+
+// Open the file, created erased
+static bool sim_flash_open(void)
+{
+    struct stat st;
+
+    if (flash_fd >= 0)
+    {
+        return true;
+    }
+
+    flash_fd = open(sim_options.flash_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if ((flash_fd < 0) || (fstat(flash_fd, &st) < 0))
+    {
+        ESP_LOGE(TAG, "Cannot open %s", sim_options.flash_path);
+        return false;
+    }
+
+    if ((size_t) st.st_size < frames.size)
+    {
+        uint8_t erased[SIM_SECTOR_SIZE];
+        memset(erased, 0xFF, sizeof(erased));
+        for (size_t offset = st.st_size & ~(SIM_SECTOR_SIZE - 1U); offset < frames.size; offset += sizeof(erased))
+        {
+            if (pwrite(flash_fd, erased, sizeof(erased), offset) != sizeof(erased))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label)
+{
+    if ((type != frames.type) || (subtype != frames.subtype)
+        || ((label != NULL) && (strcmp(label, frames.label) != 0)) || !sim_flash_open())
+    {
+        return NULL;
+    }
+
+    return &frames;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size)
+{
+    if (offset + size > partition->size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return (pread(flash_fd, dst, size, offset) == (ssize_t) size) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t offset, const void* src, size_t size)
+{
+    const uint8_t* data = src;
+    uint8_t current[SIM_SECTOR_SIZE];
+
+    if (offset + size > partition->size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    while (size > 0)
+    {
+        size_t len = (size < sizeof(current)) ? size : sizeof(current);
+
+        if (pread(flash_fd, current, len, offset) != (ssize_t) len)
+        {
+            return ESP_FAIL;
+        }
+        for (size_t i = 0; i < len; i++)
+        {
+            current[i] &= data[i];
+        }
+        if (pwrite(flash_fd, current, len, offset) != (ssize_t) len)
+        {
+            return ESP_FAIL;
+        }
+
+        data   += len;
+        offset += len;
+        size   -= len;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size)
+{
+    uint8_t erased[SIM_SECTOR_SIZE];
+
+    if ((offset % SIM_SECTOR_SIZE) || (size % SIM_SECTOR_SIZE) || (offset + size > partition->size))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(erased, 0xFF, sizeof(erased));
+    for (; size > 0; offset += SIM_SECTOR_SIZE, size -= SIM_SECTOR_SIZE)
+    {
+        if (pwrite(flash_fd, erased, SIM_SECTOR_SIZE, offset) != SIM_SECTOR_SIZE)
+        {
+            return ESP_FAIL;
+        }
+    }
+
+    return ESP_OK;
+}
+
+// Mapped read only, from the page holding offset
+esp_err_t esp_partition_mmap(const esp_partition_t* partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void** out_ptr,
+                             esp_partition_mmap_handle_t* out_handle)
+{
+    size_t page  = sysconf(_SC_PAGESIZE);
+    size_t start = offset & ~(page - 1);
+
+    if (offset + size > partition->size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint32_t i = 0; i < SIM_MAX_MAPS; i++)
+    {
+        if (maps[i].base != NULL)
+        {
+            continue;
+        }
+
+        void* base = mmap(NULL, offset + size - start, PROT_READ, MAP_SHARED, flash_fd, start);
+        if (base == MAP_FAILED)
+        {
+            return ESP_FAIL;
+        }
+
+        maps[i]     = (sim_map_t) { base, offset + size - start };
+        *out_ptr    = (const uint8_t*) base + (offset - start);
+        *out_handle = i;
+        return ESP_OK;
+    }
+
+    return ESP_ERR_NO_MEM;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+    if ((handle < SIM_MAX_MAPS) && (maps[handle].base != NULL))
+    {
+        munmap(maps[handle].base, maps[handle].len);
+        maps[handle].base = NULL;
+    }
+}
@@ -0,0 +1,672 @@
+/*
+ *  PaperFrame
+ *  Simulator: the ESP-IDF HTTP server API on POSIX sockets
+ *  One thread serves every socket, one request at a time, as the httpd task does on the device
+ *  A request handed over with httpd_req_async_handler_begin keeps its socket out of it until it completes
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "esp_http_server.h"
+
+#define SIM_HEAD_SIZE           2048U       // Request line and headers
+#define SIM_TYPE_LEN            64U
+
+typedef struct
+{
+    int         fd;
+    uint64_t    last_used;
+    uint8_t     buff[SIM_HEAD_SIZE];        // Received and not consumed yet
+    size_t      len;
+    bool        held;                       // By an async request, under held_lock
+} sim_conn_t;
+
+typedef struct
+{
+    sim_conn_t* conn;
+    size_t      remaining;                  // Body bytes not received yet
+    bool        started;                    // Status line and headers sent
+    bool        chunked;
+    bool        finished;
+    bool        close;                      // Close the connection after the response
+    bool        async;                      // Handed over, answered by httpd_req_async_handler_complete
+    const char* status;                     // Status line of the response, NULL for 200
+    char        type[SIM_TYPE_LEN];
+} sim_req_t;
+
+typedef struct
+{
+    httpd_config_t  config;
+    httpd_uri_t*    handlers;
+    uint16_t        handler_count;
+    sim_conn_t*     conns;
+    int             listen_fd;
+    uint64_t        clock;                  // Orders connections by last use
+    bool            joined;
+} sim_server_t;
+
+static const char* TAG = "httpd";
+
+// Async requests complete from other threads
+static pthread_mutex_t held_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// SIGUSR1 stands for the phone leaving the softAP
+static volatile sig_atomic_t station_left = 0;
+
+static const char* const status_lines[] = {
+    [HTTPD_500_INTERNAL_SERVER_ERROR]       = "500 Internal Server Error",
+    [HTTPD_501_METHOD_NOT_IMPLEMENTED]      = "501 Method Not Implemented",
+    [HTTPD_505_VERSION_NOT_SUPPORTED]       = "505 Version Not Supported",
+    [HTTPD_400_BAD_REQUEST]                 = "400 Bad Request",
+    [HTTPD_401_UNAUTHORIZED]                = "401 Unauthorized",
+    [HTTPD_403_FORBIDDEN]                   = "403 Forbidden",
+    [HTTPD_404_NOT_FOUND]                   = "404 Not Found",
+    [HTTPD_405_METHOD_NOT_ALLOWED]          = "405 Method Not Allowed",
+    [HTTPD_408_REQ_TIMEOUT]                 = "408 Request Timeout",
+    [HTTPD_411_LENGTH_REQUIRED]             = "411 Length Required",
+    [HTTPD_414_URI_TOO_LONG]                = "414 URI Too Long",
+    [HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE]    = "431 Request Header Fields Too Large",
+};
+
+static bool sim_send_all(int fd, const void* data, size_t len)
+{
+    const uint8_t* p = data;
+
+    while (len > 0)
+    {
+        ssize_t ret = send(fd, p, len, MSG_NOSIGNAL);
+        if (ret <= 0)
+        {
+            return false;
+        }
+        p   += ret;
+        len -= ret;
+    }
+
+    return true;
+}
+
+static void sim_close(sim_conn_t* conn)
+{
+    close(conn->fd);
+    conn->fd  = -1;
+    conn->len = 0;
+}
+
+// Send the status line and headers, with a length or chunked when len is negative
+static bool sim_send_head(httpd_req_t* r, const char* status, ssize_t len)
+{
+    sim_req_t* req = r->aux;
+    char head[256];
+    int n = snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: %s\r\n", status,
+                     req->type[0] ? req->type : "text/html");
+
+    if (len < 0)
+    {
+        n += snprintf(head + n, sizeof(head) - n, "Transfer-Encoding: chunked\r\n");
+    }
+    else
+    {
+        n += snprintf(head + n, sizeof(head) - n, "Content-Length: %zd\r\n", len);
+    }
+    n += snprintf(head + n, sizeof(head) - n, "%s\r\n", req->close ? "Connection: close\r\n" : "");
+
+    req->started = true;
+    req->chunked = (len < 0);
+    return sim_send_all(req->conn->fd, head, n);
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t* r, const char* type)
+{
+    sim_req_t* req = r->aux;
+    snprintf(req->type, sizeof(req->type), "%s", type);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t* r, const char* status)
+{
+    sim_req_t* req = r->aux;
+    req->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t buf_len)
+{
+    sim_req_t* req = r->aux;
+
+    if (req->started)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    req->finished = true;
+    return (sim_send_head(r, req->status ? req->status : "200 OK", buf_len) && sim_send_all(req->conn->fd, buf, buf_len)) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t* r, const char* buf, ssize_t buf_len)
+{
+    sim_req_t* req = r->aux;
+    char size[16];
+
+    if ((!req->started && !sim_send_head(r, req->status ? req->status : "200 OK", -1)) || !req->chunked || req->finished)
+    {
+        return ESP_FAIL;
+    }
+
+    // An empty chunk ends the response
+    if ((buf == NULL) || (buf_len == 0))
+    {
+        req->finished = true;
+        return sim_send_all(req->conn->fd, "0\r\n\r\n", 5) ? ESP_OK : ESP_FAIL;
+    }
+
+    int n = snprintf(size, sizeof(size), "%zx\r\n", buf_len);
+    return (sim_send_all(req->conn->fd, size, n) && sim_send_all(req->conn->fd, buf, buf_len)
+            && sim_send_all(req->conn->fd, "\r\n", 2)) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t* r, httpd_err_code_t error, const char* msg)
+{
+    sim_req_t* req = r->aux;
+
+    if (req->started)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    httpd_resp_set_type(r, "text/html");
+    req->finished = true;
+    req->close    = true;
+    return (sim_send_head(r, status_lines[error], strlen(msg)) && sim_send_all(req->conn->fd, msg, strlen(msg)))
+           ? ESP_OK : ESP_FAIL;
+}
+
+int httpd_req_recv(httpd_req_t* r, char* buf, size_t buf_len)
+{
+    sim_req_t* req   = r->aux;
+    sim_conn_t* conn = req->conn;
+    size_t len       = (buf_len < req->remaining) ? buf_len : req->remaining;
+
+    if (len == 0)
+    {
+        return 0;
+    }
+
+    // Bytes received with the headers first
+    if (conn->len > 0)
+    {
+        len = (len < conn->len) ? len : conn->len;
+        memcpy(buf, conn->buff, len);
+        memmove(conn->buff, conn->buff + len, conn->len - len);
+        conn->len      -= len;
+        req->remaining -= len;
+        return len;
+    }
+
+    ssize_t ret = recv(conn->fd, buf, len, 0);
+    if (ret < 0)
+    {
+        return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+    }
+    if (ret == 0)
+    {
+        return HTTPD_SOCK_ERR_FAIL;
+    }
+
+    req->remaining -= ret;
+    return ret;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* r, char* buf, size_t buf_len)
+{
+    const char* query = strchr(r->uri, '?');
+
+    if (query == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    snprintf(buf, buf_len, "%s", query + 1);
+    return (strlen(query + 1) < buf_len) ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+esp_err_t httpd_query_key_value(const char* qry, const char* key, char* val, size_t val_size)
+{
+    size_t key_len = strlen(key);
+
+    while (qry != NULL)
+    {
+        const char* end = strchr(qry, '&');
+        size_t len      = (end != NULL) ? (size_t) (end - qry) : strlen(qry);
+
+        if ((len > key_len) && (strncmp(qry, key, key_len) == 0) && (qry[key_len] == '='))
+        {
+            size_t value_len = len - key_len - 1;
+            size_t copied    = (value_len < val_size) ? value_len : val_size - 1;
+
+            memcpy(val, qry + key_len + 1, copied);
+            val[copied] = '\0';
+            return (copied == value_len) ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+        }
+
+        qry = (end != NULL) ? end + 1 : NULL;
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+// A trailing '*' matches any end, a '?' makes the character before it optional
+bool httpd_uri_match_wildcard(const char* uri_template, const char* uri_to_match, size_t match_upto)
+{
+    size_t len    = strlen(uri_template);
+    bool asterisk = (len > 0) && (uri_template[len - 1] == '*');
+    len          -= asterisk;
+    bool quest    = (len > 0) && (uri_template[len - 1] == '?');
+    len          -= quest;
+
+    if (asterisk && (match_upto >= len) && (strncmp(uri_template, uri_to_match, len) == 0))
+    {
+        return true;
+    }
+    if ((match_upto == len) && (strncmp(uri_template, uri_to_match, len) == 0))
+    {
+        return true;
+    }
+    return quest && (match_upto == len - 1) && (strncmp(uri_template, uri_to_match, len - 1) == 0);
+}
+
+// The copy and its state are one allocation, freed by httpd_req_async_handler_complete
+esp_err_t httpd_req_async_handler_begin(httpd_req_t* r, httpd_req_t** out)
+{
+    sim_req_t* req    = r->aux;
+    httpd_req_t* copy = malloc(sizeof(httpd_req_t) + sizeof(sim_req_t));
+
+    if (copy == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memcpy(copy, r, sizeof(httpd_req_t));
+    copy->aux = copy + 1;
+    memcpy(copy->aux, req, sizeof(sim_req_t));
+
+    pthread_mutex_lock(&held_lock);
+    req->conn->held = true;
+    pthread_mutex_unlock(&held_lock);
+
+    req->async = true;
+    *out = copy;
+    return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t* r)
+{
+    sim_req_t* req = r->aux;
+
+    pthread_mutex_lock(&held_lock);
+    if (req->close || !req->finished)
+    {
+        sim_close(req->conn);
+    }
+    req->conn->held = false;
+    pthread_mutex_unlock(&held_lock);
+
+    free(r);
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler)
+{
+    sim_server_t* server = handle;
+
+    if (server->handler_count >= server->config.max_uri_handlers)
+    {
+        ESP_LOGW(TAG, "No slot left for %s", uri_handler->uri);
+        return ESP_ERR_NO_MEM;
+    }
+
+    server->handlers[server->handler_count++] = *uri_handler;
+    return ESP_OK;
+}
+
+// Find the end of the headers in the buffer, receiving more when needed
+static char* sim_read_head(sim_conn_t* conn)
+{
+    while (true)
+    {
+        char* end = memmem(conn->buff, conn->len, "\r\n\r\n", 4);
+        if (end != NULL)
+        {
+            return end;
+        }
+        if (conn->len >= sizeof(conn->buff))
+        {
+            return NULL;
+        }
+
+        ssize_t ret = recv(conn->fd, conn->buff + conn->len, sizeof(conn->buff) - conn->len, 0);
+        if (ret <= 0)
+        {
+            return NULL;
+        }
+        conn->len += ret;
+    }
+}
+
+static const httpd_uri_t* sim_find_handler(sim_server_t* server, int method, const char* uri, bool* other_method)
+{
+    size_t len = strcspn(uri, "?");
+
+    *other_method = false;
+    for (uint16_t i = 0; i < server->handler_count; i++)
+    {
+        const httpd_uri_t* handler = &server->handlers[i];
+        bool match = (server->config.uri_match_fn != NULL)
+                   ? server->config.uri_match_fn(handler->uri, uri, len)
+                   : ((strlen(handler->uri) == len) && (strncmp(handler->uri, uri, len) == 0));
+
+        if (match && (handler->method == (httpd_method_t) method))
+        {
+            return handler;
+        }
+        *other_method |= match;
+    }
+
+    return NULL;
+}
+
+// Serve one request, return false when the connection has to be closed
+static bool sim_serve(sim_server_t* server, sim_conn_t* conn)
+{
+    static httpd_req_t r;
+    static sim_req_t req;
+    char* end = sim_read_head(conn);
+
+    if (end == NULL)
+    {
+        return false;
+    }
+
+    // Request line
+    char method[8];
+    char version[12];
+    *end = '\0';
+    memset(&r, 0, sizeof(r));
+    memset(&req, 0, sizeof(req));
+    r.handle = server;
+    r.aux    = &req;
+    req.conn = conn;
+
+    if (sscanf((char*) conn->buff, "%7s %512s %11s", method, (char*) r.uri, version) != 3)
+    {
+        return false;
+    }
+
+    r.method  = (strcmp(method, "GET") == 0) ? HTTP_GET
+              : (strcmp(method, "POST") == 0) ? HTTP_POST
+              : (strcmp(method, "PUT") == 0) ? HTTP_PUT
+              : (strcmp(method, "HEAD") == 0) ? HTTP_HEAD
+              : (strcmp(method, "DELETE") == 0) ? HTTP_DELETE : -1;
+    req.close = (strcmp(version, "HTTP/1.0") == 0);
+
+    // Headers we care about
+    for (char* line = strstr((char*) conn->buff, "\r\n"); line != NULL; line = strstr(line, "\r\n"))
+    {
+        line += 2;
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+        {
+            r.content_len = strtoul(line + 15, NULL, 10);
+        }
+        else if ((strncasecmp(line, "Connection:", 11) == 0) && (strstr(line, "close") != NULL))
+        {
+            req.close = true;
+        }
+    }
+
+    // Keep what follows the headers, the start of the body
+    size_t head_len = (uint8_t*) end + 4 - conn->buff;
+    memmove(conn->buff, conn->buff + head_len, conn->len - head_len);
+    conn->len    -= head_len;
+    req.remaining = r.content_len;
+
+    bool other_method;
+    const httpd_uri_t* handler = sim_find_handler(server, r.method, r.uri, &other_method);
+    esp_err_t ret = ESP_FAIL;
+
+    if (handler == NULL)
+    {
+        httpd_resp_send_err(&r, other_method ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND,
+                            other_method ? "Request method for this URI is not handled by server"
+                                         : "This URI does not exist");
+    }
+    else
+    {
+        r.user_ctx = handler->user_ctx;
+        ret = handler->handler(&r);
+    }
+
+    // The socket is the async request's
+    if (req.async)
+    {
+        return true;
+    }
+
+    // Drop what the handler did not read
+    char drop[512];
+    while ((req.remaining > 0) && !req.close && (ret == ESP_OK))
+    {
+        if (httpd_req_recv(&r, drop, sizeof(drop)) <= 0)
+        {
+            req.close = true;
+        }
+    }
+
+    return (ret == ESP_OK) && !req.close;
+}
+
+static sim_conn_t* sim_accept(sim_server_t* server)
+{
+    int fd = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    sim_conn_t* free_conn = NULL;
+    sim_conn_t* oldest = NULL;
+
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    // Sockets of async requests are neither free nor purged
+    pthread_mutex_lock(&held_lock);
+    for (uint16_t i = 0; i < server->config.max_open_sockets; i++)
+    {
+        sim_conn_t* conn = &server->conns[i];
+        if (conn->held)
+        {
+            continue;
+        }
+        if (conn->fd < 0)
+        {
+            free_conn = (free_conn != NULL) ? free_conn : conn;
+        }
+        else if ((oldest == NULL) || (conn->last_used < oldest->last_used))
+        {
+            oldest = conn;
+        }
+    }
+
+    // Full, the least recently used socket goes when allowed
+    if ((free_conn == NULL) && server->config.lru_purge_enable && (oldest != NULL))
+    {
+        sim_close(oldest);
+        free_conn = oldest;
+    }
+    pthread_mutex_unlock(&held_lock);
+
+    if (free_conn == NULL)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    int one = 1;
+    struct timeval timeout = { .tv_sec = server->config.recv_wait_timeout };
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    free_conn->fd        = fd;
+    free_conn->len       = 0;
+    free_conn->last_used = ++server->clock;
+
+    // The first client stands for a phone joining the softAP
+    if (!server->joined)
+    {
+        wifi_event_ap_staconnected_t event = { .mac = { 0x02, 0, 0, 0, 0, 1 }, .aid = 1 };
+        server->joined = true;
+        sim_event_post(WIFI_EVENT, WIFI_EVENT_AP_STACONNECTED, &event);
+    }
+
+    return free_conn;
+}
+
+static void sim_station_leave(int sig)
+{
+    (void) sig;
+    station_left = 1;
+}
+
+static void* sim_server_task(void* arg)
+{
+    sim_server_t* server = arg;
+
+    while (true)
+    {
+        fd_set fds;
+        int max_fd = server->listen_fd;
+
+        FD_ZERO(&fds);
+        FD_SET(server->listen_fd, &fds);
+        pthread_mutex_lock(&held_lock);
+        for (uint16_t i = 0; i < server->config.max_open_sockets; i++)
+        {
+            if ((server->conns[i].fd >= 0) && !server->conns[i].held)
+            {
+                FD_SET(server->conns[i].fd, &fds);
+                max_fd = (server->conns[i].fd > max_fd) ? server->conns[i].fd : max_fd;
+            }
+        }
+        pthread_mutex_unlock(&held_lock);
+
+        // Wakes up now and then to see if the phone left
+        struct timeval poll = { .tv_usec = 100000 };
+        int ready = select(max_fd + 1, &fds, NULL, NULL, &poll);
+
+        if (station_left && server->joined)
+        {
+            wifi_event_ap_stadisconnected_t event = { .mac = { 0x02, 0, 0, 0, 0, 1 }, .aid = 1 };
+            station_left   = 0;
+            server->joined = false;
+            sim_event_post(WIFI_EVENT, WIFI_EVENT_AP_STADISCONNECTED, &event);
+        }
+        if (ready <= 0)
+        {
+            continue;
+        }
+
+        if (FD_ISSET(server->listen_fd, &fds))
+        {
+            sim_accept(server);
+        }
+
+        for (uint16_t i = 0; i < server->config.max_open_sockets; i++)
+        {
+            sim_conn_t* conn = &server->conns[i];
+            if ((conn->fd < 0) || !FD_ISSET(conn->fd, &fds))
+            {
+                continue;
+            }
+
+            // Pipelined requests already received are served too
+            do
+            {
+                conn->last_used = ++server->clock;
+                if (!sim_serve(server, conn))
+                {
+                    sim_close(conn);
+                    break;
+                }
+            }
+            while (!conn->held && (memmem(conn->buff, conn->len, "\r\n\r\n", 4) != NULL));
+        }
+    }
+
+    return NULL;
+}
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config)
+{
+    sim_server_t* server = calloc(1, sizeof(sim_server_t));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port   = htons(config->server_port),
+        .sin_addr   = { htonl(INADDR_LOOPBACK) },
+    };
+    int one = 1;
+    pthread_t thread;
+
+    if (server == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    server->config    = *config;
+    server->handlers  = calloc(config->max_uri_handlers, sizeof(httpd_uri_t));
+    server->conns     = calloc(config->max_open_sockets, sizeof(sim_conn_t));
+    server->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if ((server->handlers == NULL) || (server->conns == NULL) || (server->listen_fd < 0))
+    {
+        return ESP_FAIL;
+    }
+
+    for (uint16_t i = 0; i < config->max_open_sockets; i++)
+    {
+        server->conns[i].fd = -1;
+    }
+
+    setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if ((bind(server->listen_fd, (struct sockaddr*) &addr, sizeof(addr)) < 0)
+        || (listen(server->listen_fd, config->max_open_sockets) < 0))
+    {
+        ESP_LOGE(TAG, "Cannot listen on port %u", config->server_port);
+        close(server->listen_fd);
+        return ESP_FAIL;
+    }
+
+    if (pthread_create(&thread, NULL, sim_server_task, server) != 0)
+    {
+        return ESP_FAIL;
+    }
+    pthread_detach(thread);
+    signal(SIGUSR1, sim_station_leave);
+
+    ESP_LOGI(TAG, "Serving http://127.0.0.1:%u/", config->server_port);
+    *handle = server;
+    return ESP_OK;
+}
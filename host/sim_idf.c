@@ -0,0 +1,204 @@
+/*
+ *  PaperFrame
+ *  Simulator: ESP-IDF system services, events, WiFi, sleep, heap and ROM functions
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+
+#include "sim.h"
+
+#define SIM_MAX_HANDLERS        4U
+
+// Reported for every internal heap, the host heap has no such limit
+#define SIM_HEAP_SIZE           (320U * 1024U)
+
+typedef struct
+{
+    esp_event_base_t    base;
+    int32_t             id;
+    esp_event_handler_t handler;
+    void*               arg;
+} sim_handler_t;
+
+esp_event_base_t const WIFI_EVENT = "WIFI_EVENT";
+
+static const char* TAG = "sim";
+static sim_handler_t handlers[SIM_MAX_HANDLERS];
+static uint8_t handler_count = 0;
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler, void* arg)
+{
+    if (handler_count >= SIM_MAX_HANDLERS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    handlers[handler_count++] = (sim_handler_t) { base, id, handler, arg };
+    return ESP_OK;
+}
+
+void sim_event_post(esp_event_base_t base, int32_t id, void* data)
+{
+    for (uint8_t i = 0; i < handler_count; i++)
+    {
+        if ((handlers[i].base == base) && ((handlers[i].id == ESP_EVENT_ANY_ID) || (handlers[i].id == id)))
+        {
+            handlers[i].handler(handlers[i].arg, base, id, data);
+        }
+    }
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t* config)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t* config)
+{
+    return ESP_OK;
+}
+
+// The softAP is up right away
+esp_err_t esp_wifi_start(void)
+{
+    sim_event_post(WIFI_EVENT, WIFI_EVENT_AP_START, NULL);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void)
+{
+    return ESP_OK;
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return sim_options.woken ? ESP_RST_DEEPSLEEP : ESP_RST_POWERON;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void)
+{
+    return sim_options.woken ? ESP_SLEEP_WAKEUP_EXT0 : ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(int gpio, int level)
+{
+    return ESP_OK;
+}
+
+// Exit, or restart as if the button was pressed right away
+void esp_deep_sleep_start(void)
+{
+    fflush(NULL);
+
+    if (!sim_options.wake)
+    {
+        ESP_LOGI(TAG, "Deep sleep, exiting");
+        exit(0);
+    }
+
+    // Same binary under its own name, for ps and pkill
+    char exe[4096];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len <= 0)
+    {
+        perror("readlink");
+        exit(1);
+    }
+    exe[len] = '\0';
+
+    // Sockets of the DNS server are not close-on-exec
+    for (int fd = 3; fd < 1024; fd++)
+    {
+        close(fd);
+    }
+
+    ESP_LOGI(TAG, "Deep sleep, waking up");
+    setenv("PAPERFRAME_SIM_WOKEN", "1", 1);
+    execv(exe, sim_options.argv);
+
+    perror("execv");
+    exit(1);
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps)
+{
+    // No PSRAM
+    return (caps & MALLOC_CAP_SPIRAM) ? NULL : malloc(size);
+}
+
+void heap_caps_free(void* ptr)
+{
+    free(ptr);
+}
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps)
+{
+    memset(info, 0, sizeof(*info));
+
+    if (!(caps & MALLOC_CAP_SPIRAM))
+    {
+        info->total_free_bytes   = SIM_HEAP_SIZE;
+        info->largest_free_block = SIM_HEAP_SIZE;
+        info->minimum_free_bytes = SIM_HEAP_SIZE;
+    }
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return (caps & MALLOC_CAP_SPIRAM) ? 0 : SIM_HEAP_SIZE;
+}
+
+size_t heap_caps_get_total_size(uint32_t caps)
+{
+    return (caps & MALLOC_CAP_SPIRAM) ? 0 : SIM_HEAP_SIZE;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return (caps & MALLOC_CAP_SPIRAM) ? 0 : SIM_HEAP_SIZE;
+}
+
+// Thread stacks are not watched, no task is reported
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* status, UBaseType_t count, uint32_t* total_run_time)
+{
+    return 0;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *buf++;
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1U));
+        }
+    }
+    return ~crc;
+}
@@ -0,0 +1,72 @@
+/*
+ *  PaperFrame
+ *  Simulator of the whole firmware on Linux: main.c with its HTTP and DNS servers on localhost,
+ *  the frames partition in a file and the panel as a PNG
+ *  ./paperframe_sim [--http-port 8080] [--flash frames.bin] [--panel panel.png] [--refresh-ms 0] [--wake]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_http_server.h"
+#include "esp_timer.h"
+
+#include "sim.h"
+
+// Set before app_main, read by HTTPD_DEFAULT_CONFIG
+uint16_t sim_http_port = 8080;
+
+sim_options_t sim_options = {
+    .flash_path = "frames.bin",
+    .panel_path = "panel.png",
+};
+
+static void sim_usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [--http-port port] [--flash file] [--panel file.png] [--refresh-ms ms] [--wake]\n", name);
+    exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    // Boot, or wake up after a restart, now
+    esp_timer_boot_us = esp_timer_get_time();
+    sim_options.argv = argv;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if ((strcmp(argv[i], "--http-port") == 0) && has_value)
+        {
+            sim_http_port = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--flash") == 0) && has_value)
+        {
+            sim_options.flash_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--panel") == 0) && has_value)
+        {
+            sim_options.panel_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--refresh-ms") == 0) && has_value)
+        {
+            sim_options.refresh_ms = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--wake") == 0)
+        {
+            sim_options.wake = true;
+        }
+        else
+        {
+            sim_usage(argv[0]);
+        }
+    }
+
+    // Set when the simulator restarts itself after deep sleep
+    sim_options.woken = (getenv("PAPERFRAME_SIM_WOKEN") != NULL);
+
+    app_main();
+    return 0;
+}
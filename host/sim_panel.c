@@ -0,0 +1,130 @@
+/*
+ *  PaperFrame
+ *  Simulator: the GD7965 panel behind display_driver.h, each refresh writes what it shows as a PNG
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+
+#include "display_config.h"
+#include "display_driver.h"
+#include "frame_image.h"
+#include "sim.h"
+
+static const char* TAG = "sim_panel";
+
+// Panel RAM: DTM1 holds black/white, DTM2 red, or black/white in the fast mode
+static uint8_t dtm1[FRAMEBUFFER_PLANE_SIZE];
+static uint8_t dtm2[FRAMEBUFFER_PLANE_SIZE];
+static display_mode_t panel_mode = DISPLAY_MODE_KWR;
+static bool configured = false;
+
+static bool sim_panel_write(void* ctx, const uint8_t* data, uint32_t len)
+{
+    return fwrite(data, 1, len, (FILE*) ctx) == len;
+}
+
+// Load a plane in panel RAM, as is or through the reader
+static void sim_panel_load(uint8_t* dst, uint8_t plane, const uint8_t* framebuffer,
+                           display_plane_reader_t reader, uint32_t chunk_len)
+{
+    if (reader == NULL)
+    {
+        memcpy(dst, framebuffer + plane * FRAMEBUFFER_PLANE_SIZE, FRAMEBUFFER_PLANE_SIZE);
+        return;
+    }
+
+    for (uint32_t offset = 0; offset < FRAMEBUFFER_PLANE_SIZE; offset += chunk_len)
+    {
+        uint32_t len = (chunk_len < FRAMEBUFFER_PLANE_SIZE - offset) ? chunk_len : FRAMEBUFFER_PLANE_SIZE - offset;
+        reader(plane, offset, dst + offset, len);
+    }
+}
+
+bool display_driver_init(void)
+{
+    memset(dtm1, 0xFF, sizeof(dtm1));
+    memset(dtm2, 0x00, sizeof(dtm2));
+    return true;
+}
+
+bool display_configure(display_mode_t mode)
+{
+    panel_mode = mode;
+    configured = true;
+    return true;
+}
+
+bool display_transfer(const uint8_t* framebuffer, display_plane_reader_t reader, uint32_t chunk_len)
+{
+    if (!configured || ((reader == NULL) && (framebuffer == NULL)))
+    {
+        return false;
+    }
+
+    if (panel_mode == DISPLAY_MODE_KW_FAST)
+    {
+        sim_panel_load(dtm2, 0, framebuffer, reader, chunk_len);
+    }
+    else
+    {
+        sim_panel_load(dtm1, 0, framebuffer, reader, chunk_len);
+        sim_panel_load(dtm2, 1, framebuffer, reader, chunk_len);
+    }
+
+    return true;
+}
+
+// Write the shown frame to a temporary file then rename it, readers never see half a PNG
+bool display_refresh(void)
+{
+    static frame_image_encoder_t enc;
+    static const uint8_t no_red[DISPLAY_WIDTH / 8U];
+    const uint8_t* bw  = (panel_mode == DISPLAY_MODE_KW_FAST) ? dtm2 : dtm1;
+    char tmp_path[256];
+    bool ret;
+
+    if (!configured)
+    {
+        return false;
+    }
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", sim_options.panel_path);
+    FILE* file = fopen(tmp_path, "wb");
+    if (file == NULL)
+    {
+        ESP_LOGE(TAG, "Cannot write %s", tmp_path);
+        return false;
+    }
+
+    ret = frame_image_begin(&enc, FRAME_IMAGE_PNG, DISPLAY_WIDTH, DISPLAY_HEIGHT, sim_panel_write, file);
+    for (uint32_t offset = 0; ret && (offset < FRAMEBUFFER_PLANE_SIZE); offset += DISPLAY_WIDTH / 8U)
+    {
+        const uint8_t* red = (panel_mode == DISPLAY_MODE_KW_FAST) ? no_red : dtm2 + offset;
+        ret = frame_image_row(&enc, bw + offset, red);
+    }
+    ret = ret && frame_image_end(&enc);
+    ret = (fclose(file) == 0) && ret && (rename(tmp_path, sim_options.panel_path) == 0);
+
+    // The BUSY wait of a real refresh
+    usleep(sim_options.refresh_ms * 1000U);
+
+    ESP_LOGI(TAG, "Refreshed, shown in %s", sim_options.panel_path);
+    return ret;
+}
+
+// Like the panel, only a reset gets it out of deep sleep
+bool display_low_power_mode(void)
+{
+    if (!configured)
+    {
+        return false;
+    }
+
+    configured = false;
+    return true;
+}
@@ -0,0 +1,200 @@
+/*
+ *  PaperFrame
+ *  Simulator: the TJpgDec API of the ESP32 ROM on libjpeg, for jpeg_upload.c
+ *  Blocks are cut from bands of one MCU row, libjpeg buffers come from its own pools and not from the heap
+ */
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include <jpeglib.h>
+
+#include "esp32/rom/tjpgd.h"
+
+#define TJPGD_INPUT_SIZE    512U    // Bytes asked to infunc at once, as the ROM decoder does
+
+// libjpeg state of the decoder, one JPEG at a time as in the firmware
+typedef struct
+{
+    struct jpeg_decompress_struct   cinfo;
+    struct jpeg_error_mgr           err;
+    struct jpeg_source_mgr          src;
+    jmp_buf                         jump;
+    JRESULT                         failure;        // Returned when libjpeg bails out
+    JDEC*                           jd;
+    uint8_t                         input[TJPGD_INPUT_SIZE];
+} tjpgd_state_t;
+
+static tjpgd_state_t state;
+
+static void tjpgd_error_exit(j_common_ptr cinfo)
+{
+    longjmp(state.jump, 1);
+}
+
+// libjpeg warnings are not errors of TJpgDec
+static void tjpgd_output_message(j_common_ptr cinfo)
+{
+}
+
+static void tjpgd_init_source(j_decompress_ptr cinfo)
+{
+}
+
+static void tjpgd_term_source(j_decompress_ptr cinfo)
+{
+}
+
+static boolean tjpgd_fill_input(j_decompress_ptr cinfo)
+{
+    uint32_t len = state.jd->infunc(state.jd, state.input, sizeof(state.input));
+
+    if (len == 0)
+    {
+        state.failure = JDR_INP;
+        longjmp(state.jump, 1);
+    }
+
+    state.src.next_input_byte = state.input;
+    state.src.bytes_in_buffer = len;
+    return TRUE;
+}
+
+// Bytes past the buffer are skipped by infunc, as the ROM decoder does with a NULL buffer
+static void tjpgd_skip_input(j_decompress_ptr cinfo, long count)
+{
+    size_t buffered = MIN((size_t) count, state.src.bytes_in_buffer);
+
+    state.src.next_input_byte += buffered;
+    state.src.bytes_in_buffer -= buffered;
+    count -= buffered;
+
+    if ((count > 0) && (state.jd->infunc(state.jd, NULL, count) != (uint32_t) count))
+    {
+        state.failure = JDR_INP;
+        longjmp(state.jump, 1);
+    }
+}
+
+JRESULT jd_prepare(JDEC* jd, uint32_t (*infunc)(JDEC*, uint8_t*, uint32_t), void* pool, uint32_t sz_pool, void* dev)
+{
+    memset(jd, 0, sizeof(*jd));
+    jd->pool    = pool;
+    jd->sz_pool = sz_pool;
+    jd->infunc  = infunc;
+    jd->device  = dev;
+
+    if (pool == NULL)
+    {
+        return JDR_MEM1;
+    }
+
+    // A picture given up after jd_prepare is released here
+    jpeg_destroy_decompress(&state.cinfo);
+
+    state.jd      = jd;
+    state.failure = JDR_FMT1;
+    state.cinfo.err             = jpeg_std_error(&state.err);
+    state.err.error_exit        = tjpgd_error_exit;
+    state.err.output_message    = tjpgd_output_message;
+
+    if (setjmp(state.jump))
+    {
+        jpeg_destroy_decompress(&state.cinfo);
+        return state.failure;
+    }
+
+    jpeg_create_decompress(&state.cinfo);
+
+    state.src = (struct jpeg_source_mgr) {
+        .init_source        = tjpgd_init_source,
+        .fill_input_buffer  = tjpgd_fill_input,
+        .skip_input_data    = tjpgd_skip_input,
+        .resync_to_restart  = jpeg_resync_to_restart,
+        .term_source        = tjpgd_term_source,
+    };
+    state.cinfo.src = &state.src;
+
+    jpeg_read_header(&state.cinfo, TRUE);
+
+    // TJpgDec decodes baseline YCbCr or grayscale only
+    if (state.cinfo.progressive_mode || (state.cinfo.num_components == 4))
+    {
+        JRESULT res = state.cinfo.progressive_mode ? JDR_FMT3 : JDR_FMT2;
+        jpeg_destroy_decompress(&state.cinfo);
+        return res;
+    }
+
+    jd->width  = state.cinfo.image_width;
+    jd->height = state.cinfo.image_height;
+    jd->msx    = state.cinfo.max_h_samp_factor;
+    jd->msy    = state.cinfo.max_v_samp_factor;
+
+    return JDR_OK;
+}
+
+JRESULT jd_decomp(JDEC* jd, uint32_t (*outfunc)(JDEC*, void*, JRECT*), uint8_t scale)
+{
+    struct jpeg_decompress_struct* cinfo = &state.cinfo;
+
+    if ((scale > 3) || (state.jd != jd))
+    {
+        return JDR_PAR;
+    }
+
+    state.failure = JDR_FMT1;
+    if (setjmp(state.jump))
+    {
+        jpeg_destroy_decompress(cinfo);
+        return state.failure;
+    }
+
+    jd->scale               = scale;
+    cinfo->scale_num        = 1;
+    cinfo->scale_denom      = 1U << scale;
+    cinfo->out_color_space  = JCS_RGB;
+    jpeg_start_decompress(cinfo);
+
+    uint16_t mcu_width  = (jd->msx * 8U) >> scale;
+    uint16_t mcu_height = (jd->msy * 8U) >> scale;
+    JSAMPARRAY band     = cinfo->mem->alloc_sarray((j_common_ptr) cinfo, JPOOL_IMAGE,
+                                                   cinfo->output_width * 3U, mcu_height);
+    uint8_t* block      = cinfo->mem->alloc_small((j_common_ptr) cinfo, JPOOL_IMAGE,
+                                                  mcu_width * mcu_height * 3U);
+
+    while (cinfo->output_scanline < cinfo->output_height)
+    {
+        JRECT rect = { .top = cinfo->output_scanline };
+        uint16_t rows = 0;
+
+        while ((rows < mcu_height) && (cinfo->output_scanline < cinfo->output_height))
+        {
+            rows += jpeg_read_scanlines(cinfo, band + rows, mcu_height - rows);
+        }
+        rect.bottom = rect.top + rows - 1U;
+
+        for (rect.left = 0; rect.left < cinfo->output_width; rect.left += mcu_width)
+        {
+            rect.right = MIN(rect.left + mcu_width, cinfo->output_width) - 1U;
+            uint32_t row_len = (rect.right - rect.left + 1U) * 3U;
+
+            for (uint16_t y = 0; y < rows; y++)
+            {
+                memcpy(&block[y * row_len], &band[y][rect.left * 3U], row_len);
+            }
+
+            if (!outfunc(jd, block, &rect))
+            {
+                jpeg_destroy_decompress(cinfo);
+                return JDR_INTR;
+            }
+        }
+    }
+
+    // Trailing bytes are not read, as the ROM decoder stops at the last MCU
+    jpeg_destroy_decompress(cinfo);
+
+    return JDR_OK;
+}
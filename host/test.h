@@ -0,0 +1,43 @@
+/*
+ *  PaperFrame
+ *  Harness of the host tests: checks printed one per line and counted, timing of benchmarks
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static unsigned test_failures = 0;
+
+static inline double test_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline void test_expect(bool ok, const char* what)
+{
+    printf("%-52s %s\n", what, ok ? "ok" : "FAILED");
+    test_failures += !ok;
+}
+
+// Exit status of the test, non-zero when a check failed
+static inline int test_result(void)
+{
+    return test_failures ? 1 : 0;
+}
+
+// Mean time of a statement run iterations times, in us
+#define TEST_BENCH_US(iterations, statement)                        \
+    __extension__ ({                                                \
+        double _start = test_now();                                 \
+        for (uint32_t _i = 0; _i < (iterations); _i++)              \
+        {                                                           \
+            statement;                                              \
+        }                                                           \
+        (test_now() - _start) * 1e6 / (iterations);                 \
+    })
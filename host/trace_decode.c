@@ -0,0 +1,127 @@
+/*
+ *  PaperFrame
+ *  Decoder of the trace dumps served on /trace: merges the rings of both cores by time
+ *  curl -s http://192.168.4.1/trace > trace.bin && ./trace_decode trace.bin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+typedef struct
+{
+    const char* name;
+    trace_arg_t args[2];
+} trace_event_info_t;
+
+// From the same table as the firmware
+static const trace_event_info_t events[TRACE_EVENT_COUNT] = {
+#define TRACE_EVENT_INFO(id, name, arg0, arg1) [id] = {name, {arg0, arg1}},
+    TRACE_EVENTS(TRACE_EVENT_INFO)
+#undef TRACE_EVENT_INFO
+};
+
+static void decode_arg(trace_arg_t kind, uint32_t arg)
+{
+    switch (kind)
+    {
+        case TRACE_ARG_U32:
+            printf(" %lu", (unsigned long) arg);
+            break;
+        case TRACE_ARG_HEX:
+            printf(" 0x%08lx", (unsigned long) arg);
+            break;
+        case TRACE_ARG_CHARS:
+            putchar(' ');
+            for (int shift = 24; (shift >= 0) && ((arg >> shift) & 0xFF); shift -= 8)
+            {
+                char c = arg >> shift;
+                putchar(((c >= 0x20) && (c < 0x7F)) ? c : '.');
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    FILE* file = (argc == 2) ? fopen(argv[1], "rb") : stdin;
+    trace_dump_header_t header;
+
+    if (file == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    if ((fread(&header, sizeof(header), 1, file) != 1)
+        || (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0)
+        || (header.version != TRACE_VERSION) || (header.cores != TRACE_CORES))
+    {
+        fprintf(stderr, "Not a trace dump of this firmware\n");
+        return 1;
+    }
+
+    size_t count = 0;
+    for (uint8_t core = 0; core < TRACE_CORES; core++)
+    {
+        count += header.counts[core];
+    }
+
+    trace_record_t* records = calloc(count ? count : 1, sizeof(trace_record_t));
+    if ((records == NULL) || (fread(records, sizeof(trace_record_t), count, file) != count))
+    {
+        fprintf(stderr, "Truncated trace dump\n");
+        return 1;
+    }
+
+    // Each ring is in time order, merge them, timestamps come from the same clock on both cores
+    const trace_record_t* next[TRACE_CORES];
+    const trace_record_t* ends[TRACE_CORES];
+    const trace_record_t* rec = records;
+    for (uint8_t core = 0; core < TRACE_CORES; core++)
+    {
+        next[core] = rec;
+        rec       += header.counts[core];
+        ends[core] = rec;
+    }
+
+    uint32_t first = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t oldest = TRACE_CORES;
+        for (uint8_t core = 0; core < TRACE_CORES; core++)
+        {
+            if ((next[core] < ends[core])
+                && ((oldest == TRACE_CORES) || (next[core]->timestamp_us < next[oldest]->timestamp_us)))
+            {
+                oldest = core;
+            }
+        }
+        rec = next[oldest]++;
+        if (i == 0)
+        {
+            first = rec->timestamp_us;
+        }
+
+        printf("%12.3f ms  +%8.3f  core%u  ", rec->timestamp_us / 1000.0,
+               (rec->timestamp_us - first) / 1000.0, rec->core);
+        if (rec->event >= TRACE_EVENT_COUNT)
+        {
+            printf("event_%u 0x%08lx 0x%08lx\n", rec->event,
+                   (unsigned long) rec->args[0], (unsigned long) rec->args[1]);
+            continue;
+        }
+
+        printf("%-13s", events[rec->event].name);
+        decode_arg(events[rec->event].args[0], rec->args[0]);
+        decode_arg(events[rec->event].args[1], rec->args[1]);
+        putchar('\n');
+    }
+
+    free(records);
+    return 0;
+}
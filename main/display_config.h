@@ -7,16 +7,36 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 
-#define DISPLAY_HEIGHT          480U
-#define DISPLAY_WIDTH           800U
-#define FRAMEBUFFER_SIZE        (DISPLAY_WIDTH*DISPLAY_HEIGHT)/4U
-
-#define PIN_SPI_DATA            14U
-#define PIN_SPI_CLOCK           13U
-#define PIN_DISPLAY_CS          15U
-#define PIN_DISPLAY_DC          27U
-#define PIN_DISPLAY_RST         26U
-#define PIN_DISPLAY_BUSY        25U
+// Panel descriptor, picked at build time: geometry, planes, controller settings and timings
+#ifndef PANEL_DESCRIPTOR
+#define PANEL_DESCRIPTOR        "panels/gd7965_750_kwr.h"
+#endif
+#include PANEL_DESCRIPTOR
+
+// Frames, uploads and the frame store use the framebuffer layout: a white/black then a red/none plane
+#if (PANEL_PLANES != 2U) || (PANEL_BITS_PER_PIXEL != 1U)
+#error "Only panels with a white/black and a red/none plane of 1 bit per pixel are supported"
+#endif
+
+// Rows of both orientations are whole 32-bit words: half turns reverse them and frame_draw blits them
+// a word at a time, portrait frames are turned by 8x8 blocks
+#if ((PANEL_WIDTH % 32U) != 0) || ((PANEL_HEIGHT % 32U) != 0)
+#error "Panel width and height must be multiples of 32"
+#endif
+
+#define DISPLAY_HEIGHT          PANEL_HEIGHT
+#define DISPLAY_WIDTH           PANEL_WIDTH
+#define FRAMEBUFFER_PLANE_SIZE  (DISPLAY_WIDTH*DISPLAY_HEIGHT*PANEL_BITS_PER_PIXEL/8U)
+#define FRAMEBUFFER_SIZE        (FRAMEBUFFER_PLANE_SIZE*PANEL_PLANES)
+
+// 1 to allocate the framebuffer when a frame comes, in PSRAM or else DMA capable RAM,
+// and free it once shown and saved, 0 to keep it in static RAM
+#ifndef FRAMEBUFFER_ON_DEMAND
+#define FRAMEBUFFER_ON_DEMAND   0
+#endif
+
+// Push button to GND, has to be an RTC GPIO to wake from deep sleep
+#define PIN_WAKE_BUTTON         33U
 
 #ifdef __cplusplus
 }
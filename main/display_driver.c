@@ -1,16 +1,27 @@
 #include <string.h>
+#include <inttypes.h>
+#include <sys/param.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
 
 #include "display_config.h"
 #include "display_driver.h"
 
+#if !PANEL_CONTROLLER_GD7965
+#error "The panel descriptor has to be for a GD7965 controller"
+#endif
+
 // Dipsplay driver command set
 #define GD7965_REG_PSR          0x00U   // Panel Setting
 #define GD7965_REG_PWR          0x01U   // Power Setting
@@ -26,6 +37,12 @@
 #define GD7965_REG_DTM2         0x13U   // Display Start transmission 2 (Red Data)
 #define GD7965_REG_DUSPI        0x15U   // Dual SPI
 #define GD7965_REG_AUTO         0x17U   // Auto Sequence
+#define GD7965_REG_LUTC         0x20U   // VCOM LUT
+#define GD7965_REG_LUTWW        0x21U   // White to white LUT (KW mode)
+#define GD7965_REG_LUTKW        0x22U   // Black to white LUT (KW mode)
+#define GD7965_REG_LUTWK        0x23U   // White to black LUT (KW mode)
+#define GD7965_REG_LUTKK        0x24U   // Black to black LUT (KW mode)
+#define GD7965_REG_LUTBD        0x25U   // Border LUT
 #define GD7965_REG_LUTOPT       0x2AU   // LUT option
 #define GD7965_REG_KWOPT        0x2BU   // KW LUT option
 #define GD7965_REG_PLL          0x30U   // PLL control
@@ -57,98 +74,243 @@
 #define GD7965_REG_TSSET        0xE5U   // Force Temperature
 #define GD7965_REG_TSBDRY       0xE7U   // Temperature Boundary Phase-C2
 
-// Display driver register values
+// Display driver register values, the panel ones come from its descriptor
 #define GD7965_DSLP_CHECK       0xA5U   // Check value for deep-sleep command
-#define GD7965_REVISION         0x0CU   // Revision code of GD7965
+#define GD7965_TSE_INTERNAL     0x00U   // Internal temperature sensor, no offset
+
+#define DISPLAY_SPI_QUEUE_SIZE  8U      // Transactions queued before waiting for completion
+
+// Wait policy applied after a command of a sequence
+#define SEQ_WAIT_NONE           0x00U   // Go on with the next command
+#define SEQ_WAIT_BUSY           0x01U   // Wait for the BUSY line to get back to idle
+
+// Describe the payload of a sequence command
+#define SEQ_DATA(...)           .data = (const uint8_t[]){__VA_ARGS__}, .len = sizeof((const uint8_t[]){__VA_ARGS__})
+// Number of commands in a sequence table
+#define SEQ_LEN(seq)            (sizeof(seq) / sizeof((seq)[0]))
+
+// LUT level selection, 2 bits for each of the four phases of a group
+#define LUT_GND                 0x0U    // VCOM_DC
+#define LUT_VDH                 0x1U
+#define LUT_VDL                 0x2U
+#define LUT_LEVELS(p0, p1, p2, p3)  (((p0) << 6) | ((p1) << 4) | ((p2) << 2) | (p3))
+
+// Drive to the opposite color then to the target one, old data is ignored
+#define LUT_TO_WHITE            LUT_LEVELS(LUT_VDL, LUT_VDH, LUT_GND, LUT_GND)
+#define LUT_TO_BLACK            LUT_LEVELS(LUT_VDH, LUT_VDL, LUT_GND, LUT_GND)
+#define LUT_VCOM                LUT_LEVELS(LUT_GND, LUT_GND, LUT_GND, LUT_GND)
+
+// A LUT is 7 groups of 6 bytes: levels, four phase frame counts, repeat count
+// Only the first group is used, with two phases of `frames` frames each
+#define LUT_SIZE                42U
+#define SEQ_LUT(reg, levels, frames) \
+    { .command = (reg), .data = (const uint8_t[LUT_SIZE]){ (levels), (frames), (frames), 0x00, 0x00, 0x01 }, .len = LUT_SIZE }
+
+// Full set of KW mode LUTs for a given phase length
+#define SEQ_LUT_KW(frames) \
+    SEQ_LUT(GD7965_REG_LUTC,  LUT_VCOM,     frames), \
+    SEQ_LUT(GD7965_REG_LUTWW, LUT_TO_WHITE, frames), \
+    SEQ_LUT(GD7965_REG_LUTKW, LUT_TO_WHITE, frames), \
+    SEQ_LUT(GD7965_REG_LUTWK, LUT_TO_BLACK, frames), \
+    SEQ_LUT(GD7965_REG_LUTKK, LUT_TO_BLACK, frames)
+
+// One command of a controller sequence
+typedef struct
+{
+    uint8_t         command;    // Controller opcode
+    uint8_t         wait;       // Wait policy after the command
+    uint16_t        delay_ms;   // Minimum delay after the command
+    const uint8_t*  data;       // Payload, may be NULL
+    uint16_t        len;        // Payload length
+} display_cmd_t;
+
+// Power and panel configuration, run after the hardware reset
+static const display_cmd_t seq_init[] = {
+    // Power settings of the panel
+    { .command = GD7965_REG_PWR,    SEQ_DATA(PANEL_PWR) },
+    // Power on
+    { .command = GD7965_REG_PON,    .wait = SEQ_WAIT_BUSY },
+    // Horizontal then vertical resolution, MSB first
+    { .command = GD7965_REG_TRES,   SEQ_DATA(DISPLAY_WIDTH >> 8, DISPLAY_WIDTH & 0xFF, DISPLAY_HEIGHT >> 8, DISPLAY_HEIGHT & 0xFF) },
+    // Border, VCOM and data interval
+    { .command = GD7965_REG_CDI,    SEQ_DATA(PANEL_CDI) },
+    // Non-overlap periods
+    { .command = GD7965_REG_TCON,   SEQ_DATA(PANEL_TCON) },
+    // Gates/sources start: HSTART then VSTART
+    { .command = GD7965_REG_GSST,   SEQ_DATA(0x00, 0x00, 0x00, 0x00) },
+    // Partial mode disabled (refresh full display)
+    { .command = GD7965_REG_PTOUT },
+};
+
+// Black/white/red mode, waveform from OTP
+static const display_cmd_t seq_mode_kwr[] = {
+    { .command = GD7965_REG_PSR,    SEQ_DATA(PANEL_PSR_KWR) },
+};
+
+// Black/white mode, waveform from the LUT registers loaded before
+static const display_cmd_t seq_mode_kw[] = {
+    { .command = GD7965_REG_PSR,    SEQ_DATA(PANEL_PSR_KW) },
+};
+
+// Use the internal temperature sensor
+static const display_cmd_t seq_temp_select[] = {
+    { .command = GD7965_REG_TSE,    SEQ_DATA(GD7965_TSE_INTERNAL) },
+};
+
+// KW waveforms, particles move slower in the cold
+static const display_cmd_t seq_lut_kw_cold[]    = { SEQ_LUT_KW(PANEL_KW_COLD_FRAMES) };
+static const display_cmd_t seq_lut_kw_normal[]  = { SEQ_LUT_KW(PANEL_KW_NORMAL_FRAMES) };
+static const display_cmd_t seq_lut_kw_warm[]    = { SEQ_LUT_KW(PANEL_KW_WARM_FRAMES) };
+
+// KW LUT to use up to a given temperature
+typedef struct
+{
+    int8_t                  max_temp;   // Upper bound of the range, in °C
+    const char*             name;
+    const display_cmd_t*    seq;
+    size_t                  len;
+} display_lut_band_t;
+
+static const display_lut_band_t lut_bands[] = {
+    { PANEL_KW_COLD_MAX_C,      "kw_cold",      seq_lut_kw_cold,    SEQ_LEN(seq_lut_kw_cold) },
+    { PANEL_KW_NORMAL_MAX_C,    "kw_normal",    seq_lut_kw_normal,  SEQ_LEN(seq_lut_kw_normal) },
+    { INT8_MAX,                 "kw_warm",      seq_lut_kw_warm,    SEQ_LEN(seq_lut_kw_warm) },
+};
+
+// Band used when the temperature can't be read
+#define LUT_BAND_DEFAULT        1U
+
+// Show the transfered frame
+static const display_cmd_t seq_refresh[] = {
+    { .command = GD7965_REG_DRF,    .wait = SEQ_WAIT_BUSY },
+};
+
+// Power-off then deep-sleep
+static const display_cmd_t seq_low_power[] = {
+    { .command = GD7965_REG_POF,    .wait = SEQ_WAIT_BUSY },
+    { .command = GD7965_REG_DSLP,   SEQ_DATA(GD7965_DSLP_CHECK) },
+};
 
-// Pointer to the framebuffer, given by caller module
-static uint8_t*             framebuffer_ptr     = NULL;
 static const char*          TAG                 = "display_driver";
-static bool                 transaction_started = false;
 static bool                 driver_configured   = false;
+static display_mode_t       driver_mode         = DISPLAY_MODE_KWR;
+static const char*          driver_lut_name     = "otp_kwr";
 
 #define CONFIG_CHECK()      {if (!driver_configured) { return false; }}
 
 // SPI device linked to the display
 static spi_device_handle_t  spi_dev;
 
-static bool spi_write_command(uint8_t command, bool keep_cs_active);
-static bool spi_write_data(uint8_t* data, uint16_t len);
-static bool spi_read_data(uint8_t* data, uint16_t len);
-static void spi_pre_transfer_callback(spi_transaction_t *t);
+// Queued SPI transactions, must live until their result is fetched
+static spi_transaction_t    spi_queue[DISPLAY_SPI_QUEUE_SIZE];
+static uint8_t              spi_queue_next      = 0;        // Slot of the next transaction
+static uint8_t              spi_queue_pending   = 0;        // Transactions in flight, in the slots before next
 
-static void display_wait_until_ready(void);
+// Given from the BUSY rising edge interrupt
+static SemaphoreHandle_t    busy_sem            = NULL;
 
-// Write a command to the display.
-static bool spi_write_command(uint8_t command, bool keep_cs_active)
-{
-    // Get bus ownership
-    spi_device_acquire_bus(spi_dev, portMAX_DELAY);
+static bool spi_queue_transfer(bool is_data, const uint8_t* data, size_t len, bool keep_cs_active);
+static bool spi_wait_pending(uint8_t max_pending);
+static bool spi_flush_queue(void);
+static bool spi_read_register(uint8_t command, uint8_t* data, uint16_t len, bool wait_ready);
+static void spi_pre_transfer_callback(spi_transaction_t *t);
+static void busy_isr_handler(void* arg);
 
-    spi_transaction_t t = {0};
-    t.length    = 8;        // Command is 8 bits
-    t.tx_buffer = &command; // The data is the cmd itself
-    t.user      = (void*)0; // D/C needs to be set to 0
+static void display_delay_us(uint32_t delay_us);
+static bool display_wait_until_ready(void);
+static bool display_run_sequence(const display_cmd_t* seq, size_t count);
+static bool display_load_kw_lut(void);
+static bool display_queue_plane(uint8_t plane, const uint8_t* framebuffer, display_plane_reader_t reader,
+                                uint8_t* bounce, uint32_t chunk_len);
 
-    if (keep_cs_active) {
-        t.flags = SPI_TRANS_CS_KEEP_ACTIVE;   //Keep CS active after data transfer
+// Queue a command (D/C low) or data (D/C high) transfer. The bus has to be acquired
+static bool spi_queue_transfer(bool is_data, const uint8_t* data, size_t len, bool keep_cs_active)
+{
+    // Make room in the queue, the slot of the oldest transaction is reused
+    if (!spi_wait_pending(DISPLAY_SPI_QUEUE_SIZE - 1U))
+    {
+        return false;
     }
 
-    // Transmit & wait until done
-    transaction_started = true;
-    esp_err_t ret = spi_device_polling_transmit(spi_dev, &t);
+    spi_transaction_t* t = &spi_queue[spi_queue_next];
+    memset(t, 0, sizeof(spi_transaction_t));
+    t->length = 8*len;
+    t->user   = (void*) (is_data ? 1 : 0);
 
-    // Release bus if the transaction is finished
-    if (!keep_cs_active) {
-        transaction_started = false;
-        spi_device_release_bus(spi_dev);
+    // Short payloads are copied in the transaction itself, no DMA buffer needed
+    if (len <= sizeof(t->tx_data))
+    {
+        memcpy(t->tx_data, data, len);
+        t->flags |= SPI_TRANS_USE_TXDATA;
+    }
+    else
+    {
+        t->tx_buffer = data;
     }
 
-    return (ret == ESP_OK);
-}
+    if (keep_cs_active)
+    {
+        t->flags |= SPI_TRANS_CS_KEEP_ACTIVE;   // Keep CS active after data transfer
+    }
 
-// Write data to the display/ Has to be called after spi_write_command
-static bool spi_write_data(uint8_t* data, uint16_t len)
-{
-    if (!transaction_started)
+    if (spi_device_queue_trans(spi_dev, t, portMAX_DELAY) != ESP_OK)
     {
         return false;
     }
 
-    // Send len bytes, D/C set to 1
-    spi_transaction_t t = {0};
-    t.length    = 8*len;
-    t.tx_buffer = data;
-    t.user      = (void*)1;
+    spi_queue_next = (spi_queue_next + 1U) % DISPLAY_SPI_QUEUE_SIZE;
+    spi_queue_pending++;
+    return true;
+}
 
-    // Transmit then release bus
-    esp_err_t ret = spi_device_polling_transmit(spi_dev, &t);
-    spi_device_release_bus(spi_dev);
+// Wait until at most max_pending queued transfers are in flight
+static bool spi_wait_pending(uint8_t max_pending)
+{
+    bool ok = true;
 
-    transaction_started = false;
+    while (spi_queue_pending > max_pending)
+    {
+        spi_transaction_t* t;
+        ok &= (spi_device_get_trans_result(spi_dev, &t, portMAX_DELAY) == ESP_OK);
+        spi_queue_pending--;
+    }
 
-    return (ret == ESP_OK);
+    return ok;
 }
 
-// Read data from the display/ Has to be called after spi_write_command
-static bool spi_read_data(uint8_t* data, uint16_t len)
+// Wait until all the queued transfers are done
+static bool spi_flush_queue(void)
 {
-    if (!transaction_started)
-    {
-        return false;
-    }
+    return spi_wait_pending(0);
+}
 
-    // Send len bytes, S/C set to 1
+// Read a register of the display. The bus has to be acquired and the queue empty
+// If wait_ready is set, the result is read once the display is done measuring it
+static bool spi_read_register(uint8_t command, uint8_t* data, uint16_t len, bool wait_ready)
+{
+    // Command, D/C set to 0, keep CS active for the read phase
     spi_transaction_t t = {0};
-    t.rxlength  = 8*len;
-    t.user      = (void*)1;
-    t.rx_buffer = data;
+    t.length    = 8;
+    t.tx_buffer = &command;
+    t.user      = (void*)0;
+    t.flags     = SPI_TRANS_CS_KEEP_ACTIVE;
 
-    // Receive then release bus
     esp_err_t ret = spi_device_polling_transmit(spi_dev, &t);
-    spi_device_release_bus(spi_dev);
 
-    transaction_started = false;
+    if ((ret == ESP_OK) && wait_ready && !display_wait_until_ready())
+    {
+        ret = ESP_ERR_TIMEOUT;
+    }
+
+    // Receive len bytes, D/C set to 1
+    if (ret == ESP_OK)
+    {
+        memset(&t, 0, sizeof(t));
+        t.rxlength  = 8*len;
+        t.user      = (void*)1;
+        t.rx_buffer = data;
+        ret = spi_device_polling_transmit(spi_dev, &t);
+    }
 
     return (ret == ESP_OK);
 }
@@ -159,18 +321,115 @@ static void spi_pre_transfer_callback(spi_transaction_t *t)
 {
     uint8_t dc = (uint8_t) t->user;
 
-    gpio_set_level(PIN_DISPLAY_DC, dc);
+    gpio_set_level(PANEL_PIN_DC, dc);
+}
+
+// BUSY line went back to idle
+static void IRAM_ATTR busy_isr_handler(void* arg)
+{
+    BaseType_t higher_prio_woken = pdFALSE;
+    xSemaphoreGiveFromISR(busy_sem, &higher_prio_woken);
+
+    if (higher_prio_woken)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+// Delay without sleeping below one tick
+static void display_delay_us(uint32_t delay_us)
+{
+    if (delay_us >= (portTICK_PERIOD_MS * 1000U))
+    {
+        vTaskDelay(delay_us / (portTICK_PERIOD_MS * 1000U));
+    }
+    else if (delay_us > 0)
+    {
+        esp_rom_delay_us(delay_us);
+    }
 }
 
 // Wait until the BUSY line of the display gets back to idle
-static void display_wait_until_ready(void)
+static bool display_wait_until_ready(void)
 {
+    // Let the display pull BUSY down after the last command
+    esp_rom_delay_us(PANEL_BUSY_SETTLE_US);
+
+    // Drop a stale edge, then sleep until the rising edge if still busy
+    xSemaphoreTake(busy_sem, 0);
+
     // Display is busy if busy pin is low
-    do
+    if (gpio_get_level(PANEL_PIN_BUSY) == 0)
+    {
+        xSemaphoreTake(busy_sem, pdMS_TO_TICKS(PANEL_BUSY_TIMEOUT_MS));
+    }
+
+    if (gpio_get_level(PANEL_PIN_BUSY) == 0)
+    {
+        ESP_LOGE(TAG, "Timeout waiting for the display");
+        return false;
+    }
+
+    return true;
+}
+
+// Execute a command sequence. The bus has to be acquired
+static bool display_run_sequence(const display_cmd_t* seq, size_t count)
+{
+    bool ok = true;
+
+    for (size_t i = 0; ok && (i < count); i++)
+    {
+        const display_cmd_t* cmd = &seq[i];
+
+        ok = spi_queue_transfer(false, &cmd->command, 1, (cmd->len > 0));
+
+        if (ok && (cmd->len > 0))
+        {
+            ok = spi_queue_transfer(true, cmd->data, cmd->len, false);
+        }
+
+        // Commands are sent back to back unless the display has to settle
+        if (ok && ((cmd->wait != SEQ_WAIT_NONE) || (cmd->delay_ms > 0)))
+        {
+            ok = spi_flush_queue();
+            display_delay_us(cmd->delay_ms * 1000U);
+
+            if (ok && (cmd->wait == SEQ_WAIT_BUSY))
+            {
+                ok = display_wait_until_ready();
+            }
+        }
+    }
+
+    return (spi_flush_queue() && ok);
+}
+
+// Pick and load the KW LUT matching the panel temperature. The bus has to be acquired
+static bool display_load_kw_lut(void)
+{
+    uint8_t temp_raw[2] = {0};
+    size_t band = LUT_BAND_DEFAULT;
+
+    // Integer part of the temperature is the first byte, signed
+    if (display_run_sequence(seq_temp_select, SEQ_LEN(seq_temp_select))
+        && spi_read_register(GD7965_REG_TSC, temp_raw, 2, true))
+    {
+        int8_t temp = (int8_t) temp_raw[0];
+
+        for (band = 0; temp > lut_bands[band].max_temp; band++);
+
+        ESP_LOGI(TAG, "Panel temperature %d C", temp);
+    }
+    else
     {
-        vTaskDelay(1);
+        ESP_LOGW(TAG, "Can't read panel temperature");
     }
-    while (gpio_get_level(PIN_DISPLAY_BUSY) == 0);
+
+    driver_lut_name = lut_bands[band].name;
+
+    return display_run_sequence(lut_bands[band].seq, lut_bands[band].len)
+        && display_run_sequence(seq_mode_kw, SEQ_LEN(seq_mode_kw));
 }
 
 // Refresh the display, i.e. show the framebuffer
@@ -180,9 +439,14 @@ bool display_refresh(void)
 
     ESP_LOGI(TAG, "display_refresh");
 
-    bool ret = spi_write_command(GD7965_REG_DRF, false);
-    vTaskDelay(100 / portTICK_PERIOD_MS);
-    display_wait_until_ready();
+    int64_t start = esp_timer_get_time();
+
+    spi_device_acquire_bus(spi_dev, portMAX_DELAY);
+    bool ret = display_run_sequence(seq_refresh, SEQ_LEN(seq_refresh));
+    spi_device_release_bus(spi_dev);
+
+    ESP_LOGI(TAG, "Refresh with LUT %s took %" PRId32 " ms",
+             driver_lut_name, (int32_t) ((esp_timer_get_time() - start) / 1000));
 
     return ret;
 }
@@ -194,68 +458,155 @@ bool display_low_power_mode(void)
 
     ESP_LOGI(TAG, "display_low_power_mode");
 
-    // Power-off display
-    uint8_t cnt = spi_write_command(GD7965_REG_POF, false);
-    display_wait_until_ready();
+    spi_device_acquire_bus(spi_dev, portMAX_DELAY);
+    bool ret = display_run_sequence(seq_low_power, SEQ_LEN(seq_low_power));
+    spi_device_release_bus(spi_dev);
+
+    // Only a hardware reset gets the display out of deep-sleep
+    driver_configured = false;
+
+    return ret;
+}
+
+// Queue the data of a plane. The bus has to be acquired
+// Without reader the framebuffer is sent as is, else chunks are produced in two bounce buffers
+static bool display_queue_plane(uint8_t plane, const uint8_t* framebuffer, display_plane_reader_t reader,
+                                uint8_t* bounce, uint32_t chunk_len)
+{
+    if (reader == NULL)
+    {
+        return spi_queue_transfer(true, framebuffer + plane * FRAMEBUFFER_PLANE_SIZE, FRAMEBUFFER_PLANE_SIZE, false);
+    }
+
+    bool ret = true;
+
+    for (uint32_t offset = 0, k = 0; ret && (offset < FRAMEBUFFER_PLANE_SIZE); offset += chunk_len, k++)
+    {
+        uint8_t* buff = bounce + (k & 1U) * chunk_len;
+        uint32_t len  = MIN(chunk_len, FRAMEBUFFER_PLANE_SIZE - offset);
+
+        // The transfer queued two chunks ago used this buffer
+        ret = spi_wait_pending(1);
 
-    // Deep-sleep for the driver
-    cnt += spi_write_command(GD7965_REG_DSLP, true);
-    uint8_t check_data = GD7965_DSLP_CHECK;
-    cnt += spi_write_data(&check_data, 1);
+        if (ret)
+        {
+            reader(plane, offset, buff, len);
 
-    return (cnt == 3);
+            // Data goes on until the end of the plane
+            ret = spi_queue_transfer(true, buff, len, (offset + len) < FRAMEBUFFER_PLANE_SIZE);
+        }
+    }
+
+    return ret;
 }
 
 // Transfer framebuffer to the display
-bool display_transfer(void)
+bool display_transfer(const uint8_t* framebuffer, display_plane_reader_t reader, uint32_t chunk_len)
 {
     CONFIG_CHECK();
 
+    if ((reader == NULL) && (framebuffer == NULL))
+    {
+        return false;
+    }
+
     ESP_LOGI(TAG, "display_transfer");
 
-    // Black data
-    uint8_t cnt = spi_write_command(GD7965_REG_DTM1, true);
-    cnt += spi_write_data(framebuffer_ptr, FRAMEBUFFER_SIZE/2);
+    const uint8_t dtm1 = GD7965_REG_DTM1;
+    const uint8_t dtm2 = GD7965_REG_DTM2;
+    uint8_t* bounce = NULL;
+
+    if (reader != NULL)
+    {
+        bounce = heap_caps_malloc(2 * chunk_len, MALLOC_CAP_DMA);
+        if (bounce == NULL)
+        {
+            return false;
+        }
+    }
+
+    spi_device_acquire_bus(spi_dev, portMAX_DELAY);
+
+    bool ret;
 
-    // Red data
-    cnt += spi_write_command(GD7965_REG_DTM2, true);
-    cnt += spi_write_data(framebuffer_ptr + FRAMEBUFFER_SIZE/2, FRAMEBUFFER_SIZE/2);
+    if (driver_mode == DISPLAY_MODE_KW_FAST)
+    {
+        // KW mode only shows new data, our LUTs don't depend on the old one
+        ret = spi_queue_transfer(false, &dtm2, 1, true)
+           && display_queue_plane(0, framebuffer, reader, bounce, chunk_len);
+    }
+    else
+    {
+        // Black data
+        ret = spi_queue_transfer(false, &dtm1, 1, true)
+           && display_queue_plane(0, framebuffer, reader, bounce, chunk_len);
+
+        // Red data
+        ret = ret
+           && spi_queue_transfer(false, &dtm2, 1, true)
+           && display_queue_plane(1, framebuffer, reader, bounce, chunk_len);
+    }
+
+    ret = spi_flush_queue() && ret;
+    spi_device_release_bus(spi_dev);
 
-    return (cnt == 4);
+    heap_caps_free(bounce);
+
+    return ret;
 }
 
 // Initialize this module
-bool display_driver_init(uint8_t* framebuffer)
+bool display_driver_init(void)
 {
-    if (framebuffer == NULL)
+    spi_queue_next = 0;
+    spi_queue_pending = 0;
+
+    if (busy_sem == NULL)
+    {
+        busy_sem = xSemaphoreCreateBinary();
+    }
+    if (busy_sem == NULL)
     {
         return false;
     }
 
-    framebuffer_ptr = framebuffer;
-    transaction_started = false;
-
     // Initialize I/O
     // CS, RST and D/C are outputs
     gpio_config_t io_conf = {0};
-    io_conf.pin_bit_mask = ((1U << PIN_DISPLAY_DC) | (1U << PIN_DISPLAY_RST));
+    io_conf.pin_bit_mask = ((1U << PANEL_PIN_DC) | (1U << PANEL_PIN_RST));
     io_conf.mode = GPIO_MODE_OUTPUT;
     esp_err_t ret = gpio_config(&io_conf);
 
-    // BUSY pin is an input
+    // BUSY pin is an input, interrupt when it gets back to idle
     if (ret == ESP_OK)
     {
-        io_conf.pin_bit_mask = ((1U << PIN_DISPLAY_BUSY));
+        io_conf.pin_bit_mask = ((1U << PANEL_PIN_BUSY));
         io_conf.mode = GPIO_MODE_INPUT;
+        io_conf.intr_type = GPIO_INTR_POSEDGE;
         ret |= gpio_config(&io_conf);
     }
 
+    if (ret == ESP_OK)
+    {
+        // ISR service may already be installed by another module
+        ret = gpio_install_isr_service(0);
+        if (ret == ESP_ERR_INVALID_STATE)
+        {
+            ret = ESP_OK;
+        }
+    }
+
+    if (ret == ESP_OK)
+    {
+        ret = gpio_isr_handler_add(PANEL_PIN_BUSY, busy_isr_handler, NULL);
+    }
+
     // Set idle levels for CS, RST and CS
     if (ret == ESP_OK)
     {
-        gpio_set_level(PIN_DISPLAY_CS, 1);
-        gpio_set_level(PIN_DISPLAY_RST, 1);
-        gpio_set_level(PIN_DISPLAY_DC, 0);
+        gpio_set_level(PANEL_PIN_CS, 1);
+        gpio_set_level(PANEL_PIN_RST, 1);
+        gpio_set_level(PANEL_PIN_DC, 0);
     }
 
     if (ret == ESP_OK)
@@ -263,17 +614,17 @@ bool display_driver_init(uint8_t* framebuffer)
         // Configure SPI bus
         spi_bus_config_t buscfg = {
             .miso_io_num = -1,
-            .mosi_io_num = PIN_SPI_DATA,
-            .sclk_io_num = PIN_SPI_CLOCK,
+            .mosi_io_num = PANEL_PIN_SPI_DATA,
+            .sclk_io_num = PANEL_PIN_SPI_CLOCK,
             .quadwp_io_num = -1,
             .quadhd_io_num = -1,
             .max_transfer_sz = (FRAMEBUFFER_SIZE+1) * 8,
         };
         spi_device_interface_config_t devcfg = {
-            .clock_speed_hz = 1e6,                              // Clock out at 1 MHz
+            .clock_speed_hz = PANEL_SPI_CLOCK_HZ,               // Clock of the panel descriptor
             .mode = 0,                                          // SPI mode 0
-            .spics_io_num = PIN_DISPLAY_CS,                     // CS pin
-            .queue_size = 1,                                    // Don't queue SPI transactions
+            .spics_io_num = PANEL_PIN_CS,                       // CS pin
+            .queue_size = DISPLAY_SPI_QUEUE_SIZE,               // Queue sequences, wait only when needed
             .flags = SPI_DEVICE_3WIRE | SPI_DEVICE_HALFDUPLEX,  // MISO and MOSI on the same line, transmit then receive
             .pre_cb = spi_pre_transfer_callback                 // We'll play around with the D/C signal in this one
         };
@@ -292,75 +643,56 @@ bool display_driver_init(uint8_t* framebuffer)
 }
 
 // Sed configuration flow to the display
-bool display_configure(void)
+bool display_configure(display_mode_t mode)
 {
     ESP_LOGI(TAG, "display_configure");
 
-    // Hardware reset
-    gpio_set_level(PIN_DISPLAY_RST, 0);
-    vTaskDelay(200 / portTICK_PERIOD_MS);
-    gpio_set_level(PIN_DISPLAY_RST, 1);
-    vTaskDelay(200 / portTICK_PERIOD_MS);
+    // Hardware reset, the display is ready when BUSY gets back to idle
+    gpio_set_level(PANEL_PIN_RST, 0);
+    esp_rom_delay_us(PANEL_RESET_PULSE_US);
+    gpio_set_level(PANEL_PIN_RST, 1);
+    if (!display_wait_until_ready())
+    {
+        return false;
+    }
+
+    // Whole sequence in a single bus acquisition
+    spi_device_acquire_bus(spi_dev, portMAX_DELAY);
 
     // Detect driver
     uint8_t buff[7] = {0};
-    if (!spi_write_command(GD7965_REG_REV, true) || !spi_read_data(buff, 7))
+    bool ret = spi_read_register(GD7965_REG_REV, buff, 7, false);
+    if (!ret)
     {
         ESP_LOGE(TAG, "Can't write to display");
-        return false;
     }
-    if (buff[6] != GD7965_REVISION)
+    else if (buff[6] != PANEL_REVISION)
     {
         ESP_LOGE(TAG, "Display revision invalid");
-        return false;
+        ret = false;
     }
 
     // Init sequence
-    spi_write_command(GD7965_REG_PWR, true);
-    buff[0] = 0x07;    // Border LDO disabled, VD and VG generated from DC/DC
-    buff[1] = 0x07;    // OTP power from VPP pin, slow slew rate, VGH=20V, VGL=-20V
-    buff[2] = 0x3F;    // VDH=15V
-    buff[3] = 0x3F;    // VDL=-15V
-    spi_write_data(buff, 4);
+    if (ret)
+    {
+        ret = display_run_sequence(seq_init, SEQ_LEN(seq_init));
+    }
 
-    // Power on
-    spi_write_command(GD7965_REG_PON, false);
-    vTaskDelay(100 / portTICK_PERIOD_MS);
-    display_wait_until_ready();
-
-    // Power configuration
-    spi_write_command(GD7965_REG_PSR, true);
-    buff[0] = 0x0F;    // LUT from OTP, KWR mode, scan up, shift right, booster on
-    spi_write_data(buff, 1);
-
-    // Display resolution
-    spi_write_command(GD7965_REG_TRES, true);
-    buff[0] = DISPLAY_WIDTH >> 8;      // Horizontal resolution MSBs
-    buff[1] = DISPLAY_WIDTH & 0xFF;    // Horizontal resolution LSBs
-    buff[2] = DISPLAY_HEIGHT >> 8;     // Vertical resolution MSBs
-    buff[3] = DISPLAY_HEIGHT & 0xFF;   // Vertical resolution LSBs
-    spi_write_data(buff, 4);
-
-    spi_write_command(GD7965_REG_CDI, true);
-    buff[0] = 0x11;    // Border output high-Z disabled, border LUT new data to old data copy disabled, LUT
-    buff[1] = 0x07;    // VCOM and data interval 10 hsync
-    spi_write_data(buff, 2);
-
-    spi_write_command(GD7965_REG_TCON, true);
-    buff[0] = 0x22;    // Non-overlap periods 12
-    spi_write_data(buff, 1);
-
-    // Gates/sources settings
-    spi_write_command(GD7965_REG_GSST, true);
-    buff[0] = 0x00;    // HSTART
-    buff[1] = 0x00;
-    buff[2] = 0x00;    // VSTART
-    buff[3] = 0x00;
-    spi_write_data(buff, 4);
+    // Waveform selection
+    if (ret && (mode == DISPLAY_MODE_KW_FAST))
+    {
+        ret = display_load_kw_lut();
+    }
+    else if (ret)
+    {
+        driver_lut_name = "otp_kwr";
+        ret = display_run_sequence(seq_mode_kwr, SEQ_LEN(seq_mode_kwr));
+    }
 
-    // Partial mode disabled (refresh full display)
-    spi_write_command(GD7965_REG_PTOUT, false);
+    driver_mode = mode;
 
-    driver_configured = true;
-    return true;
-}
\ No newline at end of file
+    spi_device_release_bus(spi_dev);
+
+    driver_configured = ret;
+    return ret;
+}
@@ -9,14 +9,25 @@ extern "C" {
 
 #include "driver/spi_master.h"
 
+// Refresh modes
+typedef enum
+{
+    DISPLAY_MODE_KWR = 0,   // Black/white/red, waveform from OTP
+    DISPLAY_MODE_KW_FAST,   // Black/white only, faster waveform picked from panel temperature
+} display_mode_t;
+
 // Initialize this module
-bool    display_driver_init(uint8_t* framebuffer);
+bool    display_driver_init(void);
+
+// Configure the display driver for the given refresh mode
+bool    display_configure(display_mode_t mode);
 
-// Configure the display driver
-bool    display_configure(void);
+// Fill buff with the len bytes of a plane starting at offset, in display layout
+typedef void (*display_plane_reader_t)(uint8_t plane, uint32_t offset, uint8_t* buff, uint32_t len);
 
-// Transfer the framebuffer to the display
-bool    display_transfer(void);
+// Transfer a framebuffer to the display, it has to be DMA capable
+// If reader is not NULL, planes are produced through it by chunks of chunk_len bytes instead
+bool    display_transfer(const uint8_t* framebuffer, display_plane_reader_t reader, uint32_t chunk_len);
 
 // Refresh the display (show transfered buffer)
 bool    display_refresh(void);
@@ -5,25 +5,199 @@
 
 #include "esp_system.h"
 #include "esp_log.h"
-#include "nvs.h"
-#include "nvs_flash.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
 
 #include "display_config.h"
 #include "display_manager.h"
 #include "display_driver.h"
-
-#define STORAGE_NAMESPACE       "storage"
+#include "frame_rotate.h"
+#include "frame_store.h"
+#include "metrics.h"
+#include "update_job.h"
 
 // First half of the buffer is for white/black info, second half is for red/none
-static uint8_t framebuffer[FRAMEBUFFER_SIZE] = {0};
+#if FRAMEBUFFER_ON_DEMAND
+static uint8_t* framebuffer             = NULL;
+#else
+static uint8_t framebuffer_storage[FRAMEBUFFER_SIZE] __attribute__((aligned(4))) = {0};
+static uint8_t* framebuffer             = framebuffer_storage;
+#endif
 
 static const char *TAG                  = "display_manager";
+static frame_rotation_t rotation        = FRAME_ROTATION_0;
+static bool initialized                 = false;
+
+// Held by an upload, or by the main loop while it saves, sends or frees the framebuffer
+static portMUX_TYPE framebuffer_lock    = portMUX_INITIALIZER_UNLOCKED;
+static bool framebuffer_taken           = false;
+
+// Frame being sent through display_manager_read_plane
+static const uint8_t* source            = NULL;
+static frame_rotation_t source_rotation = FRAME_ROTATION_0;
+
+static bool display_manager_red_plane_empty(const uint8_t* planes);
+static void display_manager_read_plane(uint8_t plane, uint32_t offset, uint8_t* buff, uint32_t len);
+static bool display_manager_show_planes(const uint8_t* planes, frame_rotation_t planes_rotation, uint32_t job);
+
+// Produce display bands of the source frame while it is sent
+static void display_manager_read_plane(uint8_t plane, uint32_t offset, uint8_t* buff, uint32_t len)
+{
+    const uint8_t* data = source + plane * FRAMEBUFFER_PLANE_SIZE;
+
+    if (source_rotation == FRAME_ROTATION_0)
+    {
+        memcpy(buff, data + offset, len);
+    }
+    else
+    {
+        frame_rotate_band(data, buff, offset / FRAME_ROTATE_BAND_SIZE, source_rotation);
+    }
+}
+
+// A picture without red can use the fast black/white refresh
+static bool display_manager_red_plane_empty(const uint8_t* planes)
+{
+    const uint32_t* red = (const uint32_t*) (planes + FRAMEBUFFER_SIZE/2);
+    uint32_t acc = 0;
+
+    for (uint32_t i = 0; i < (FRAMEBUFFER_SIZE/2) / sizeof(uint32_t); i++)
+    {
+        acc |= red[i];
+    }
+
+    return (acc == 0);
+}
+
+// Send a frame to the display and refresh it
+// The framebuffer, when it is the frame, is given back once sent and moves its job to transferred
+static bool display_manager_show_planes(const uint8_t* planes, frame_rotation_t planes_rotation, uint32_t job)
+{
+    bool from_framebuffer = (planes == framebuffer);
+    uint8_t ret = 0;
+
+    if (display_manager_init())
+    {
+        display_mode_t mode = display_manager_red_plane_empty(planes) ? DISPLAY_MODE_KW_FAST : DISPLAY_MODE_KWR;
+        ESP_LOGI(TAG, "Showing %s frame", (mode == DISPLAY_MODE_KW_FAST) ? "black/white" : "black/white/red");
+
+        metrics_begin(METRIC_CONFIGURE);
+        ret += display_configure(mode);
+        metrics_end(METRIC_CONFIGURE);
+
+        // Planes are sent as they are when the SPI DMA can read them
+        // Else, rotated, in PSRAM or mapped from flash, they go through bounce buffers
+        metrics_begin(METRIC_TRANSFER);
+        source          = planes;
+        source_rotation = planes_rotation;
+        if ((planes_rotation == FRAME_ROTATION_0) && esp_ptr_dma_capable(planes))
+        {
+            ret += display_transfer(planes, NULL, 0);
+        }
+        else
+        {
+            ret += display_transfer(NULL, display_manager_read_plane, FRAME_ROTATE_BAND_SIZE);
+        }
+        source = NULL;
+        metrics_end(METRIC_TRANSFER);
+    }
+
+    // Stored frames played back do not belong to an upload
+    if (from_framebuffer)
+    {
+        if (ret == 2)
+        {
+            update_job_advance(job, UPDATE_JOB_TRANSFERRED);
+        }
+
+        // The panel has the frame, an upload can start during the refresh
+        display_manager_give_framebuffer();
+    }
+
+    if (ret != 2)
+    {
+        return false;
+    }
+
+    metrics_begin(METRIC_REFRESH);
+    ret += display_refresh();
+    metrics_end(METRIC_REFRESH);
+
+    return ret == 3;
+}
 
 uint8_t* display_manager_get_framebuffer(void)
 {
+#if FRAMEBUFFER_ON_DEMAND
+    if (framebuffer == NULL)
+    {
+        // PSRAM when there is some, else internal RAM the SPI DMA can read
+        framebuffer = heap_caps_malloc(FRAMEBUFFER_SIZE, MALLOC_CAP_SPIRAM);
+        if (framebuffer == NULL)
+        {
+            framebuffer = heap_caps_malloc(FRAMEBUFFER_SIZE, MALLOC_CAP_DMA);
+        }
+
+        if (framebuffer == NULL)
+        {
+            ESP_LOGE(TAG, "No room for the framebuffer, largest DMA block is %u bytes",
+                     (unsigned) heap_caps_get_largest_free_block(MALLOC_CAP_DMA));
+            return NULL;
+        }
+
+        memset(framebuffer, 0xFF, FRAMEBUFFER_SIZE/2);
+        memset(framebuffer + FRAMEBUFFER_SIZE/2, 0x0, FRAMEBUFFER_SIZE/2);
+    }
+#endif
+
     return framebuffer;
 }
 
+bool display_manager_take_framebuffer(TickType_t wait)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while (true)
+    {
+        taskENTER_CRITICAL(&framebuffer_lock);
+        bool taken = !framebuffer_taken;
+        framebuffer_taken = true;
+        taskEXIT_CRITICAL(&framebuffer_lock);
+
+        if (taken)
+        {
+            return true;
+        }
+
+        if ((xTaskGetTickCount() - start) >= wait)
+        {
+            return false;
+        }
+
+        vTaskDelay(1);
+    }
+}
+
+void display_manager_give_framebuffer(void)
+{
+    taskENTER_CRITICAL(&framebuffer_lock);
+    framebuffer_taken = false;
+    taskEXIT_CRITICAL(&framebuffer_lock);
+}
+
+void display_manager_release_framebuffer(void)
+{
+#if FRAMEBUFFER_ON_DEMAND
+    heap_caps_free(framebuffer);
+    framebuffer = NULL;
+#endif
+}
+
+bool display_manager_framebuffer_resident(void)
+{
+    return framebuffer != NULL;
+}
+
 uint32_t display_manager_get_framebuffer_size(void)
 {
     return FRAMEBUFFER_SIZE;
@@ -31,104 +205,101 @@ uint32_t display_manager_get_framebuffer_size(void)
 
 void display_manager_clear_framebuffer(void)
 {
+    if (display_manager_get_framebuffer() == NULL)
+    {
+        return;
+    }
+
     // Set framebuffer to full white
     memset(framebuffer, 0xFF, FRAMEBUFFER_SIZE/2);
     memset(framebuffer + FRAMEBUFFER_SIZE/2, 0x0, FRAMEBUFFER_SIZE/2);
 }
 
-bool display_manager_save_framebuffer(void)
+void display_manager_set_rotation(frame_rotation_t new_rotation)
 {
-    nvs_handle_t my_handle;
-    esp_err_t err;
-
-    // Open NVS
-    err = nvs_open(STORAGE_NAMESPACE, NVS_READWRITE, &my_handle);
-    if (err != ESP_OK)
-    {
-        return false;
-    }
+    rotation = new_rotation;
+}
 
-    // Read the size of memory space required for blob
-    size_t required_size = 0;  // Value will default to 0, if not set yet in NVS
-    err = nvs_get_blob(my_handle, "framebuffer", NULL, &required_size);
+frame_rotation_t display_manager_get_rotation(void)
+{
+    return rotation;
+}
 
-    if ((err != ESP_OK) && (err != ESP_ERR_NVS_NOT_FOUND)) 
-    {
-        return false;
-    }
+bool display_manager_save_framebuffer(void)
+{
+    return (framebuffer != NULL) && frame_store_save(framebuffer, rotation, NULL);
+}
 
-    // Write value
-    if (nvs_set_blob(my_handle, "framebuffer", framebuffer, required_size) != ESP_OK) 
-    {
-        return false;
-    }
+bool display_manager_restore_framebuffer(void)
+{
+    frame_store_entry_t latest;
 
-    // Commit
-    if (nvs_commit(my_handle) != ESP_OK)
+    if (!frame_store_latest(&latest) || (display_manager_get_framebuffer() == NULL)
+        || !frame_store_load(latest.id, framebuffer))
     {
         return false;
     }
 
-    // Close
-    nvs_close(my_handle);
+    rotation = latest.rotation;
     return true;
 }
 
-bool display_manager_restore_framebuffer(void)
+bool display_manager_init(void)
 {
-    nvs_handle_t my_handle;
-    esp_err_t err;
-
-    // Open NVS
-    err = nvs_open(STORAGE_NAMESPACE, NVS_READWRITE, &my_handle);
-    if (err != ESP_OK)
+    if (!initialized)
     {
-        return false;
+        initialized = display_driver_init();
     }
 
-    // Read the size of memory space required for blob
-    size_t required_size = 0;  // value will default to 0, if not set yet in NVS
-    err = nvs_get_blob(my_handle, "framebuffer", NULL, &required_size);
+    return initialized;
+}
 
-    // Fail if corrupted data or not set yet
-    if (((err != ESP_OK) && (err != ESP_ERR_NVS_NOT_FOUND)) || (required_size != FRAMEBUFFER_SIZE)) 
+bool display_manager_show(uint32_t job)
+{
+    if (framebuffer == NULL)
     {
+        display_manager_give_framebuffer();
         return false;
     }
 
-    // Read value
-    if (nvs_get_blob(my_handle, "framebuffer", framebuffer, &required_size) != ESP_OK) 
+    return display_manager_show_planes(framebuffer, rotation, job);
+}
+
+bool display_manager_show_stored(uint8_t id)
+{
+    frame_store_entry_t entry;
+    uint32_t map;
+
+    if (!frame_store_get(id, &entry))
     {
         return false;
     }
 
-    // Commit
-    if (nvs_commit(my_handle) != ESP_OK)
+    // Read from flash while it is sent, the framebuffer is left as it is
+    const uint8_t* planes = frame_store_map(id, &map);
+    if (planes == NULL)
     {
         return false;
     }
 
-    // Close
-    nvs_close(my_handle);
-    return true;
-}
+    bool ret = display_manager_show_planes(planes, entry.rotation, 0);
+    frame_store_unmap(map);
 
-bool display_manager_init(void)
-{
-    return display_driver_init(framebuffer);
+    return ret;
 }
 
-bool display_manager_show(void)
+bool display_manager_power_saving(void)
 {
-    uint8_t ret = 0;
-    ret += display_configure();
-    ret += display_transfer();
-    ret += display_refresh();
+    // Still in deep sleep since the last cycle, no need to wake it
+    if (!initialized && (esp_reset_reason() == ESP_RST_DEEPSLEEP))
+    {
+        return true;
+    }
 
-    return ret == 3;
-}
+    if (!display_manager_init())
+    {
+        return false;
+    }
 
-bool display_manager_power_saving(void)
-{
     return display_low_power_mode();
 }
\ No newline at end of file
@@ -7,27 +7,57 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "freertos/FreeRTOS.h"
+
+#include "frame_rotate.h"
+
 // Get a pointer to the framebuffer.
 // First half of framebuffer is for white/black, second half is for red/none
 // 1 byte = 8 pixels. MSB = pixel 7n
+// With FRAMEBUFFER_ON_DEMAND, it is allocated white by the first call and can be NULL
 uint8_t* display_manager_get_framebuffer(void);
 
+// Take the framebuffer to write it or read it whole, an upload holds it until it ends
+// Return false if it is still taken by another task after wait ticks
+bool     display_manager_take_framebuffer(TickType_t wait);
+
+// Give back the framebuffer taken by display_manager_take_framebuffer
+void     display_manager_give_framebuffer(void);
+
+// Free the framebuffer with FRAMEBUFFER_ON_DEMAND, its content is lost. Call with the framebuffer taken
+void     display_manager_release_framebuffer(void);
+
+// Tell the framebuffer is allocated, always true without FRAMEBUFFER_ON_DEMAND
+bool     display_manager_framebuffer_resident(void);
+
 // Get the framebuffer size
 uint32_t display_manager_get_framebuffer_size(void);
 
 void     display_manager_clear_framebuffer(void);
 
-// Save the framebuffer to NVM
+// Save the framebuffer as a new frame of the frame store
 bool     display_manager_save_framebuffer(void);
 
-// Restore the framebuffer from NVM
+// Restore the newest frame of the frame store
 bool     display_manager_restore_framebuffer(void);
 
-// Initialize this module
+// Set the rotation applied to the framebuffer when showing it
+// With 90 and 270, the framebuffer holds a portrait frame
+void     display_manager_set_rotation(frame_rotation_t rotation);
+
+frame_rotation_t display_manager_get_rotation(void);
+
+// Initialize this module, done by the first display_manager_show or display_manager_power_saving
 bool     display_manager_init(void);
 
 // Transfer the buffer to the displan then send it to sleep mode
-bool     display_manager_show(void);
+// Frames without red are shown with the fast black/white refresh
+// Call with the framebuffer taken, it is given back once sent: the refresh does not read it
+// The update job of the frame moves to transferred then, 0 if none
+bool     display_manager_show(uint32_t job);
+
+// Show a frame of the frame store, read from flash while it is sent, without the framebuffer
+bool     display_manager_show_stored(uint8_t id);
 
 // Put the display to lowest power mode
 bool    display_manager_power_saving(void);
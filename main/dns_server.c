@@ -9,172 +9,257 @@
 
 #include <sys/param.h>
 #include <inttypes.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include "esp_log.h"
 #include "esp_system.h"
 #include "esp_netif.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
-#include "lwip/err.h"
 #include "lwip/sockets.h"
-#include "lwip/sys.h"
-#include "lwip/netdb.h"
 
-#define DNS_PORT (53)
-#define DNS_MAX_LEN (256)
+#include "dns_server.h"
+#include "trace.h"
 
-#define OPCODE_MASK (0x7800)
-#define QR_FLAG (1 << 7)
+#ifndef DNS_PORT
+#define DNS_PORT (53)
+#endif
+#define DNS_MAX_LEN (512)
+
+#define QR_FLAG (0x80)
+#define OPCODE_MASK (0x78)
+#define RCODE_NOERROR (0)
+#define RCODE_FORMERR (1)
+#define RCODE_NXDOMAIN (3)
+#define COMPRESSED_NAME (0xC0)
 #define QD_TYPE_A (0x0001)
-#define ANS_TTL_SEC (300)
+#define QD_TYPE_SOA (0x0006)
+#define QD_CLASS_IN (0x0001)
+#define RULE_ANY_TYPE (0x0000)
+#define SOA_RDATA_LEN (22)
 
 static const char *TAG              = "dns_redirect_server";
-static const char APP_DNS_NAME[]    = "paperframe.io";
+
+// Names in wire format: each label prefixed with its length, ends with the root label
+static const uint8_t APP_DNS_NAME[] = "\x0a" "paperframe" "\x02" "io";
+static const uint8_t ARPA_DNS_NAME[] = "\x04" "arpa";
 
 // DNS Header Packet
 typedef struct __attribute__((__packed__))
 {
     uint16_t id;
-    uint16_t flags;
+    uint8_t flags_hi;       // QR, opcode, AA, TC, RD
+    uint8_t flags_lo;       // RA, Z, rcode
     uint16_t qd_count;
     uint16_t an_count;
     uint16_t ns_count;
     uint16_t ar_count;
 } dns_header_t;
 
-// DNS Question Packet
-typedef struct {
-    uint16_t type;
-    uint16_t class;
-} dns_question_t;
+typedef enum {
+    DNS_ANSWER,             // A record with the softAP address
+    DNS_NODATA,             // The name exists, without records of this type
+    DNS_NXDOMAIN,           // The name does not exist
+} dns_action_t;
 
-// DNS Answer Packet
-typedef struct __attribute__((__packed__))
-{
-    uint16_t ptr_offset;
-    uint16_t type;
-    uint16_t class;
-    uint32_t ttl;
-    uint16_t addr_len;
-    uint32_t ip_addr;
-} dns_answer_t;
+typedef struct {
+    const uint8_t *name;    // Name suffix in wire format, NULL for any name
+    uint16_t type;          // Query type, RULE_ANY_TYPE for any type
+    dns_action_t action;
+    uint32_t ttl;           // TTL of the answer, or negative TTL
+} dns_rule_t;
+
+// Policy, the first matching rule wins
+static const dns_rule_t dns_rules[] = {
+    { APP_DNS_NAME,  QD_TYPE_A,     DNS_ANSWER,   300 },
+    // No reverse zones
+    { ARPA_DNS_NAME, RULE_ANY_TYPE, DNS_NXDOMAIN, 60 },
+    // Every other name leads to the portal, shortly so phones forget it back on their network
+    { NULL,          QD_TYPE_A,     DNS_ANSWER,   10 },
+    // No AAAA, HTTPS, SVCB...: clients go on with A right away instead of timing out
+    { NULL,          RULE_ANY_TYPE, DNS_NODATA,   60 },
+};
+
+// The softAP address never changes, it is read once
+static uint8_t answer_address[4];
 
 /*
-    Parse the name from the packet from the DNS name format to a regular .-seperated name
-    returns the pointer to the next part of the packet
+    Walk the name at the start of a question, in wire format, and count its labels
+    Names ending with a pointer count no labels, they only match rules for any name
+    returns the pointer to the next part of the packet, NULL if malformed
 */
-static char *parse_dns_name(char *raw_name, char *parsed_name, size_t parsed_name_max_len)
+static const uint8_t *parse_dns_name(const uint8_t *label, const uint8_t *end, uint8_t *labels)
 {
+    *labels = 0;
+
+    while (label < end) {
+        uint8_t len = *label;
 
-    char *label = raw_name;
-    char *name_itr = parsed_name;
-    int name_len = 0;
+        if (len == 0) {
+            return label + 1;
+        }
+
+        if ((len & COMPRESSED_NAME) != 0) {
+            *labels = 0;
+            return (label + 2 <= end) ? label + 2 : NULL;
+        }
 
-    do {
-        int sub_name_len = *label;
-        // (len + 1) since we are adding  a '.'
-        name_len += (sub_name_len + 1);
-        if (name_len > parsed_name_max_len) {
+        if (label + 1 + len > end) {
             return NULL;
         }
 
-        // Copy the sub name that follows the the label
-        memcpy(name_itr, label + 1, sub_name_len);
-        name_itr[sub_name_len] = '.';
-        name_itr += (sub_name_len + 1);
-        label += sub_name_len + 1;
-    } while (*label != 0);
-
-    // Terminate the final string, replacing the last '.'
-    parsed_name[name_len - 1] = '\0';
-    // Return pointer to first char after the name
-    return label + 1;
+        (*labels)++;
+        label += len + 1;
+    }
+
+    return NULL;
 }
 
-// Parses the DNS request and prepares a DNS response with the IP of the softAP
-static int parse_dns_request(char *req, size_t req_len, char *dns_reply, size_t dns_reply_max_len)
+// Tell if a name of the given label count ends with suffix, ignoring ASCII case
+static bool dns_name_ends_with(const uint8_t *name, uint8_t labels, const uint8_t *suffix)
 {
-    if (req_len > dns_reply_max_len) {
-        return -1;
+    uint8_t suffix_labels = 0;
+    for (const uint8_t *s = suffix; *s != 0; s += *s + 1) {
+        suffix_labels++;
     }
 
-    // Prepare the reply
-    memset(dns_reply, 0, dns_reply_max_len);
-    memcpy(dns_reply, req, req_len);
+    if ((labels == 0) || (suffix_labels > labels)) {
+        return false;
+    }
 
-    // Endianess of NW packet different from chip
-    dns_header_t *header = (dns_header_t *)dns_reply;
-    ESP_LOGD(TAG, "DNS query with header id: 0x%X, flags: 0x%X, qd_count: %d",
-             ntohs(header->id), ntohs(header->flags), ntohs(header->qd_count));
+    for (; labels > suffix_labels; labels--) {
+        name += *name + 1;
+    }
 
-    // Not a standard query
-    if ((header->flags & OPCODE_MASK) != 0) {
-        return 0;
+    // Lengths are at most 63, lowering them is harmless
+    for (; *suffix != 0; name++, suffix++) {
+        uint8_t c = *name;
+        if ((uint8_t) (c - 'A') < 26) {
+            c |= 0x20;
+        }
+        if (c != *suffix) {
+            return false;
+        }
     }
 
-    // Set question response flag
-    header->flags |= QR_FLAG;
+    return *name == 0;
+}
 
-    uint16_t qd_count = ntohs(header->qd_count);
-    header->an_count = htons(qd_count);
+static const dns_rule_t *dns_match_rule(const uint8_t *name, uint8_t labels, uint16_t qd_type, uint16_t qd_class)
+{
+    const dns_rule_t *rule = dns_rules;
 
-    int reply_len = qd_count * sizeof(dns_answer_t) + req_len;
-    if (reply_len > dns_reply_max_len) {
-        return -1;
+    // The last rule matches everything
+    for (; rule < &dns_rules[sizeof(dns_rules) / sizeof(dns_rules[0]) - 1]; rule++) {
+        bool type_match = (rule->type == RULE_ANY_TYPE) || ((rule->type == qd_type) && (qd_class == QD_CLASS_IN));
+        if (type_match && ((rule->name == NULL) || dns_name_ends_with(name, labels, rule->name))) {
+            break;
+        }
     }
 
-    // Pointer to current answer and question
-    char *cur_ans_ptr = dns_reply + req_len;
-    char *cur_qd_ptr = dns_reply + sizeof(dns_header_t);
-    char name[128];
-
-    // Respond to all questions with the ESP32's IP address
-    for (int i = 0; i < qd_count; i++) {
-        char *name_end_ptr = parse_dns_name(cur_qd_ptr, name, sizeof(name));
-        if (name_end_ptr == NULL) {
-            ESP_LOGE(TAG, "Failed to parse DNS question: %s", cur_qd_ptr);
-            return -1;
-        }
+    return rule;
+}
 
-        dns_question_t *question = (dns_question_t *)(name_end_ptr);
-        uint16_t qd_type = ntohs(question->type);
-        uint16_t qd_class = ntohs(question->class);
+// Append a record owned by the question name, return the byte after it
+static uint8_t *write_dns_record(uint8_t *p, uint16_t type, uint32_t ttl, const uint8_t *rdata, uint16_t rdata_len)
+{
+    *p++ = COMPRESSED_NAME;
+    *p++ = sizeof(dns_header_t);
+    *p++ = type >> 8;
+    *p++ = type;
+    *p++ = QD_CLASS_IN >> 8;
+    *p++ = QD_CLASS_IN;
+    *p++ = ttl >> 24;
+    *p++ = ttl >> 16;
+    *p++ = ttl >> 8;
+    *p++ = ttl;
+    *p++ = rdata_len >> 8;
+    *p++ = rdata_len;
+    memcpy(p, rdata, rdata_len);
+
+    return p + rdata_len;
+}
 
-        ESP_LOGD(TAG, "Received type: %d | Class: %d | Question for: %s", qd_type, qd_class, name);
+int dns_server_reply(uint8_t *packet, size_t len, size_t max_len)
+{
+    const uint8_t *end = packet + len;
+    dns_header_t *header = (dns_header_t *)packet;
 
-        // Redirect only when requesting our fancy domain
-        if (strcmp(name, APP_DNS_NAME) == 0)
-        {
-            if (qd_type == QD_TYPE_A) {
-                dns_answer_t *answer = (dns_answer_t *)cur_ans_ptr;
+    // Only standard queries
+    if ((len < sizeof(dns_header_t)) || (header->flags_hi & (QR_FLAG | OPCODE_MASK))) {
+        return 0;
+    }
 
-                answer->ptr_offset = htons(0xC000 | (cur_qd_ptr - dns_reply));
-                answer->type = htons(qd_type);
-                answer->class = htons(qd_class);
-                answer->ttl = htonl(ANS_TTL_SEC);
+    // Queries have a single question, anything else is a format error
+    uint8_t *reply_end = packet + sizeof(dns_header_t);
+    const dns_rule_t *rule = NULL;
+    if (ntohs(header->qd_count) == 1) {
+        uint8_t labels;
+        const uint8_t *question = parse_dns_name(reply_end, end, &labels);
+        if ((question == NULL) || (question + 4 > end)) {
+            return 0;
+        }
 
-                esp_netif_ip_info_t ip_info;
-                esp_netif_get_ip_info(esp_netif_get_handle_from_ifkey("WIFI_AP_DEF"), &ip_info);
-                ESP_LOGD(TAG, "Answer with PTR offset: 0x%" PRIX16 " and IP 0x%" PRIX32, ntohs(answer->ptr_offset), ip_info.ip.addr);
+        uint16_t qd_type = (question[0] << 8) | question[1];
+        uint16_t qd_class = (question[2] << 8) | question[3];
+        rule = dns_match_rule(reply_end, labels, qd_type, qd_class);
+        TRACE(TRACE_DNS_QUERY, qd_type, rule - dns_rules);
+        reply_end = (uint8_t *)question + 4;
+    }
 
-                answer->addr_len = htons(sizeof(ip_info.ip.addr));
-                answer->ip_addr = ip_info.ip.addr;
-            }
-        }
+    // The reply keeps the question, drops other records of the query and appends the answer
+    size_t record_len = 12 + ((rule == NULL) ? 0 : (rule->action == DNS_ANSWER) ? sizeof(answer_address) : SOA_RDATA_LEN);
+    if ((size_t) (reply_end - packet) + record_len > max_len) {
+        return 0;
+    }
+
+    header->flags_hi |= QR_FLAG;
+    header->flags_lo = RCODE_FORMERR;
+    header->qd_count = htons(rule != NULL);
+    header->an_count = 0;
+    header->ns_count = 0;
+    header->ar_count = 0;
+
+    if (rule == NULL) {
+        return reply_end - packet;
+    }
+
+    if (rule->action == DNS_ANSWER) {
+        header->flags_lo = RCODE_NOERROR;
+        header->an_count = htons(1);
+        reply_end = write_dns_record(reply_end, QD_TYPE_A, rule->ttl, answer_address, sizeof(answer_address));
+    } else {
+        // Negative answers are cached for the SOA minimum, see RFC 2308
+        // A minimal SOA for the name itself carries it, with root server names and zero timers
+        uint8_t soa[SOA_RDATA_LEN] = { 0 };
+        soa[SOA_RDATA_LEN - 4] = rule->ttl >> 24;
+        soa[SOA_RDATA_LEN - 3] = rule->ttl >> 16;
+        soa[SOA_RDATA_LEN - 2] = rule->ttl >> 8;
+        soa[SOA_RDATA_LEN - 1] = rule->ttl;
+
+        header->flags_lo = (rule->action == DNS_NXDOMAIN) ? RCODE_NXDOMAIN : RCODE_NOERROR;
+        header->ns_count = htons(1);
+        reply_end = write_dns_record(reply_end, QD_TYPE_SOA, rule->ttl, soa, sizeof(soa));
     }
-    return reply_len;
+
+    return reply_end - packet;
 }
 
 /*
     Sets up a socket and listen for DNS queries,
-    replies to all type A queries with the IP of the softAP
+    answers them following dns_rules
+    Replies are built in the receive buffer, nothing is logged unless a socket fails
 */
 void dns_server_task(void *pvParameters)
 {
-    char rx_buffer[128];
-    char addr_str[128];
-    int addr_family;
-    int ip_protocol;
+    uint8_t packet[DNS_MAX_LEN];
+
+    esp_netif_ip_info_t ip_info;
+    esp_netif_get_ip_info(esp_netif_get_handle_from_ifkey("WIFI_AP_DEF"), &ip_info);
+
+    memcpy(answer_address, &ip_info.ip.addr, sizeof(answer_address));
 
     while (1) {
 
@@ -182,16 +267,12 @@ void dns_server_task(void *pvParameters)
         dest_addr.sin_addr.s_addr = htonl(INADDR_ANY);
         dest_addr.sin_family = AF_INET;
         dest_addr.sin_port = htons(DNS_PORT);
-        addr_family = AF_INET;
-        ip_protocol = IPPROTO_IP;
-        inet_ntoa_r(dest_addr.sin_addr, addr_str, sizeof(addr_str) - 1);
 
-        int sock = socket(addr_family, SOCK_DGRAM, ip_protocol);
+        int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
         if (sock < 0) {
             ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
             break;
         }
-        ESP_LOGI(TAG, "Socket created");
 
         int err = bind(sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
         if (err < 0) {
@@ -200,41 +281,25 @@ void dns_server_task(void *pvParameters)
         ESP_LOGI(TAG, "Socket bound, port %d", DNS_PORT);
 
         while (1) {
-            ESP_LOGI(TAG, "Waiting for data");
             struct sockaddr_in6 source_addr; // Large enough for both IPv4 or IPv6
             socklen_t socklen = sizeof(source_addr);
-            int len = recvfrom(sock, rx_buffer, sizeof(rx_buffer) - 1, 0, (struct sockaddr *)&source_addr, &socklen);
+            int len = recvfrom(sock, packet, sizeof(packet), 0, (struct sockaddr *)&source_addr, &socklen);
 
             // Error occurred during receiving
             if (len < 0) {
                 ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
                 close(sock);
+                sock = -1;
                 break;
             }
-            // Data received
-            else {
-                // Get the sender's ip address as string
-                if (source_addr.sin6_family == PF_INET) {
-                    inet_ntoa_r(((struct sockaddr_in *)&source_addr)->sin_addr.s_addr, addr_str, sizeof(addr_str) - 1);
-                } else if (source_addr.sin6_family == PF_INET6) {
-                    inet6_ntoa_r(source_addr.sin6_addr, addr_str, sizeof(addr_str) - 1);
-                }
 
-                // Null-terminate whatever we received and treat like a string...
-                rx_buffer[len] = 0;
-
-                char reply[DNS_MAX_LEN];
-                int reply_len = parse_dns_request(rx_buffer, len, reply, DNS_MAX_LEN);
-
-                ESP_LOGI(TAG, "Received %d bytes from %s | DNS reply with len: %d", len, addr_str, reply_len);
-                if (reply_len <= 0) {
-                    ESP_LOGE(TAG, "Failed to prepare a DNS reply");
-                } else {
-                    int err = sendto(sock, reply, reply_len, 0, (struct sockaddr *)&source_addr, sizeof(source_addr));
-                    if (err < 0) {
-                        ESP_LOGE(TAG, "Error occurred during sending: errno %d", errno);
-                        break;
-                    }
+            // Malformed queries are dropped silently
+            int reply_len = dns_server_reply(packet, len, sizeof(packet));
+            if (reply_len > 0) {
+                int err = sendto(sock, packet, reply_len, 0, (struct sockaddr *)&source_addr, socklen);
+                if (err < 0) {
+                    ESP_LOGE(TAG, "Error occurred during sending: errno %d", errno);
+                    break;
                 }
             }
         }
@@ -13,13 +13,23 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
+
 /**
- * @brief Set ups and starts a simple DNS server that will respond to all queries
- * with the soft AP's IP address
+ * @brief Set ups and starts a simple DNS server that will answer A queries for all names
+ * with the soft AP's IP address, and other queries with cacheable negative replies
  *
  */
 void start_dns_server(void);
 
+/**
+ * @brief Turn the DNS query in packet into its reply, in place
+ *
+ * @return the length of the reply, 0 if the query is to be dropped
+ */
+int dns_server_reply(uint8_t *packet, size_t len, size_t max_len);
+
 
 #ifdef __cplusplus
 }
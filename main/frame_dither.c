@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "display_config.h"
+#include "display_manager.h"
+#include "frame_dither.h"
+
+// Error lines have one guard pixel on each side, sized for the longest frame row
+#define ERR_LINE_LEN            ((MAX(DISPLAY_WIDTH, DISPLAY_HEIGHT) + 2U) * 3U)
+
+// Palette entry and the bits it sets in each plane
+typedef struct
+{
+    int16_t     rgb[3];
+    uint8_t     bw;     // 1 for white
+    uint8_t     red;    // 1 for red
+} palette_entry_t;
+
+static const palette_entry_t palette_entries[] = {
+    { { 255, 255, 255 }, 1, 0 },    // White
+    { {   0,   0,   0 }, 0, 0 },    // Black
+    { { 255,   0,   0 }, 0, 1 },    // Red, only in KWR palette
+};
+
+static uint8_t      palette_len     = 0;
+static uint16_t     frame_width     = DISPLAY_WIDTH;
+static int16_t*     err_cur         = NULL;     // Error diffused to the current row
+static int16_t*     err_next        = NULL;     // Error diffused to the next row
+
+bool frame_dither_begin(frame_palette_t palette, uint16_t width)
+{
+    frame_dither_end();
+
+    palette_len = (palette == FRAME_PALETTE_KWR) ? 3 : 2;
+    frame_width = width;
+    err_cur     = calloc(ERR_LINE_LEN, sizeof(int16_t));
+    err_next    = calloc(ERR_LINE_LEN, sizeof(int16_t));
+
+    if ((err_cur == NULL) || (err_next == NULL) || (display_manager_get_framebuffer() == NULL))
+    {
+        frame_dither_end();
+        return false;
+    }
+
+    return true;
+}
+
+void frame_dither_row(uint16_t y, const uint8_t* rgb)
+{
+    uint8_t* fb     = display_manager_get_framebuffer();
+    uint8_t* bw_out = fb + y * (frame_width / 8U);
+    uint8_t* r_out  = bw_out + FRAMEBUFFER_PLANE_SIZE;
+    uint8_t  bw_acc = 0;
+    uint8_t  r_acc  = 0;
+
+    for (uint16_t x = 0; x < frame_width; x++)
+    {
+        int16_t* e = &err_cur[(x + 1U) * 3U];
+        int16_t  px[3];
+
+        for (uint8_t c = 0; c < 3; c++)
+        {
+            px[c] = rgb[x * 3U + c] + (e[c] >> 4);
+            px[c] = (px[c] < 0) ? 0 : ((px[c] > 255) ? 255 : px[c]);
+        }
+
+        // Nearest palette color, squared distance
+        const palette_entry_t* best = &palette_entries[0];
+        int32_t best_dist = INT32_MAX;
+
+        for (uint8_t i = 0; i < palette_len; i++)
+        {
+            int32_t dr = px[0] - palette_entries[i].rgb[0];
+            int32_t dg = px[1] - palette_entries[i].rgb[1];
+            int32_t db = px[2] - palette_entries[i].rgb[2];
+            int32_t dist = dr*dr + dg*dg + db*db;
+
+            if (dist < best_dist)
+            {
+                best_dist = dist;
+                best = &palette_entries[i];
+            }
+        }
+
+        bw_acc = (bw_acc << 1) | best->bw;
+        r_acc  = (r_acc << 1) | best->red;
+
+        // 1 byte = 8 pixels, MSB first
+        if ((x & 7U) == 7U)
+        {
+            bw_out[x >> 3] = bw_acc;
+            r_out[x >> 3]  = r_acc;
+        }
+
+        // Floyd-Steinberg, errors kept in 1/16th
+        int16_t* next = &err_next[(x + 1U) * 3U];
+        for (uint8_t c = 0; c < 3; c++)
+        {
+            int16_t err = px[c] - best->rgb[c];
+
+            e[c + 3]    += err * 7;
+            next[c - 3] += err * 3;
+            next[c]     += err * 5;
+            next[c + 3] += err;
+        }
+    }
+
+    // Next row starts with the diffused error, clean line for the one after
+    int16_t* tmp = err_cur;
+    err_cur  = err_next;
+    err_next = tmp;
+    memset(err_next, 0, ERR_LINE_LEN * sizeof(int16_t));
+}
+
+void frame_dither_end(void)
+{
+    free(err_cur);
+    free(err_next);
+
+    err_cur  = NULL;
+    err_next = NULL;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Colors the picture is reduced to
+typedef enum
+{
+    FRAME_PALETTE_KW = 0,   // Black and white
+    FRAME_PALETTE_KWR,      // Black, white and red
+} frame_palette_t;
+
+// Start dithering a frame of width pixels per row into the framebuffer, allocates the error lines
+// width is DISPLAY_WIDTH, or DISPLAY_HEIGHT for a portrait frame shown with a quarter turn
+bool    frame_dither_begin(frame_palette_t palette, uint16_t width);
+
+// Quantize a row of width RGB888 pixels with Floyd-Steinberg dithering
+// Rows must be given in order, from 0
+void    frame_dither_row(uint16_t y, const uint8_t* rgb);
+
+// Release the error lines
+void    frame_dither_end(void);
+
+#ifdef __cplusplus
+}
+#endif
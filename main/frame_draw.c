@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "display_config.h"
+#include "display_manager.h"
+#include "frame_draw.h"
+#include "frame_font.h"
+
+#define FONT_MAX_SCALE          6U      // Scaled glyph rows still fit in a word
+
+static inline uint32_t frame_draw_load(const uint8_t* p);
+static inline void frame_draw_store(uint8_t* p, uint32_t w);
+static inline uint32_t frame_draw_fetch(const frame_plane_t* plane, int32_t row, int32_t pos);
+static void frame_draw_rows(const frame_plane_t* dst, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                            const frame_plane_t* src, int32_t sx, int32_t sy,
+                            const frame_plane_t* mask, int32_t mx, int32_t my, bool value);
+static void frame_draw_masked(int16_t x, int16_t y, uint16_t w, uint16_t h, const frame_plane_t* mask, frame_color_t color);
+
+// Load 32 pixels, leftmost in the MSB
+static inline uint32_t frame_draw_load(const uint8_t* p)
+{
+    uint32_t w;
+    memcpy(&w, p, sizeof(w));
+    return __builtin_bswap32(w);
+}
+
+static inline void frame_draw_store(uint8_t* p, uint32_t w)
+{
+    w = __builtin_bswap32(w);
+    memcpy(p, &w, sizeof(w));
+}
+
+// Read 32 pixels of a plane row from any pixel position, pixels out of the plane read as 0
+static inline uint32_t frame_draw_fetch(const frame_plane_t* plane, int32_t row, int32_t pos)
+{
+    if ((row < 0) || (row >= plane->height) || (pos >= plane->width))
+    {
+        return 0;
+    }
+
+    const uint8_t* data = plane->data + row * plane->stride;
+    int32_t  byte   = pos >> 3;
+    uint32_t shift  = pos & 7;
+    uint64_t window = 0;
+
+    // 5 bytes cover 32 pixels at any bit offset
+    for (int32_t i = byte; i < byte + 5; i++)
+    {
+        window = (window << 8) | (((i >= 0) && (i < plane->stride)) ? data[i] : 0U);
+    }
+
+    uint32_t pixels = (uint32_t) (window >> (8U - shift));
+
+    // Drop the padding after the last pixel
+    int32_t left = plane->width - pos;
+    if (left < 32)
+    {
+        pixels &= ~(0xFFFFFFFFU >> left);
+    }
+
+    return pixels;
+}
+
+// Blit core, 32 destination pixels at a time
+// Source and mask are read at the destination position shifted by (sx - x, sy - y) and (mx - x, my - y)
+static void frame_draw_rows(const frame_plane_t* dst, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                            const frame_plane_t* src, int32_t sx, int32_t sy,
+                            const frame_plane_t* mask, int32_t mx, int32_t my, bool value)
+{
+    // Clip to the destination
+    int32_t x0 = MAX(x, 0);
+    int32_t y0 = MAX(y, 0);
+    int32_t x1 = MIN((int32_t) x + w, (int32_t) dst->width);
+    int32_t y1 = MIN((int32_t) y + h, (int32_t) dst->height);
+
+    if ((x0 >= x1) || (y0 >= y1))
+    {
+        return;
+    }
+
+    for (int32_t row = y0; row < y1; row++)
+    {
+        uint8_t* drow = dst->data + row * dst->stride;
+
+        for (int32_t word = x0 >> 5; word <= ((x1 - 1) >> 5); word++)
+        {
+            int32_t  px = word << 5;
+            uint32_t m  = 0xFFFFFFFFU;
+
+            // Edges of the area
+            if (px < x0)
+            {
+                m &= 0xFFFFFFFFU >> (x0 - px);
+            }
+            if ((px + 32) > x1)
+            {
+                m &= ~(0xFFFFFFFFU >> (x1 - px));
+            }
+
+            if (mask != NULL)
+            {
+                m &= frame_draw_fetch(mask, row + my - y, px + mx - x);
+            }
+
+            uint32_t s = (src != NULL) ? frame_draw_fetch(src, row + sy - y, px + sx - x)
+                                       : (value ? 0xFFFFFFFFU : 0U);
+            uint32_t d = frame_draw_load(drow + 4 * word);
+
+            frame_draw_store(drow + 4 * word, (d & ~m) | (s & m));
+        }
+    }
+}
+
+void frame_plane_blit(const frame_plane_t* dst, int16_t x, int16_t y,
+                      const frame_plane_t* src, int16_t sx, int16_t sy, uint16_t w, uint16_t h,
+                      const frame_plane_t* mask)
+{
+    frame_draw_rows(dst, x, y, w, h, src, sx, sy, mask, sx, sy, false);
+}
+
+void frame_plane_fill(const frame_plane_t* dst, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                      const frame_plane_t* mask, bool value)
+{
+    frame_draw_rows(dst, x, y, w, h, NULL, 0, 0, mask, 0, 0, value);
+}
+
+void frame_draw_get_planes(frame_plane_t* bw, frame_plane_t* red)
+{
+    frame_rotation_t rotation = display_manager_get_rotation();
+    bool portrait = (rotation == FRAME_ROTATION_90) || (rotation == FRAME_ROTATION_270);
+
+    // Without framebuffer, empty planes clip everything
+    bw->data    = display_manager_get_framebuffer();
+    bw->width   = (bw->data == NULL) ? 0 : portrait ? DISPLAY_HEIGHT : DISPLAY_WIDTH;
+    bw->height  = (bw->data == NULL) ? 0 : portrait ? DISPLAY_WIDTH : DISPLAY_HEIGHT;
+    bw->stride  = bw->width / 8U;
+
+    *red        = *bw;
+    red->data  += FRAMEBUFFER_PLANE_SIZE;
+}
+
+// Paint a color in both planes, where mask is set
+static void frame_draw_masked(int16_t x, int16_t y, uint16_t w, uint16_t h, const frame_plane_t* mask, frame_color_t color)
+{
+    frame_plane_t bw;
+    frame_plane_t red;
+
+    frame_draw_get_planes(&bw, &red);
+
+    frame_plane_fill(&bw, x, y, w, h, mask, color == FRAME_COLOR_WHITE);
+    frame_plane_fill(&red, x, y, w, h, mask, color == FRAME_COLOR_RED);
+}
+
+void frame_draw_rect(int16_t x, int16_t y, uint16_t w, uint16_t h, frame_color_t color)
+{
+    frame_draw_masked(x, y, w, h, NULL, color);
+}
+
+void frame_draw_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, frame_color_t color)
+{
+    int16_t dx      = abs(x1 - x0);
+    int16_t dy      = -abs(y1 - y0);
+    int16_t step_x  = (x0 < x1) ? 1 : -1;
+    int16_t step_y  = (y0 < y1) ? 1 : -1;
+    int32_t err     = dx + dy;
+    bool    flat    = (dx >= -dy);
+
+    // Bresenham, pixels are gathered in runs along the major axis and drawn as rectangles
+    int16_t run_x = x0;
+    int16_t run_y = y0;
+
+    while ((x0 != x1) || (y0 != y1))
+    {
+        int32_t e2 = 2 * err;
+        int16_t nx = x0;
+        int16_t ny = y0;
+
+        if (e2 >= dy)
+        {
+            err += dy;
+            nx  += step_x;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            ny  += step_y;
+        }
+
+        // The run ends when the minor coordinate moves
+        if (flat ? (ny != y0) : (nx != x0))
+        {
+            frame_draw_rect(MIN(run_x, x0), MIN(run_y, y0), abs(x0 - run_x) + 1, abs(y0 - run_y) + 1, color);
+            run_x = nx;
+            run_y = ny;
+        }
+
+        x0 = nx;
+        y0 = ny;
+    }
+
+    frame_draw_rect(MIN(run_x, x0), MIN(run_y, y0), abs(x0 - run_x) + 1, abs(y0 - run_y) + 1, color);
+}
+
+int16_t frame_draw_text(int16_t x, int16_t y, const char* text, uint8_t scale, frame_color_t color)
+{
+    uint8_t glyph[FRAME_FONT_HEIGHT * FONT_MAX_SCALE][4];
+    frame_plane_t mask = {
+        .data   = &glyph[0][0],
+        .width  = FRAME_FONT_WIDTH * scale,
+        .height = FRAME_FONT_HEIGHT * scale,
+        .stride = sizeof(glyph[0]),
+    };
+
+    if ((scale == 0) || (scale > FONT_MAX_SCALE))
+    {
+        return x;
+    }
+
+    for (; *text != '\0'; text++)
+    {
+        char c = *text;
+        if ((c < FRAME_FONT_FIRST) || (c > FRAME_FONT_LAST))
+        {
+            c = '?';
+        }
+
+        // Magnify the glyph: each pixel becomes a scale x scale square
+        for (uint8_t row = 0; row < FRAME_FONT_HEIGHT; row++)
+        {
+            uint8_t  bits   = frame_font[c - FRAME_FONT_FIRST][row];
+            uint32_t scaled = 0;
+
+            for (uint8_t col = 0; col < FRAME_FONT_WIDTH; col++)
+            {
+                uint32_t px = (bits >> (7U - col)) & 1U;
+                scaled |= (px ? (0xFFFFFFFFU >> (32U - scale)) : 0U) << (32U - scale * (col + 1U));
+            }
+
+            for (uint8_t r = 0; r < scale; r++)
+            {
+                frame_draw_store(glyph[row * scale + r], scaled);
+            }
+        }
+
+        frame_draw_masked(x, y, mask.width, mask.height, &mask, color);
+        x += FRAME_FONT_ADVANCE * scale;
+    }
+
+    return x;
+}
+
+void frame_draw_caption(const char* text)
+{
+    char     caption[FRAME_CAPTION_MAX + 1U];
+    uint16_t width;
+    uint16_t height = FRAME_FONT_HEIGHT * FRAME_CAPTION_SCALE + 2U * FRAME_CAPTION_MARGIN;
+    frame_plane_t bw;
+    frame_plane_t red;
+
+    frame_draw_get_planes(&bw, &red);
+    if (bw.data == NULL)
+    {
+        return;
+    }
+
+    snprintf(caption, sizeof(caption), "%s", text);
+    width = strlen(caption) * FRAME_FONT_ADVANCE * FRAME_CAPTION_SCALE;
+
+    // Too wide ones start at the margin and are clipped on the right
+    frame_draw_rect(0, bw.height - height, bw.width, height, FRAME_COLOR_WHITE);
+    frame_draw_text((width < bw.width - 2U * FRAME_CAPTION_MARGIN) ? (bw.width - width) / 2U : FRAME_CAPTION_MARGIN,
+                    bw.height - height + FRAME_CAPTION_MARGIN, caption, FRAME_CAPTION_SCALE, FRAME_COLOR_BLACK);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FRAME_CAPTION_MAX       64U     // Characters of a caption, longer ones are cut
+#define FRAME_CAPTION_SCALE     3U      // Of the 5x7 font
+#define FRAME_CAPTION_MARGIN    6U      // Pixels around the text, in its band
+
+// A 1-bpp plane, 1 byte = 8 pixels, MSB first
+typedef struct
+{
+    uint8_t*    data;
+    uint16_t    width;
+    uint16_t    height;
+    uint16_t    stride;     // Bytes per row
+} frame_plane_t;
+
+// Colors of the display, as set in both planes
+typedef enum
+{
+    FRAME_COLOR_BLACK = 0,
+    FRAME_COLOR_WHITE,
+    FRAME_COLOR_RED,
+} frame_color_t;
+
+// Copy a w x h area of src at (sx, sy) to dst at (x, y), only where mask is set if not NULL
+// mask is aligned with src. dst stride has to be a multiple of 4, pixels out of src read as 0
+void    frame_plane_blit(const frame_plane_t* dst, int16_t x, int16_t y,
+                         const frame_plane_t* src, int16_t sx, int16_t sy, uint16_t w, uint16_t h,
+                         const frame_plane_t* mask);
+
+// Set a w x h area of dst at (x, y) to value, only where mask is set if not NULL
+// mask top-left pixel is aligned with (x, y)
+void    frame_plane_fill(const frame_plane_t* dst, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                         const frame_plane_t* mask, bool value);
+
+// Get the planes of the framebuffer, in its current layout (portrait when rotated by a quarter)
+void    frame_draw_get_planes(frame_plane_t* bw, frame_plane_t* red);
+
+// Fill a rectangle of the framebuffer
+void    frame_draw_rect(int16_t x, int16_t y, uint16_t w, uint16_t h, frame_color_t color);
+
+// Draw a one pixel wide line of the framebuffer, ends included
+void    frame_draw_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, frame_color_t color);
+
+// Draw text with the built-in 5x7 font magnified by scale (1 to 6), (x, y) is the top-left corner
+// Returns the x position after the last glyph
+int16_t frame_draw_text(int16_t x, int16_t y, const char* text, uint8_t scale, frame_color_t color);
+
+// Stamp a caption across the bottom of the framebuffer: black text, centered on a white band
+void    frame_draw_caption(const char* text);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,120 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// 5x7 font for printable ASCII, one byte per row, leftmost pixel in the MSB
+// Glyphs are 1-bpp bitmaps in the same layout as the framebuffer planes
+
+#define FRAME_FONT_WIDTH        5U
+#define FRAME_FONT_HEIGHT       7U
+#define FRAME_FONT_ADVANCE      6U      // Glyph and one column of spacing
+#define FRAME_FONT_FIRST        ' '
+#define FRAME_FONT_LAST         '~'
+
+#define FONT_ROW(bits)          ((uint8_t) ((bits) << 3))
+
+static const uint8_t frame_font[FRAME_FONT_LAST - FRAME_FONT_FIRST + 1][FRAME_FONT_HEIGHT] = {
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000) },   // ' '
+    { FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00000), FONT_ROW(0b00100) },   // '!'
+    { FONT_ROW(0b01010), FONT_ROW(0b01010), FONT_ROW(0b01010), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000) },   // '"'
+    { FONT_ROW(0b01010), FONT_ROW(0b01010), FONT_ROW(0b11111), FONT_ROW(0b01010), FONT_ROW(0b11111), FONT_ROW(0b01010), FONT_ROW(0b01010) },   // '#'
+    { FONT_ROW(0b00100), FONT_ROW(0b01111), FONT_ROW(0b10100), FONT_ROW(0b01110), FONT_ROW(0b00101), FONT_ROW(0b11110), FONT_ROW(0b00100) },   // '$'
+    { FONT_ROW(0b11000), FONT_ROW(0b11001), FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b01000), FONT_ROW(0b10011), FONT_ROW(0b00011) },   // '%'
+    { FONT_ROW(0b01100), FONT_ROW(0b10010), FONT_ROW(0b10100), FONT_ROW(0b01000), FONT_ROW(0b10101), FONT_ROW(0b10010), FONT_ROW(0b01101) },   // '&'
+    { FONT_ROW(0b01100), FONT_ROW(0b00100), FONT_ROW(0b01000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000) },   // '\''
+    { FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b01000), FONT_ROW(0b01000), FONT_ROW(0b01000), FONT_ROW(0b00100), FONT_ROW(0b00010) },   // '('
+    { FONT_ROW(0b01000), FONT_ROW(0b00100), FONT_ROW(0b00010), FONT_ROW(0b00010), FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b01000) },   // ')'
+    { FONT_ROW(0b00000), FONT_ROW(0b00100), FONT_ROW(0b10101), FONT_ROW(0b01110), FONT_ROW(0b10101), FONT_ROW(0b00100), FONT_ROW(0b00000) },   // '*'
+    { FONT_ROW(0b00000), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b11111), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00000) },   // '+'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b01100), FONT_ROW(0b00100), FONT_ROW(0b01000) },   // ','
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b11111), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000) },   // '-'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b01100), FONT_ROW(0b01100) },   // '.'
+    { FONT_ROW(0b00000), FONT_ROW(0b00001), FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b01000), FONT_ROW(0b10000), FONT_ROW(0b00000) },   // '/'
+    { FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b10011), FONT_ROW(0b10101), FONT_ROW(0b11001), FONT_ROW(0b10001), FONT_ROW(0b01110) },   // '0'
+    { FONT_ROW(0b00100), FONT_ROW(0b01100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b01110) },   // '1'
+    { FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b00001), FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b01000), FONT_ROW(0b11111) },   // '2'
+    { FONT_ROW(0b11111), FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b00010), FONT_ROW(0b00001), FONT_ROW(0b10001), FONT_ROW(0b01110) },   // '3'
+    { FONT_ROW(0b00010), FONT_ROW(0b00110), FONT_ROW(0b01010), FONT_ROW(0b10010), FONT_ROW(0b11111), FONT_ROW(0b00010), FONT_ROW(0b00010) },   // '4'
+    { FONT_ROW(0b11111), FONT_ROW(0b10000), FONT_ROW(0b11110), FONT_ROW(0b00001), FONT_ROW(0b00001), FONT_ROW(0b10001), FONT_ROW(0b01110) },   // '5'
+    { FONT_ROW(0b00110), FONT_ROW(0b01000), FONT_ROW(0b10000), FONT_ROW(0b11110), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01110) },   // '6'
+    { FONT_ROW(0b11111), FONT_ROW(0b00001), FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b01000), FONT_ROW(0b01000), FONT_ROW(0b01000) },   // '7'
+    { FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01110) },   // '8'
+    { FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01111), FONT_ROW(0b00001), FONT_ROW(0b00010), FONT_ROW(0b01100) },   // '9'
+    { FONT_ROW(0b00000), FONT_ROW(0b01100), FONT_ROW(0b01100), FONT_ROW(0b00000), FONT_ROW(0b01100), FONT_ROW(0b01100), FONT_ROW(0b00000) },   // ':'
+    { FONT_ROW(0b00000), FONT_ROW(0b01100), FONT_ROW(0b01100), FONT_ROW(0b00000), FONT_ROW(0b01100), FONT_ROW(0b00100), FONT_ROW(0b01000) },   // ';'
+    { FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b01000), FONT_ROW(0b10000), FONT_ROW(0b01000), FONT_ROW(0b00100), FONT_ROW(0b00010) },   // '<'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b11111), FONT_ROW(0b00000), FONT_ROW(0b11111), FONT_ROW(0b00000), FONT_ROW(0b00000) },   // '='
+    { FONT_ROW(0b01000), FONT_ROW(0b00100), FONT_ROW(0b00010), FONT_ROW(0b00001), FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b01000) },   // '>'
+    { FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b00001), FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b00000), FONT_ROW(0b00100) },   // '?'
+    { FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b00001), FONT_ROW(0b01101), FONT_ROW(0b10101), FONT_ROW(0b10101), FONT_ROW(0b01110) },   // '@'
+    { FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b11111), FONT_ROW(0b10001), FONT_ROW(0b10001) },   // 'A'
+    { FONT_ROW(0b11110), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b11110), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b11110) },   // 'B'
+    { FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10001), FONT_ROW(0b01110) },   // 'C'
+    { FONT_ROW(0b11100), FONT_ROW(0b10010), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10010), FONT_ROW(0b11100) },   // 'D'
+    { FONT_ROW(0b11111), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b11110), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b11111) },   // 'E'
+    { FONT_ROW(0b11111), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b11110), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10000) },   // 'F'
+    { FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b10000), FONT_ROW(0b10111), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01111) },   // 'G'
+    { FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b11111), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001) },   // 'H'
+    { FONT_ROW(0b01110), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b01110) },   // 'I'
+    { FONT_ROW(0b00111), FONT_ROW(0b00010), FONT_ROW(0b00010), FONT_ROW(0b00010), FONT_ROW(0b00010), FONT_ROW(0b10010), FONT_ROW(0b01100) },   // 'J'
+    { FONT_ROW(0b10001), FONT_ROW(0b10010), FONT_ROW(0b10100), FONT_ROW(0b11000), FONT_ROW(0b10100), FONT_ROW(0b10010), FONT_ROW(0b10001) },   // 'K'
+    { FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b11111) },   // 'L'
+    { FONT_ROW(0b10001), FONT_ROW(0b11011), FONT_ROW(0b10101), FONT_ROW(0b10101), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001) },   // 'M'
+    { FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b11001), FONT_ROW(0b10101), FONT_ROW(0b10011), FONT_ROW(0b10001), FONT_ROW(0b10001) },   // 'N'
+    { FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01110) },   // 'O'
+    { FONT_ROW(0b11110), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b11110), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10000) },   // 'P'
+    { FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10101), FONT_ROW(0b10010), FONT_ROW(0b01101) },   // 'Q'
+    { FONT_ROW(0b11110), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b11110), FONT_ROW(0b10100), FONT_ROW(0b10010), FONT_ROW(0b10001) },   // 'R'
+    { FONT_ROW(0b01111), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b01110), FONT_ROW(0b00001), FONT_ROW(0b00001), FONT_ROW(0b11110) },   // 'S'
+    { FONT_ROW(0b11111), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100) },   // 'T'
+    { FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01110) },   // 'U'
+    { FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01010), FONT_ROW(0b00100) },   // 'V'
+    { FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10101), FONT_ROW(0b10101), FONT_ROW(0b10101), FONT_ROW(0b01010) },   // 'W'
+    { FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01010), FONT_ROW(0b00100), FONT_ROW(0b01010), FONT_ROW(0b10001), FONT_ROW(0b10001) },   // 'X'
+    { FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01010), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100) },   // 'Y'
+    { FONT_ROW(0b11111), FONT_ROW(0b00001), FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b01000), FONT_ROW(0b10000), FONT_ROW(0b11111) },   // 'Z'
+    { FONT_ROW(0b01110), FONT_ROW(0b01000), FONT_ROW(0b01000), FONT_ROW(0b01000), FONT_ROW(0b01000), FONT_ROW(0b01000), FONT_ROW(0b01110) },   // '['
+    { FONT_ROW(0b00000), FONT_ROW(0b10000), FONT_ROW(0b01000), FONT_ROW(0b00100), FONT_ROW(0b00010), FONT_ROW(0b00001), FONT_ROW(0b00000) },   // '\\'
+    { FONT_ROW(0b01110), FONT_ROW(0b00010), FONT_ROW(0b00010), FONT_ROW(0b00010), FONT_ROW(0b00010), FONT_ROW(0b00010), FONT_ROW(0b01110) },   // ']'
+    { FONT_ROW(0b00100), FONT_ROW(0b01010), FONT_ROW(0b10001), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000) },   // '^'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b11111) },   // '_'
+    { FONT_ROW(0b01000), FONT_ROW(0b00100), FONT_ROW(0b00010), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b00000) },   // '`'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b01110), FONT_ROW(0b00001), FONT_ROW(0b01111), FONT_ROW(0b10001), FONT_ROW(0b01111) },   // 'a'
+    { FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10110), FONT_ROW(0b11001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b11110) },   // 'b'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b01110), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10001), FONT_ROW(0b01110) },   // 'c'
+    { FONT_ROW(0b00001), FONT_ROW(0b00001), FONT_ROW(0b01101), FONT_ROW(0b10011), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01111) },   // 'd'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b11111), FONT_ROW(0b10000), FONT_ROW(0b01110) },   // 'e'
+    { FONT_ROW(0b00110), FONT_ROW(0b01001), FONT_ROW(0b01000), FONT_ROW(0b11100), FONT_ROW(0b01000), FONT_ROW(0b01000), FONT_ROW(0b01000) },   // 'f'
+    { FONT_ROW(0b00000), FONT_ROW(0b01111), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01111), FONT_ROW(0b00001), FONT_ROW(0b01110) },   // 'g'
+    { FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10110), FONT_ROW(0b11001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001) },   // 'h'
+    { FONT_ROW(0b00100), FONT_ROW(0b00000), FONT_ROW(0b01100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b01110) },   // 'i'
+    { FONT_ROW(0b00010), FONT_ROW(0b00000), FONT_ROW(0b00110), FONT_ROW(0b00010), FONT_ROW(0b00010), FONT_ROW(0b10010), FONT_ROW(0b01100) },   // 'j'
+    { FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10010), FONT_ROW(0b10100), FONT_ROW(0b11000), FONT_ROW(0b10100), FONT_ROW(0b10010) },   // 'k'
+    { FONT_ROW(0b01100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b01110) },   // 'l'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b11010), FONT_ROW(0b10101), FONT_ROW(0b10101), FONT_ROW(0b10001), FONT_ROW(0b10001) },   // 'm'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b10110), FONT_ROW(0b11001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001) },   // 'n'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b01110), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01110) },   // 'o'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b11110), FONT_ROW(0b10001), FONT_ROW(0b11110), FONT_ROW(0b10000), FONT_ROW(0b10000) },   // 'p'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b01101), FONT_ROW(0b10011), FONT_ROW(0b01111), FONT_ROW(0b00001), FONT_ROW(0b00001) },   // 'q'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b10110), FONT_ROW(0b11001), FONT_ROW(0b10000), FONT_ROW(0b10000), FONT_ROW(0b10000) },   // 'r'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b01110), FONT_ROW(0b10000), FONT_ROW(0b01110), FONT_ROW(0b00001), FONT_ROW(0b11110) },   // 's'
+    { FONT_ROW(0b01000), FONT_ROW(0b01000), FONT_ROW(0b11100), FONT_ROW(0b01000), FONT_ROW(0b01000), FONT_ROW(0b01001), FONT_ROW(0b00110) },   // 't'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10011), FONT_ROW(0b01101) },   // 'u'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01010), FONT_ROW(0b00100) },   // 'v'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b10101), FONT_ROW(0b10101), FONT_ROW(0b01010) },   // 'w'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b10001), FONT_ROW(0b01010), FONT_ROW(0b00100), FONT_ROW(0b01010), FONT_ROW(0b10001) },   // 'x'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b10001), FONT_ROW(0b10001), FONT_ROW(0b01111), FONT_ROW(0b00001), FONT_ROW(0b01110) },   // 'y'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b11111), FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b01000), FONT_ROW(0b11111) },   // 'z'
+    { FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b01000), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00010) },   // '{'
+    { FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00100) },   // '|'
+    { FONT_ROW(0b01000), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b00010), FONT_ROW(0b00100), FONT_ROW(0b00100), FONT_ROW(0b01000) },   // '}'
+    { FONT_ROW(0b00000), FONT_ROW(0b00000), FONT_ROW(0b01000), FONT_ROW(0b10101), FONT_ROW(0b00010), FONT_ROW(0b00000), FONT_ROW(0b00000) },   // '~'
+};
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,313 @@
+#include <string.h>
+
+#include "esp_rom_crc.h"
+
+#include "frame_image.h"
+
+#define THUMB_LEVELS            16U
+
+// Palette indexes of full frame images
+#define INDEX_BLACK             0U
+#define INDEX_WHITE             1U
+#define INDEX_RED               2U
+#define FRAME_IMAGE_COLORS      3U
+
+// Adler-32 modulus, the largest prime below 65536
+#define ADLER_MOD               65521U
+
+static inline uint32_t frame_image_popcount_bytes(uint32_t x);
+static inline uint8_t frame_image_level(uint32_t count);
+static void frame_image_put16(uint8_t* dst, uint16_t value);
+static void frame_image_put32(uint8_t* dst, uint32_t value);
+static void frame_image_put32_be(uint8_t* dst, uint32_t value);
+static inline uint16_t frame_image_spread2(uint8_t x);
+static inline uint32_t frame_image_spread4(uint8_t x);
+static bool frame_image_png_chunk(frame_image_encoder_t* enc, const char* type, uint32_t len);
+static bool frame_image_png_row(frame_image_encoder_t* enc, const uint8_t* bw, const uint8_t* red);
+static bool frame_image_bmp_row(frame_image_encoder_t* enc, const uint8_t* bw, const uint8_t* red);
+
+// Count the set bits of each byte of a word, counts stay in their byte
+static inline uint32_t frame_image_popcount_bytes(uint32_t x)
+{
+    x = x - ((x >> 1) & 0x55555555U);
+    x = (x & 0x33333333U) + ((x >> 2) & 0x33333333U);
+    return (x + (x >> 4)) & 0x0F0F0F0FU;
+}
+
+// Pixel count of a block, 0..64, to a level, 0..15
+static inline uint8_t frame_image_level(uint32_t count)
+{
+    return (count * (THUMB_LEVELS - 1U) + 32U) >> 6;
+}
+
+static void frame_image_put16(uint8_t* dst, uint16_t value)
+{
+    dst[0] = value;
+    dst[1] = value >> 8;
+}
+
+static void frame_image_put32(uint8_t* dst, uint32_t value)
+{
+    frame_image_put16(dst, value);
+    frame_image_put16(dst + 2, value >> 16);
+}
+
+static void frame_image_put32_be(uint8_t* dst, uint32_t value)
+{
+    dst[0] = value >> 24;
+    dst[1] = value >> 16;
+    dst[2] = value >> 8;
+    dst[3] = value;
+}
+
+// Move bit i of x to bit 2i
+static inline uint16_t frame_image_spread2(uint8_t x)
+{
+    uint16_t v = x;
+    v = (v | (v << 4)) & 0x0F0FU;
+    v = (v | (v << 2)) & 0x3333U;
+    return (v | (v << 1)) & 0x5555U;
+}
+
+// Move bit i of x to bit 4i
+static inline uint32_t frame_image_spread4(uint8_t x)
+{
+    uint32_t v = x;
+    v = (v | (v << 12)) & 0x000F000FU;
+    v = (v | (v << 6)) & 0x03030303U;
+    return (v | (v << 3)) & 0x11111111U;
+}
+
+void frame_image_bmp_header(uint8_t* dst, uint16_t width, uint16_t height, uint8_t bpp, uint16_t colors)
+{
+    uint32_t offset = FRAME_IMAGE_BMP_SIZE(colors);
+    uint32_t size   = (uint32_t) width * bpp / 8U * height;
+
+    memset(dst, 0, FRAME_IMAGE_BMP_HEADER_SIZE);
+
+    // File header
+    dst[0] = 'B';
+    dst[1] = 'M';
+    frame_image_put32(dst + 2, offset + size);
+    frame_image_put32(dst + 10, offset);
+
+    // Info header, negative height for top-down rows
+    frame_image_put32(dst + 14, 40);
+    frame_image_put32(dst + 18, width);
+    frame_image_put32(dst + 22, -(int32_t) height);
+    frame_image_put16(dst + 26, 1);
+    frame_image_put16(dst + 28, bpp);
+    frame_image_put32(dst + 34, size);
+    frame_image_put32(dst + 46, colors);
+}
+
+void frame_image_thumb_palette(uint8_t* dst)
+{
+    for (uint16_t i = 0; i < FRAME_THUMB_COLORS; i++)
+    {
+        uint16_t white = i >> 4;
+        uint16_t red   = i & 0x0F;
+        uint16_t lit   = white + red;
+
+        // Both levels are rounded, keep their sum in range
+        if (lit > THUMB_LEVELS - 1U)
+        {
+            lit = THUMB_LEVELS - 1U;
+        }
+
+        // Blue, green, red, reserved
+        dst[4*i + 0] = white * 255U / (THUMB_LEVELS - 1U);
+        dst[4*i + 1] = white * 255U / (THUMB_LEVELS - 1U);
+        dst[4*i + 2] = lit * 255U / (THUMB_LEVELS - 1U);
+        dst[4*i + 3] = 0;
+    }
+}
+
+void frame_image_thumb_row(const uint8_t* bw, const uint8_t* red, uint16_t stride, uint8_t* dst)
+{
+    // Each byte of a word is a block column, 4 blocks are counted at once
+    // Sums are at most 64 so they never carry to the next byte
+    for (uint16_t col = 0; col < stride; col += 4)
+    {
+        uint32_t white_sum = 0;
+        uint32_t red_sum   = 0;
+
+        for (uint8_t row = 0; row < FRAME_THUMB_BLOCK; row++)
+        {
+            uint32_t w, r;
+            memcpy(&w, bw + row * stride + col, sizeof(w));
+            memcpy(&r, red + row * stride + col, sizeof(r));
+
+            // Red pixels are white in the B/W plane
+            white_sum += frame_image_popcount_bytes(w & ~r);
+            red_sum   += frame_image_popcount_bytes(r);
+        }
+
+        // Bytes are in memory order, the first block is the lowest byte
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            uint8_t shift = 8 * i;
+            dst[col + i] = (frame_image_level((white_sum >> shift) & 0xFF) << 4)
+                         | frame_image_level((red_sum >> shift) & 0xFF);
+        }
+    }
+}
+
+// Send a PNG chunk whose len bytes of data are in the line after room for the length and type
+static bool frame_image_png_chunk(frame_image_encoder_t* enc, const char* type, uint32_t len)
+{
+    frame_image_put32_be(enc->line, len);
+    memcpy(enc->line + 4, type, 4);
+    frame_image_put32_be(enc->line + 8 + len, esp_rom_crc32_le(0, enc->line + 4, len + 4));
+
+    return enc->write(enc->ctx, enc->line, len + 12);
+}
+
+// One IDAT chunk per row, holding one stored deflate block
+// The zlib header goes with the first row, the Adler-32 with the last one
+static bool frame_image_png_row(frame_image_encoder_t* enc, const uint8_t* bw, const uint8_t* red)
+{
+    uint16_t stride = enc->width / 8U;
+    uint16_t len    = 1U + enc->width / 4U;
+    bool     last   = (enc->row == enc->height - 1U);
+    uint8_t* p      = enc->line + 8;
+
+    if (enc->row == 0)
+    {
+        *p++ = 0x78;
+        *p++ = 0x01;
+    }
+
+    *p++ = last;
+    frame_image_put16(p, len);
+    frame_image_put16(p + 2, ~len);
+    p += 4;
+
+    // No filter, then 4 pixels per byte: red is index 2 whatever the B/W plane says
+    uint8_t* data = p;
+    *p++ = 0;
+    for (uint16_t i = 0; i < stride; i++)
+    {
+        uint16_t v = (frame_image_spread2(red[i]) << 1) | frame_image_spread2(bw[i] & ~red[i]);
+        *p++ = v >> 8;
+        *p++ = v;
+    }
+
+    // A row is far shorter than the longest run without modulo
+    for (uint16_t i = 0; i < len; i++)
+    {
+        enc->adler_a += data[i];
+        enc->adler_b += enc->adler_a;
+    }
+    enc->adler_a %= ADLER_MOD;
+    enc->adler_b %= ADLER_MOD;
+
+    if (last)
+    {
+        frame_image_put32_be(p, (enc->adler_b << 16) | enc->adler_a);
+        p += 4;
+    }
+
+    return frame_image_png_chunk(enc, "IDAT", p - (enc->line + 8));
+}
+
+// 2 pixels per byte
+static bool frame_image_bmp_row(frame_image_encoder_t* enc, const uint8_t* bw, const uint8_t* red)
+{
+    uint16_t stride = enc->width / 8U;
+    uint8_t* p      = enc->line;
+
+    for (uint16_t i = 0; i < stride; i++)
+    {
+        frame_image_put32_be(p, (frame_image_spread4(red[i]) << 1) | frame_image_spread4(bw[i] & ~red[i]));
+        p += 4;
+    }
+
+    return enc->write(enc->ctx, enc->line, p - enc->line);
+}
+
+bool frame_image_begin(frame_image_encoder_t* enc, frame_image_format_t format, uint16_t width, uint16_t height,
+                       frame_image_write_t write, void* ctx)
+{
+    static const uint8_t palette[FRAME_IMAGE_COLORS][3] = {
+        [INDEX_BLACK]   = {0x00, 0x00, 0x00},
+        [INDEX_WHITE]   = {0xFF, 0xFF, 0xFF},
+        [INDEX_RED]     = {0xFF, 0x00, 0x00},
+    };
+
+    if ((width % 8U) || (width > DISPLAY_WIDTH) || (height == 0))
+    {
+        return false;
+    }
+
+    enc->format  = format;
+    enc->width   = width;
+    enc->height  = height;
+    enc->row     = 0;
+    enc->adler_a = 1;
+    enc->adler_b = 0;
+    enc->write   = write;
+    enc->ctx     = ctx;
+
+    if (format == FRAME_IMAGE_BMP)
+    {
+        uint8_t* p = enc->line + FRAME_IMAGE_BMP_HEADER_SIZE;
+
+        frame_image_bmp_header(enc->line, width, height, 4, FRAME_IMAGE_COLORS);
+        for (uint8_t i = 0; i < FRAME_IMAGE_COLORS; i++)
+        {
+            *p++ = palette[i][2];
+            *p++ = palette[i][1];
+            *p++ = palette[i][0];
+            *p++ = 0;
+        }
+
+        return write(ctx, enc->line, FRAME_IMAGE_BMP_SIZE(FRAME_IMAGE_COLORS));
+    }
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (!write(ctx, signature, sizeof(signature)))
+    {
+        return false;
+    }
+
+    // 2 bits indexed color, default compression, filtering and no interlace
+    uint8_t* ihdr = enc->line + 8;
+    frame_image_put32_be(ihdr, width);
+    frame_image_put32_be(ihdr + 4, height);
+    ihdr[8]  = 2;
+    ihdr[9]  = 3;
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+    if (!frame_image_png_chunk(enc, "IHDR", 13))
+    {
+        return false;
+    }
+
+    memcpy(enc->line + 8, palette, sizeof(palette));
+    return frame_image_png_chunk(enc, "PLTE", sizeof(palette));
+}
+
+bool frame_image_row(frame_image_encoder_t* enc, const uint8_t* bw, const uint8_t* red)
+{
+    if (enc->row >= enc->height)
+    {
+        return false;
+    }
+
+    bool ret = (enc->format == FRAME_IMAGE_BMP) ? frame_image_bmp_row(enc, bw, red) : frame_image_png_row(enc, bw, red);
+    enc->row++;
+
+    return ret;
+}
+
+bool frame_image_end(frame_image_encoder_t* enc)
+{
+    if (enc->row != enc->height)
+    {
+        return false;
+    }
+
+    return (enc->format == FRAME_IMAGE_BMP) || frame_image_png_chunk(enc, "IEND", 0);
+}
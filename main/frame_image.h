@@ -0,0 +1,72 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "display_config.h"
+
+// Thumbnails have one pixel per 8x8 block of the frame
+#define FRAME_THUMB_BLOCK           8U
+
+// Thumbnail pixels index a 256 colors palette: white level << 4 | red level, levels 0..15
+#define FRAME_THUMB_COLORS          256U
+
+// BMP header with a palette of colors entries
+#define FRAME_IMAGE_BMP_HEADER_SIZE 54U
+#define FRAME_IMAGE_BMP_SIZE(colors) (FRAME_IMAGE_BMP_HEADER_SIZE + 4U * (colors))
+
+// Encoded output of one row, a 4-bpp BMP row or a PNG chunk of a 2-bpp row
+#define FRAME_IMAGE_LINE_SIZE       (DISPLAY_WIDTH / 2U + 32U)
+
+// Full frame image formats, indexed black, white, red
+typedef enum
+{
+    FRAME_IMAGE_BMP = 0,            // 4 bpp, uncompressed
+    FRAME_IMAGE_PNG,                // 2 bpp, stored deflate blocks
+} frame_image_format_t;
+
+// Output of the encoder, return false to abort
+typedef bool (*frame_image_write_t)(void* ctx, const uint8_t* data, uint32_t len);
+
+// Streaming encoder state, fed one row at a time
+typedef struct
+{
+    frame_image_format_t    format;
+    uint16_t                width;
+    uint16_t                height;
+    uint16_t                row;
+    uint32_t                adler_a;
+    uint32_t                adler_b;
+    frame_image_write_t     write;
+    void*                   ctx;
+    uint8_t                 line[FRAME_IMAGE_LINE_SIZE];
+} frame_image_encoder_t;
+
+// Write the header of a top-down BMP of width x height at bpp bits per pixel
+// Rows must be a multiple of 4 bytes. Its palette of colors entries is to be written right after
+void    frame_image_bmp_header(uint8_t* dst, uint16_t width, uint16_t height, uint8_t bpp, uint16_t colors);
+
+// Write the FRAME_THUMB_COLORS palette of thumbnails in BMP order, 4 bytes per entry
+void    frame_image_thumb_palette(uint8_t* dst);
+
+// Make a thumbnail row from FRAME_THUMB_BLOCK rows of both planes
+// stride is the bytes per plane row, a multiple of 4, dst receives stride pixels
+void    frame_image_thumb_row(const uint8_t* bw, const uint8_t* red, uint16_t stride, uint8_t* dst);
+
+// Start encoding a width x height frame, width multiple of 8 up to DISPLAY_WIDTH
+bool    frame_image_begin(frame_image_encoder_t* enc, frame_image_format_t format, uint16_t width, uint16_t height,
+                          frame_image_write_t write, void* ctx);
+
+// Encode the next row from its width / 8 bytes of both planes
+bool    frame_image_row(frame_image_encoder_t* enc, const uint8_t* bw, const uint8_t* red);
+
+// Finish the image once all rows are encoded
+bool    frame_image_end(frame_image_encoder_t* enc);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,112 @@
+#include <string.h>
+
+#include "display_config.h"
+#include "frame_rotate.h"
+
+// Bytes of a row in display layout and in portrait layout
+#define ROW_BYTES               (DISPLAY_WIDTH / 8U)
+#define PORTRAIT_ROW_BYTES      (DISPLAY_HEIGHT / 8U)
+
+static inline void frame_rotate_transpose8(const uint8_t in[8], uint8_t out[8]);
+static inline uint32_t frame_rotate_reverse32(uint32_t x);
+static void frame_rotate_band_quarter(const uint8_t* plane, uint8_t* dst, uint16_t band, bool ccw);
+static void frame_rotate_band_half(const uint8_t* plane, uint8_t* dst, uint16_t band);
+
+// Transpose an 8x8 bit matrix, one byte per row, MSB first: out[j] bit 7-k = in[k] bit 7-j
+// Works on two 32-bit words, see Hacker's Delight 7-3
+static inline void frame_rotate_transpose8(const uint8_t in[8], uint8_t out[8])
+{
+    uint32_t x = ((uint32_t) in[0] << 24) | ((uint32_t) in[1] << 16) | ((uint32_t) in[2] << 8) | in[3];
+    uint32_t y = ((uint32_t) in[4] << 24) | ((uint32_t) in[5] << 16) | ((uint32_t) in[6] << 8) | in[7];
+    uint32_t t;
+
+    // Transpose 2x2 blocks, then 4x4 blocks of each half
+    t = (x ^ (x >> 7)) & 0x00AA00AAU;   x ^= t ^ (t << 7);
+    t = (y ^ (y >> 7)) & 0x00AA00AAU;   y ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCCU;  x ^= t ^ (t << 14);
+    t = (y ^ (y >> 14)) & 0x0000CCCCU;  y ^= t ^ (t << 14);
+
+    // Swap the off-diagonal 4x4 blocks between halves
+    t = (x & 0xF0F0F0F0U) | ((y >> 4) & 0x0F0F0F0FU);
+    y = ((x << 4) & 0xF0F0F0F0U) | (y & 0x0F0F0F0FU);
+    x = t;
+
+    out[0] = x >> 24;   out[1] = x >> 16;   out[2] = x >> 8;    out[3] = x;
+    out[4] = y >> 24;   out[5] = y >> 16;   out[6] = y >> 8;    out[7] = y;
+}
+
+// Reverse the bits of a word
+static inline uint32_t frame_rotate_reverse32(uint32_t x)
+{
+    x = ((x >> 1) & 0x55555555U) | ((x & 0x55555555U) << 1);
+    x = ((x >> 2) & 0x33333333U) | ((x & 0x33333333U) << 2);
+    x = ((x >> 4) & 0x0F0F0F0FU) | ((x & 0x0F0F0F0FU) << 4);
+
+    return __builtin_bswap32(x);
+}
+
+// Quarter turns of a portrait plane, one 8x8 block per display byte column
+static void frame_rotate_band_quarter(const uint8_t* plane, uint8_t* dst, uint16_t band, bool ccw)
+{
+    uint8_t in[8];
+    uint8_t out[8];
+
+    for (uint16_t col = 0; col < ROW_BYTES; col++)
+    {
+        // Display column x = 8*col + k shows portrait row DISPLAY_WIDTH-1-x clockwise, x counter-clockwise
+        for (uint8_t k = 0; k < 8; k++)
+        {
+            in[k] = ccw ? plane[(8U * col + k) * PORTRAIT_ROW_BYTES + (PORTRAIT_ROW_BYTES - 1U - band)]
+                        : plane[(DISPLAY_WIDTH - 1U - 8U * col - k) * PORTRAIT_ROW_BYTES + band];
+        }
+
+        frame_rotate_transpose8(in, out);
+
+        // Counter-clockwise, portrait columns come right to left
+        for (uint8_t j = 0; j < 8; j++)
+        {
+            dst[j * ROW_BYTES + col] = out[ccw ? (7U - j) : j];
+        }
+    }
+}
+
+// Half turn, each display row is a source row read backwards
+static void frame_rotate_band_half(const uint8_t* plane, uint8_t* dst, uint16_t band)
+{
+    for (uint16_t j = 0; j < FRAME_ROTATE_BAND_ROWS; j++)
+    {
+        const uint8_t* src = plane + (DISPLAY_HEIGHT - 1U - (band * FRAME_ROTATE_BAND_ROWS + j)) * ROW_BYTES;
+        uint8_t* row = dst + j * ROW_BYTES;
+
+        // Rows are a whole number of words, pixels in big endian order
+        for (uint16_t i = 0; i < ROW_BYTES; i += 4)
+        {
+            uint32_t w;
+            memcpy(&w, src + ROW_BYTES - 4U - i, sizeof(w));
+            w = __builtin_bswap32(frame_rotate_reverse32(__builtin_bswap32(w)));
+            memcpy(row + i, &w, sizeof(w));
+        }
+    }
+}
+
+void frame_rotate_band(const uint8_t* plane, uint8_t* dst, uint16_t band, frame_rotation_t rotation)
+{
+    switch (rotation)
+    {
+        case FRAME_ROTATION_90:
+            frame_rotate_band_quarter(plane, dst, band, false);
+            break;
+
+        case FRAME_ROTATION_180:
+            frame_rotate_band_half(plane, dst, band);
+            break;
+
+        case FRAME_ROTATION_270:
+            frame_rotate_band_quarter(plane, dst, band, true);
+            break;
+
+        default:
+            memcpy(dst, plane + band * FRAME_ROTATE_BAND_SIZE, FRAME_ROTATE_BAND_SIZE);
+            break;
+    }
+}
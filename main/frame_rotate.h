@@ -0,0 +1,32 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "display_config.h"
+
+// Clockwise rotation applied to a plane to show it on the display
+// With 90 and 270, the plane holds a DISPLAY_HEIGHT x DISPLAY_WIDTH portrait frame
+typedef enum
+{
+    FRAME_ROTATION_0 = 0,
+    FRAME_ROTATION_90,
+    FRAME_ROTATION_180,
+    FRAME_ROTATION_270,
+} frame_rotation_t;
+
+// Display rows produced at once by frame_rotate_band
+#define FRAME_ROTATE_BAND_ROWS      8U
+#define FRAME_ROTATE_BAND_SIZE      (FRAME_ROTATE_BAND_ROWS * DISPLAY_WIDTH / 8U)
+
+// Produce display rows [8*band, 8*band+8) of a 1-bpp plane shown with the given rotation
+// dst receives FRAME_ROTATE_BAND_SIZE bytes, in display layout
+void    frame_rotate_band(const uint8_t* plane, uint8_t* dst, uint16_t band, frame_rotation_t rotation);
+
+#ifdef __cplusplus
+}
+#endif
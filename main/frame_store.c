@@ -0,0 +1,273 @@
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "display_config.h"
+#include "frame_store.h"
+
+#define FRAME_SLOT_MAGIC        0x53465050U     // "PPFS"
+#define FRAME_SLOT_SECTOR_SIZE  4096U
+
+// Slot header, written after the frame so an interrupted save leaves the slot empty
+typedef struct __attribute__((__packed__))
+{
+    uint32_t    magic;          // FRAME_SLOT_MAGIC
+    uint32_t    seq;            // Save order
+    uint32_t    crc32;          // CRC32 of the frame
+    uint8_t     rotation;       // frame_rotation_t
+    uint8_t     reserved[3];
+} frame_slot_header_t;
+
+// Slot = header + framebuffer, rounded to erasable sectors
+#define FRAME_SLOT_DATA_OFFSET  sizeof(frame_slot_header_t)
+#define FRAME_SLOT_SIZE         ((FRAME_SLOT_DATA_OFFSET + FRAMEBUFFER_SIZE + FRAME_SLOT_SECTOR_SIZE - 1U) & ~(FRAME_SLOT_SECTOR_SIZE - 1U))
+
+static const char *TAG                          = "frame_store";
+static const esp_partition_t* partition         = NULL;
+static uint8_t slot_count                       = 0;
+
+// Headers of all slots, kept in RAM to answer listings without flash reads
+// Saved by the main loop while the HTTP server lists and reads them, only touched under slots_lock
+static frame_slot_header_t slots[FRAME_STORE_MAX_SLOTS];
+static portMUX_TYPE slots_lock                  = portMUX_INITIALIZER_UNLOCKED;
+
+static bool frame_store_slot_used(uint8_t id);
+static void frame_store_fill_entry(uint8_t id, frame_store_entry_t* entry);
+static bool frame_store_holds(const frame_store_entry_t* entry);
+
+static bool frame_store_slot_used(uint8_t id)
+{
+    return (id < slot_count) && (slots[id].magic == FRAME_SLOT_MAGIC);
+}
+
+static void frame_store_fill_entry(uint8_t id, frame_store_entry_t* entry)
+{
+    entry->id       = id;
+    entry->seq      = slots[id].seq;
+    entry->rotation = (frame_rotation_t) slots[id].rotation;
+    entry->crc32    = slots[id].crc32;
+}
+
+// Whether the slot of entry still holds that frame, a save gives the reused slot a higher seq
+static bool frame_store_holds(const frame_store_entry_t* entry)
+{
+    taskENTER_CRITICAL(&slots_lock);
+    bool ret = frame_store_slot_used(entry->id) && (slots[entry->id].seq == entry->seq);
+    taskEXIT_CRITICAL(&slots_lock);
+
+    return ret;
+}
+
+bool frame_store_init(void)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, FRAME_STORE_SUBTYPE, FRAME_STORE_PARTITION);
+    if (partition == NULL)
+    {
+        ESP_LOGE(TAG, "No %s partition", FRAME_STORE_PARTITION);
+        return false;
+    }
+
+    slot_count = partition->size / FRAME_SLOT_SIZE;
+    if (slot_count > FRAME_STORE_MAX_SLOTS)
+    {
+        slot_count = FRAME_STORE_MAX_SLOTS;
+    }
+
+    uint8_t used = 0;
+    for (uint8_t i = 0; i < slot_count; i++)
+    {
+        if (esp_partition_read(partition, i * FRAME_SLOT_SIZE, &slots[i], sizeof(slots[i])) != ESP_OK)
+        {
+            slots[i].magic = 0;
+        }
+        used += frame_store_slot_used(i);
+    }
+
+    ESP_LOGI(TAG, "%u of %u slots used", used, slot_count);
+
+    return true;
+}
+
+uint8_t frame_store_list(frame_store_entry_t* entries, uint8_t max)
+{
+    uint8_t count = 0;
+
+    taskENTER_CRITICAL(&slots_lock);
+    for (uint8_t i = 0; i < slot_count; i++)
+    {
+        if (!frame_store_slot_used(i))
+        {
+            continue;
+        }
+
+        // Insertion by decreasing seq, the list is short
+        uint8_t pos = count;
+        while ((pos > 0) && (entries[pos - 1].seq < slots[i].seq))
+        {
+            if (pos < max)
+            {
+                entries[pos] = entries[pos - 1];
+            }
+            pos--;
+        }
+
+        if (pos < max)
+        {
+            frame_store_fill_entry(i, &entries[pos]);
+        }
+
+        if (count < max)
+        {
+            count++;
+        }
+    }
+    taskEXIT_CRITICAL(&slots_lock);
+
+    return count;
+}
+
+bool frame_store_get(uint8_t id, frame_store_entry_t* entry)
+{
+    taskENTER_CRITICAL(&slots_lock);
+    bool ret = frame_store_slot_used(id);
+    if (ret)
+    {
+        frame_store_fill_entry(id, entry);
+    }
+    taskEXIT_CRITICAL(&slots_lock);
+
+    return ret;
+}
+
+bool frame_store_latest(frame_store_entry_t* entry)
+{
+    return frame_store_list(entry, 1) == 1;
+}
+
+bool frame_store_save(const uint8_t* framebuffer, frame_rotation_t rotation, uint8_t* id)
+{
+    if (partition == NULL)
+    {
+        return false;
+    }
+
+    // Take a free slot, or the oldest one
+    uint8_t  slot     = 0;
+    uint32_t next_seq = 0;
+    taskENTER_CRITICAL(&slots_lock);
+    for (uint8_t i = 0; i < slot_count; i++)
+    {
+        if (!frame_store_slot_used(i))
+        {
+            if (frame_store_slot_used(slot))
+            {
+                slot = i;
+            }
+            continue;
+        }
+
+        if (slots[i].seq >= next_seq)
+        {
+            next_seq = slots[i].seq + 1;
+        }
+
+        if (frame_store_slot_used(slot) && (slots[i].seq < slots[slot].seq))
+        {
+            slot = i;
+        }
+    }
+
+    // Readers of the slot see it empty, or with the new seq once written
+    slots[slot].magic = 0;
+    taskEXIT_CRITICAL(&slots_lock);
+
+    uint32_t base = slot * FRAME_SLOT_SIZE;
+    frame_slot_header_t header = {
+        .magic      = FRAME_SLOT_MAGIC,
+        .seq        = next_seq,
+        .crc32      = esp_rom_crc32_le(0, framebuffer, FRAMEBUFFER_SIZE),
+        .rotation   = rotation,
+    };
+
+    if ((esp_partition_erase_range(partition, base, FRAME_SLOT_SIZE) != ESP_OK)
+        || (esp_partition_write(partition, base + FRAME_SLOT_DATA_OFFSET, framebuffer, FRAMEBUFFER_SIZE) != ESP_OK)
+        || (esp_partition_write(partition, base, &header, sizeof(header)) != ESP_OK))
+    {
+        ESP_LOGE(TAG, "Failed to write slot %u", slot);
+        return false;
+    }
+
+    taskENTER_CRITICAL(&slots_lock);
+    slots[slot] = header;
+    taskEXIT_CRITICAL(&slots_lock);
+
+    if (id != NULL)
+    {
+        *id = slot;
+    }
+
+    return true;
+}
+
+bool frame_store_load(uint8_t id, uint8_t* framebuffer)
+{
+    frame_store_entry_t entry;
+
+    if (!frame_store_get(id, &entry) || !frame_store_read(&entry, 0, framebuffer, FRAMEBUFFER_SIZE))
+    {
+        return false;
+    }
+
+    if (esp_rom_crc32_le(0, framebuffer, FRAMEBUFFER_SIZE) != entry.crc32)
+    {
+        ESP_LOGE(TAG, "Slot %u is corrupted", id);
+        return false;
+    }
+
+    return true;
+}
+
+bool frame_store_read(const frame_store_entry_t* entry, uint32_t offset, uint8_t* buff, uint32_t len)
+{
+    if (!frame_store_holds(entry) || (offset + len > FRAMEBUFFER_SIZE)
+        || (esp_partition_read(partition, entry->id * FRAME_SLOT_SIZE + FRAME_SLOT_DATA_OFFSET + offset, buff, len) != ESP_OK))
+    {
+        return false;
+    }
+
+    // A save may have erased the slot while it was read
+    return frame_store_holds(entry);
+}
+
+const uint8_t* frame_store_map(uint8_t id, uint32_t* handle)
+{
+    const void* data = NULL;
+    esp_partition_mmap_handle_t map;
+    frame_store_entry_t entry;
+
+    if (!frame_store_get(id, &entry)
+        || (esp_partition_mmap(partition, id * FRAME_SLOT_SIZE + FRAME_SLOT_DATA_OFFSET, FRAMEBUFFER_SIZE,
+                               ESP_PARTITION_MMAP_DATA, &data, &map) != ESP_OK))
+    {
+        return NULL;
+    }
+
+    if (esp_rom_crc32_le(0, data, FRAMEBUFFER_SIZE) != entry.crc32)
+    {
+        ESP_LOGE(TAG, "Slot %u is corrupted", id);
+        esp_partition_munmap(map);
+        return NULL;
+    }
+
+    *handle = map;
+    return data;
+}
+
+void frame_store_unmap(uint32_t handle)
+{
+    esp_partition_munmap(handle);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "frame_rotate.h"
+
+// Frames are kept in slots of the "frames" data partition, see partitions.csv
+#define FRAME_STORE_PARTITION       "frames"
+#define FRAME_STORE_SUBTYPE         0x40
+#define FRAME_STORE_MAX_SLOTS       32U
+
+// A stored frame
+typedef struct
+{
+    uint8_t             id;         // Slot number
+    uint32_t            seq;        // Save order, the newest frame has the highest
+    frame_rotation_t    rotation;   // Rotation it is shown with
+    uint32_t            crc32;      // CRC32 of its planes, in framebuffer layout
+} frame_store_entry_t;
+
+// Find the partition and index the stored frames
+bool    frame_store_init(void);
+
+// Fill entries with at most max stored frames, newest first
+// Return the number of entries
+uint8_t frame_store_list(frame_store_entry_t* entries, uint8_t max);
+
+// Get a stored frame
+bool    frame_store_get(uint8_t id, frame_store_entry_t* entry);
+
+// Get the newest stored frame
+bool    frame_store_latest(frame_store_entry_t* entry);
+
+// Save a framebuffer in a new slot, overwriting the oldest frame when full
+bool    frame_store_save(const uint8_t* framebuffer, frame_rotation_t rotation, uint8_t* id);
+
+// Load a whole stored frame, checking its CRC
+bool    frame_store_load(uint8_t id, uint8_t* framebuffer);
+
+// Read len bytes of a stored frame at offset, in framebuffer layout
+// Fail when its slot no longer holds the frame of entry, saved over since frame_store_get or frame_store_list
+bool    frame_store_read(const frame_store_entry_t* entry, uint32_t offset, uint8_t* buff, uint32_t len);
+
+// Map a stored frame in the data address space, checking its CRC
+// Return its planes in framebuffer layout, read through the flash cache, NULL on failure
+const uint8_t* frame_store_map(uint8_t id, uint32_t* handle);
+
+// Release a mapping of frame_store_map
+void    frame_store_unmap(uint32_t handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,561 @@
+#include <string.h>
+#include <sys/param.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+
+#include "display_config.h"
+#include "display_manager.h"
+#include "frame_store.h"
+#include "frame_upload.h"
+
+// Decoding steps of a delta payload
+typedef enum
+{
+    DELTA_BASE = 0,                 // CRC32 of the base frame
+    DELTA_SKIP,                     // Bytes left as they are
+    DELTA_COUNT,                    // Bytes XORed, that follow
+    DELTA_XOR,
+} frame_delta_step_t;
+
+// Decoding state of the current upload
+typedef struct
+{
+    bool        active;
+    uint8_t     encoding;
+    bool        check_crc;
+    uint8_t     plane_count;
+    uint8_t*    planes[2];          // Destination of each plane present in the payload
+    uint32_t    received;           // Payload bytes decoded so far
+    uint32_t    expected;           // Payload size
+    uint32_t    crc;                // Running CRC32 of the payload
+    uint32_t    expected_crc;
+    uint8_t     carry[4];           // Packed pixels of an incomplete word
+    uint8_t     carry_len;
+    uint8_t     delta_step;         // frame_delta_step_t
+    uint8_t     shift;              // Bits of value received
+    uint32_t    value;              // Field being received, then bytes left to XOR
+    uint32_t    position;           // Offset in the framebuffer
+    bool        base_missing;
+    bool        base_changed;       // The framebuffer is not the frame it held before the delta anymore
+    uint32_t    base_crc;
+    uint8_t     base_rotation;      // frame_rotation_t of the framebuffer before the upload
+    uint16_t    stride;             // Bytes of a row
+    uint32_t    changed_first;      // Plane offsets of the first and last bytes changed
+    uint32_t    changed_last;
+} frame_upload_t;
+
+static const char*      TAG     = "frame_upload";
+static frame_upload_t   upload  = {0};
+
+static bool frame_upload_check_header(const frame_upload_header_t* header, uint32_t payload_len);
+static inline uint32_t frame_upload_unshuffle(uint32_t x);
+static void frame_upload_split_2bpp(const uint8_t* src, uint32_t words, uint8_t* bw, uint8_t* red);
+static void frame_upload_write_planar(const uint8_t* data, uint32_t len);
+static void frame_upload_write_packed(const uint8_t* data, uint32_t len);
+static bool frame_upload_find_stored(uint32_t crc, frame_store_entry_t* entry);
+static bool frame_upload_load_base(uint32_t crc);
+static void frame_upload_restore_base(void);
+static bool frame_upload_delta_field(uint8_t byte);
+static bool frame_upload_write_delta(const uint8_t* data, uint32_t len);
+
+// Move the even bits of a word to its lower half and the odd bits to its upper half, keeping their order
+// Delta-swap ladder, see Hacker's Delight 7-2
+static inline uint32_t frame_upload_unshuffle(uint32_t x)
+{
+    uint32_t t;
+
+    t = (x ^ (x >> 1)) & 0x22222222U;  x ^= t ^ (t << 1);
+    t = (x ^ (x >> 2)) & 0x0C0C0C0CU;  x ^= t ^ (t << 2);
+    t = (x ^ (x >> 4)) & 0x00F000F0U;  x ^= t ^ (t << 4);
+    t = (x ^ (x >> 8)) & 0x0000FF00U;  x ^= t ^ (t << 8);
+
+    return x;
+}
+
+// Split packed 2-bpp pixels into the two planes, 16 pixels per word
+static void frame_upload_split_2bpp(const uint8_t* src, uint32_t words, uint8_t* bw, uint8_t* red)
+{
+    for (uint32_t i = 0; i < words; i++)
+    {
+        uint32_t w;
+        memcpy(&w, src, sizeof(w));
+
+        // Pixel 0 in the MSBs, then white bits in the lower half and red bits in the upper half
+        w = frame_upload_unshuffle(__builtin_bswap32(w));
+
+        bw[0]  = w >> 8;
+        bw[1]  = w;
+        red[0] = w >> 24;
+        red[1] = w >> 16;
+
+        src += 4;
+        bw  += 2;
+        red += 2;
+    }
+}
+
+// Copy raw planes, a chunk may span two planes
+static void frame_upload_write_planar(const uint8_t* data, uint32_t len)
+{
+    while (len > 0)
+    {
+        uint32_t plane  = upload.received / FRAMEBUFFER_PLANE_SIZE;
+        uint32_t offset = upload.received % FRAMEBUFFER_PLANE_SIZE;
+        uint32_t count  = FRAMEBUFFER_PLANE_SIZE - offset;
+
+        if (count > len)
+        {
+            count = len;
+        }
+
+        memcpy(upload.planes[plane] + offset, data, count);
+
+        upload.received += count;
+        data            += count;
+        len             -= count;
+    }
+}
+
+// Split packed pixels by whole words, keeping the tail of the chunk for the next one
+static void frame_upload_write_packed(const uint8_t* data, uint32_t len)
+{
+    // Complete the word left by the previous chunk
+    if (upload.carry_len > 0)
+    {
+        uint32_t count = MIN(len, sizeof(upload.carry) - upload.carry_len);
+
+        memcpy(upload.carry + upload.carry_len, data, count);
+        upload.carry_len += count;
+        data             += count;
+        len              -= count;
+
+        if (upload.carry_len < sizeof(upload.carry))
+        {
+            return;
+        }
+
+        frame_upload_split_2bpp(upload.carry, 1, upload.planes[0] + upload.received / 2U,
+                                upload.planes[1] + upload.received / 2U);
+        upload.received += sizeof(upload.carry);
+        upload.carry_len = 0;
+    }
+
+    uint32_t words = len / 4U;
+    frame_upload_split_2bpp(data, words, upload.planes[0] + upload.received / 2U,
+                            upload.planes[1] + upload.received / 2U);
+    upload.received += words * 4U;
+
+    upload.carry_len = len - words * 4U;
+    memcpy(upload.carry, data + words * 4U, upload.carry_len);
+}
+
+// Find a stored frame by the CRC of its planes
+static bool frame_upload_find_stored(uint32_t crc, frame_store_entry_t* entry)
+{
+    for (uint8_t id = 0; id < FRAME_STORE_MAX_SLOTS; id++)
+    {
+        if (frame_store_get(id, entry) && (entry->crc32 == crc))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Make the framebuffer hold the stored frame with this CRC, it may hold it already
+// The delta is applied in place, a base only in the framebuffer could not be given back if it failed
+// Every row changes when the panel may show another frame, or the same one turned otherwise
+static bool frame_upload_load_base(uint32_t crc)
+{
+    uint8_t* framebuffer = upload.planes[0];
+    frame_store_entry_t entry;
+    bool stored = false;
+
+    upload.base_crc = crc;
+
+    if (!frame_upload_find_stored(crc, &entry))
+    {
+        ESP_LOGE(TAG, "Unknown base frame %08lx", (unsigned long) crc);
+        upload.base_missing = true;
+        return false;
+    }
+
+    if (esp_rom_crc32_le(0, framebuffer, FRAMEBUFFER_SIZE) != crc)
+    {
+        upload.base_changed = true;
+        if (!frame_store_load(entry.id, framebuffer))
+        {
+            return false;
+        }
+        stored = true;
+    }
+
+    if (stored || (upload.base_rotation != display_manager_get_rotation()))
+    {
+        upload.changed_first = 0;
+        upload.changed_last  = FRAMEBUFFER_PLANE_SIZE - 1U;
+    }
+
+    return true;
+}
+
+// Give the framebuffer back the base of a delta that failed, and its rotation
+// Records are applied in place, the base is read again from the store. When it cannot be,
+// the framebuffer holds no known frame and the base is reported missing
+static void frame_upload_restore_base(void)
+{
+    frame_store_entry_t entry;
+
+    if (!upload.base_changed)
+    {
+        display_manager_set_rotation((frame_rotation_t) upload.base_rotation);
+        return;
+    }
+
+    if (frame_upload_find_stored(upload.base_crc, &entry) && frame_store_load(entry.id, upload.planes[0]))
+    {
+        display_manager_set_rotation(entry.rotation);
+        return;
+    }
+
+    ESP_LOGE(TAG, "Base frame %08lx lost", (unsigned long) upload.base_crc);
+    upload.base_missing = true;
+}
+
+// Take a byte of a skip or count field, and the record step it completes
+static bool frame_upload_delta_field(uint8_t byte)
+{
+    if (upload.shift > 28)
+    {
+        ESP_LOGE(TAG, "Invalid delta field");
+        return false;
+    }
+
+    upload.value |= (uint32_t) (byte & 0x7FU) << upload.shift;
+    upload.shift += 7;
+    if (byte & 0x80U)
+    {
+        return true;
+    }
+
+    if (upload.value > (FRAMEBUFFER_SIZE - upload.position))
+    {
+        ESP_LOGE(TAG, "Delta out of the frame");
+        return false;
+    }
+
+    upload.shift = 0;
+    if (upload.delta_step == DELTA_SKIP)
+    {
+        upload.position  += upload.value;
+        upload.value      = 0;
+        upload.delta_step = DELTA_COUNT;
+    }
+    else if (upload.value > 0)
+    {
+        // Bounds of the bytes changed, a record across both planes may change any row
+        uint32_t first = upload.position;
+        uint32_t last  = upload.position + upload.value - 1U;
+
+        if ((first / FRAMEBUFFER_PLANE_SIZE) != (last / FRAMEBUFFER_PLANE_SIZE))
+        {
+            first = 0;
+            last  = FRAMEBUFFER_PLANE_SIZE - 1U;
+        }
+        upload.changed_first = MIN(upload.changed_first, first % FRAMEBUFFER_PLANE_SIZE);
+        upload.changed_last  = MAX(upload.changed_last, last % FRAMEBUFFER_PLANE_SIZE);
+
+        upload.delta_step = DELTA_XOR;
+    }
+    else
+    {
+        upload.delta_step = DELTA_SKIP;
+    }
+
+    return true;
+}
+
+// Apply a chunk of delta to the framebuffer, in place
+static bool frame_upload_write_delta(const uint8_t* data, uint32_t len)
+{
+    uint8_t* framebuffer = upload.planes[0];
+
+    upload.received += len;
+
+    while (len > 0)
+    {
+        if (upload.delta_step == DELTA_XOR)
+        {
+            uint32_t count = MIN(len, upload.value);
+
+            upload.base_changed = true;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                framebuffer[upload.position + i] ^= data[i];
+            }
+
+            upload.position += count;
+            upload.value    -= count;
+            data            += count;
+            len             -= count;
+
+            if (upload.value == 0)
+            {
+                upload.delta_step = DELTA_SKIP;
+            }
+        }
+        else if (upload.delta_step == DELTA_BASE)
+        {
+            upload.value |= (uint32_t) *data++ << upload.shift;
+            upload.shift += 8;
+            len--;
+
+            if (upload.shift == 32)
+            {
+                if (!frame_upload_load_base(upload.value))
+                {
+                    return false;
+                }
+                upload.value      = 0;
+                upload.shift      = 0;
+                upload.delta_step = DELTA_SKIP;
+            }
+        }
+        else
+        {
+            if (!frame_upload_delta_field(*data++))
+            {
+                return false;
+            }
+            len--;
+        }
+    }
+
+    return true;
+}
+
+// Check an header against what the display can show
+static bool frame_upload_check_header(const frame_upload_header_t* header, uint32_t payload_len)
+{
+    if (header->version != FRAME_UPLOAD_VERSION)
+    {
+        ESP_LOGE(TAG, "Unsupported version %u", header->version);
+        return false;
+    }
+
+    // Portrait frames are turned by a quarter
+    bool portrait = (header->rotation == FRAME_ROTATION_90) || (header->rotation == FRAME_ROTATION_270);
+
+    if ((header->rotation > FRAME_ROTATION_270)
+        || (header->width != (portrait ? DISPLAY_HEIGHT : DISPLAY_WIDTH))
+        || (header->height != (portrait ? DISPLAY_WIDTH : DISPLAY_HEIGHT)))
+    {
+        ESP_LOGE(TAG, "Invalid frame size %ux%u", header->width, header->height);
+        return false;
+    }
+
+    if ((header->planes & ~(FRAME_PLANE_BW | FRAME_PLANE_RED)) != 0)
+    {
+        ESP_LOGE(TAG, "Invalid planes 0x%02X", header->planes);
+        return false;
+    }
+
+    uint8_t plane_count = __builtin_popcount(header->planes);
+    uint32_t expected_len;
+
+    switch (header->encoding)
+    {
+        case FRAME_ENCODING_PLANAR:
+            expected_len = plane_count * FRAMEBUFFER_PLANE_SIZE;
+            break;
+
+        // Both planes are interleaved
+        case FRAME_ENCODING_PACKED_2BPP:
+            expected_len = (plane_count == 2) ? FRAMEBUFFER_SIZE : 0;
+            break;
+
+        // Any length, records are checked while they are applied
+        case FRAME_ENCODING_XOR_DELTA:
+            if ((plane_count != 2) || (payload_len < sizeof(uint32_t)) || (payload_len > FRAMEBUFFER_SIZE))
+            {
+                ESP_LOGE(TAG, "Invalid delta");
+                return false;
+            }
+            expected_len = payload_len;
+            break;
+
+        default:
+            ESP_LOGE(TAG, "Unsupported encoding %u", header->encoding);
+            return false;
+    }
+
+    if (payload_len != expected_len)
+    {
+        ESP_LOGE(TAG, "Invalid payload length %lu", (unsigned long) payload_len);
+        return false;
+    }
+
+    return true;
+}
+
+bool frame_upload_begin(const uint8_t* header, uint32_t content_len)
+{
+    uint8_t* framebuffer = display_manager_get_framebuffer();
+    frame_upload_header_t hdr;
+
+    memset(&upload, 0, sizeof(upload));
+
+    if (framebuffer == NULL)
+    {
+        return false;
+    }
+
+    // Headerless upload, the whole framebuffer
+    if ((content_len == FRAMEBUFFER_SIZE)
+        && ((header[0] != FRAME_UPLOAD_MAGIC_0) || (header[1] != FRAME_UPLOAD_MAGIC_1)))
+    {
+        upload.planes[0]    = framebuffer;
+        upload.planes[1]    = framebuffer + FRAMEBUFFER_PLANE_SIZE;
+        upload.plane_count  = 2;
+        upload.expected     = FRAMEBUFFER_SIZE;
+        upload.stride       = DISPLAY_WIDTH / 8U;
+        upload.changed_last = FRAMEBUFFER_PLANE_SIZE - 1U;
+        upload.active       = true;
+
+        display_manager_set_rotation(FRAME_ROTATION_0);
+
+        // Header bytes are the start of the payload
+        return frame_upload_write(header, FRAME_UPLOAD_HEADER_SIZE);
+    }
+
+    if ((content_len < FRAME_UPLOAD_HEADER_SIZE)
+        || (header[0] != FRAME_UPLOAD_MAGIC_0) || (header[1] != FRAME_UPLOAD_MAGIC_1))
+    {
+        ESP_LOGE(TAG, "Invalid header");
+        return false;
+    }
+
+    memcpy(&hdr, header, sizeof(hdr));
+    if (!frame_upload_check_header(&hdr, content_len - FRAME_UPLOAD_HEADER_SIZE))
+    {
+        return false;
+    }
+
+    // Planes left out of the payload are blank: white and no red
+    if (hdr.planes & FRAME_PLANE_BW)
+    {
+        upload.planes[upload.plane_count++] = framebuffer;
+    }
+    else
+    {
+        memset(framebuffer, 0xFF, FRAMEBUFFER_PLANE_SIZE);
+    }
+
+    if (hdr.planes & FRAME_PLANE_RED)
+    {
+        upload.planes[upload.plane_count++] = framebuffer + FRAMEBUFFER_PLANE_SIZE;
+    }
+    else
+    {
+        memset(framebuffer + FRAMEBUFFER_PLANE_SIZE, 0x00, FRAMEBUFFER_PLANE_SIZE);
+    }
+
+    upload.base_rotation = display_manager_get_rotation();
+    display_manager_set_rotation((frame_rotation_t) hdr.rotation);
+
+    upload.encoding     = hdr.encoding;
+    upload.stride       = hdr.width / 8U;
+    upload.expected     = content_len - FRAME_UPLOAD_HEADER_SIZE;
+    upload.expected_crc = hdr.crc32;
+    upload.check_crc    = true;
+    upload.active       = true;
+
+    // A delta tells which rows it changes
+    if (hdr.encoding == FRAME_ENCODING_XOR_DELTA)
+    {
+        upload.changed_first = UINT32_MAX;
+    }
+    else
+    {
+        upload.changed_last = FRAMEBUFFER_PLANE_SIZE - 1U;
+    }
+
+    return true;
+}
+
+bool frame_upload_write(const uint8_t* data, uint32_t len)
+{
+    if (!upload.active || (len > (upload.expected - upload.received - upload.carry_len)))
+    {
+        upload.active = false;
+        return false;
+    }
+
+    if (upload.check_crc)
+    {
+        upload.crc = esp_rom_crc32_le(upload.crc, data, len);
+    }
+
+    if (upload.encoding == FRAME_ENCODING_XOR_DELTA)
+    {
+        upload.active = frame_upload_write_delta(data, len);
+        return upload.active;
+    }
+    else if (upload.encoding == FRAME_ENCODING_PACKED_2BPP)
+    {
+        frame_upload_write_packed(data, len);
+    }
+    else
+    {
+        frame_upload_write_planar(data, len);
+    }
+
+    return true;
+}
+
+bool frame_upload_end(void)
+{
+    bool ret = upload.active && (upload.received == upload.expected);
+
+    if (ret && upload.check_crc && (upload.crc != upload.expected_crc))
+    {
+        ESP_LOGE(TAG, "CRC mismatch");
+        ret = false;
+    }
+
+    // A delta ends after a whole record
+    if (ret && (upload.encoding == FRAME_ENCODING_XOR_DELTA)
+        && ((upload.delta_step != DELTA_SKIP) || (upload.shift != 0)))
+    {
+        ESP_LOGE(TAG, "Truncated delta");
+        ret = false;
+    }
+
+    if (!ret && (upload.encoding == FRAME_ENCODING_XOR_DELTA))
+    {
+        frame_upload_restore_base();
+    }
+
+    upload.active = false;
+    return ret;
+}
+
+bool frame_upload_base_missing(void)
+{
+    return upload.base_missing;
+}
+
+bool frame_upload_changed_rows(uint16_t* first, uint16_t* last)
+{
+    if ((upload.stride == 0) || (upload.changed_first > upload.changed_last))
+    {
+        return false;
+    }
+
+    *first = upload.changed_first / upload.stride;
+    *last  = upload.changed_last / upload.stride;
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FRAME_UPLOAD_MAGIC_0        'P'
+#define FRAME_UPLOAD_MAGIC_1        'F'
+#define FRAME_UPLOAD_VERSION        1U
+
+// Planes carried by the payload, in this order
+#define FRAME_PLANE_BW              (1U << 0)   // White/black plane
+#define FRAME_PLANE_RED             (1U << 1)   // Red/none plane
+
+// Payload encodings
+typedef enum
+{
+    FRAME_ENCODING_PLANAR = 0,      // Raw planes, 1 byte = 8 pixels, MSB first
+    FRAME_ENCODING_PACKED_2BPP,     // Both planes interleaved, 1 byte = 4 pixels, MSB first
+                                    // Pixel bit 1 is red, bit 0 is white
+    FRAME_ENCODING_XOR_DELTA,       // Changes to a stored frame, see below
+} frame_encoding_t;
+
+// Delta payload: the CRC32 of the base frame, u32 little endian, then records until the end
+// A record is a skip then a count, both unsigned LEB128, and count bytes XORed to the base
+// Offsets run over both planes, in framebuffer layout, the base frame is a stored frame, that the framebuffer may hold
+// Both planes must be present and the payload must not be larger than the framebuffer
+
+// Upload header, little endian, followed by the payload
+typedef struct __attribute__((__packed__))
+{
+    uint8_t     magic[2];           // FRAME_UPLOAD_MAGIC_0, FRAME_UPLOAD_MAGIC_1
+    uint8_t     version;            // FRAME_UPLOAD_VERSION
+    uint8_t     encoding;           // frame_encoding_t
+    uint16_t    width;              // Must match DISPLAY_WIDTH
+    uint16_t    height;             // Must match DISPLAY_HEIGHT
+    uint8_t     planes;             // FRAME_PLANE_* bitmask
+    uint8_t     rotation;           // frame_rotation_t, 90 and 270 for DISPLAY_HEIGHT x DISPLAY_WIDTH frames
+    uint8_t     reserved[2];
+    uint32_t    crc32;              // CRC32 of the payload
+} frame_upload_header_t;
+
+#define FRAME_UPLOAD_HEADER_SIZE    sizeof(frame_upload_header_t)
+
+// Start an upload of content_len bytes, given its first FRAME_UPLOAD_HEADER_SIZE bytes
+// A headerless upload of exactly the framebuffer size is taken as raw planes
+bool    frame_upload_begin(const uint8_t* header, uint32_t content_len);
+
+// Decode a chunk of payload into the framebuffer
+bool    frame_upload_write(const uint8_t* data, uint32_t len);
+
+// Check the whole payload was received and is valid
+// A delta that is not gives the framebuffer back its base, read from the store when it was changed
+bool    frame_upload_end(void);
+
+// Tell the last upload failed as a delta against a frame that is not stored, or whose base could not be restored
+bool    frame_upload_base_missing(void);
+
+// Get the rows changed by the last upload, in framebuffer layout
+// All of them unless it was a delta against the framebuffer with the same rotation
+// Return false if it changed none
+bool    frame_upload_changed_rows(uint16_t* first, uint16_t* last);
+
+#ifdef __cplusplus
+}
+#endif
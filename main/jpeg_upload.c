@@ -0,0 +1,246 @@
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/param.h>
+
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp32/rom/tjpgd.h"
+
+#include "display_config.h"
+#include "display_manager.h"
+#include "jpeg_upload.h"
+
+#define JPEG_WORK_SIZE          3100U   // TJpgDec work pool
+#define JPEG_SKIP_SIZE          64U     // Scratch used to skip input bytes
+#define JPEG_MAX_SCALE          3U      // TJpgDec downscales by up to 1/8
+
+// Decoding context, given to TJpgDec callbacks
+typedef struct
+{
+    jpeg_upload_read_t  read;
+    void*               ctx;
+
+    uint16_t            frame_width;    // Display layout, or the portrait one turned by the device
+    uint16_t            frame_height;
+
+    uint16_t*           src_x;          // Decoded column sampled by each frame column
+    uint16_t            crop_y;         // Decoded rows sampled by the frame
+    uint16_t            crop_height;
+
+    uint8_t*            rows;           // Decoded rows of the current MCU row, sampled to frame_width RGB888 pixels
+    uint16_t            row_count;      // Slots in rows, the MCU height
+    uint16_t            row_next;       // First frame row not dithered yet
+    uint16_t            col_next;       // First frame column not sampled yet in the MCU row
+
+    size_t              heap_low;       // Lowest free heap seen during the decoding
+} jpeg_ctx_t;
+
+static const char* TAG = "jpeg_upload";
+
+static uint32_t jpeg_input(JDEC* jd, uint8_t* buff, uint32_t len);
+static uint32_t jpeg_output(JDEC* jd, void* bitmap, JRECT* rect);
+static uint16_t jpeg_src_y(const jpeg_ctx_t* jc, uint16_t y);
+static void     jpeg_flush_rows(jpeg_ctx_t* jc, uint16_t src_limit);
+static bool     jpeg_setup(jpeg_ctx_t* jc, const JDEC* jd, uint8_t* scale);
+
+// Decoded row sampled by a frame row
+static uint16_t jpeg_src_y(const jpeg_ctx_t* jc, uint16_t y)
+{
+    return jc->crop_y + ((uint32_t) y * jc->crop_height) / jc->frame_height;
+}
+
+// Dither the frame rows sampled above src_limit, they won't change anymore
+static void jpeg_flush_rows(jpeg_ctx_t* jc, uint16_t src_limit)
+{
+    uint16_t sy;
+
+    while ((jc->row_next < jc->frame_height) && ((sy = jpeg_src_y(jc, jc->row_next)) < src_limit))
+    {
+        uint8_t* row = jc->rows + (sy % jc->row_count) * jc->frame_width * 3U;
+        frame_dither_row(jc->row_next, row);
+        jc->row_next++;
+    }
+}
+
+// TJpgDec input, buff is NULL when bytes have to be skipped
+static uint32_t jpeg_input(JDEC* jd, uint8_t* buff, uint32_t len)
+{
+    jpeg_ctx_t* jc = (jpeg_ctx_t*) jd->device;
+    uint8_t skip[JPEG_SKIP_SIZE];
+    uint32_t done = 0;
+
+    while (done < len)
+    {
+        uint8_t* dst = (buff != NULL) ? (buff + done) : skip;
+        uint32_t max = (buff != NULL) ? (len - done) : MIN(len - done, sizeof(skip));
+        int ret = jc->read(jc->ctx, dst, max);
+
+        // End of stream or error, TJpgDec fails on short reads
+        if (ret <= 0)
+        {
+            break;
+        }
+
+        done += ret;
+    }
+
+    return done;
+}
+
+// TJpgDec output, one MCU block in raster order
+static uint32_t jpeg_output(JDEC* jd, void* bitmap, JRECT* rect)
+{
+    jpeg_ctx_t* jc = (jpeg_ctx_t*) jd->device;
+    const uint8_t* pixels = (const uint8_t*) bitmap;
+    uint16_t block_width = rect->right - rect->left + 1U;
+
+    // New MCU row, every frame row sampled above it is complete
+    if (rect->left == 0)
+    {
+        jpeg_flush_rows(jc, rect->top);
+        jc->col_next = 0;
+        jc->heap_low = MIN(jc->heap_low, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    }
+
+    // Frame columns sampled from this block
+    uint16_t col_first = jc->col_next;
+    while ((jc->col_next < jc->frame_width) && (jc->src_x[jc->col_next] <= rect->right))
+    {
+        jc->col_next++;
+    }
+
+    // Decoded rows sampled from this block, once each when the picture is upscaled
+    uint16_t sy_last = UINT16_MAX;
+    for (uint16_t y = jc->row_next; y < jc->frame_height; y++)
+    {
+        uint16_t sy = jpeg_src_y(jc, y);
+
+        if (sy > rect->bottom)
+        {
+            break;
+        }
+        if (sy == sy_last)
+        {
+            continue;
+        }
+        sy_last = sy;
+
+        const uint8_t* src = pixels + (sy - rect->top) * block_width * 3U;
+        uint8_t* dst = jc->rows + (sy % jc->row_count) * jc->frame_width * 3U;
+
+        for (uint16_t x = col_first; x < jc->col_next; x++)
+        {
+            memcpy(&dst[x * 3U], &src[(jc->src_x[x] - rect->left) * 3U], 3);
+        }
+    }
+
+    return 1;
+}
+
+// Pick the frame layout, the decoder scale and the crop window, allocate the sampling buffers
+// Portrait pictures are kept as DISPLAY_HEIGHT x DISPLAY_WIDTH frames turned by the device, like the web page does
+static bool jpeg_setup(jpeg_ctx_t* jc, const JDEC* jd, uint8_t* scale)
+{
+    bool portrait = (jd->width < jd->height);
+    jc->frame_width  = portrait ? DISPLAY_HEIGHT : DISPLAY_WIDTH;
+    jc->frame_height = portrait ? DISPLAY_WIDTH : DISPLAY_HEIGHT;
+
+    // Crop to the frame ratio, centered. Smaller pictures are upscaled by the sampling
+    uint32_t crop_w = jd->width;
+    uint32_t crop_h = jd->height;
+
+    if ((crop_w * jc->frame_height) > (crop_h * jc->frame_width))
+    {
+        crop_w = MAX((crop_h * jc->frame_width) / jc->frame_height, 1U);
+    }
+    else
+    {
+        crop_h = MAX((crop_w * jc->frame_height) / jc->frame_width, 1U);
+    }
+
+    // Largest decoder downscale still covering the frame resolution
+    *scale = JPEG_MAX_SCALE;
+    while ((*scale > 0) && (((crop_w >> *scale) < jc->frame_width) || ((crop_h >> *scale) < jc->frame_height)))
+    {
+        (*scale)--;
+    }
+
+    uint16_t crop_x = ((jd->width - crop_w) / 2U) >> *scale;
+    crop_w >>= *scale;
+    jc->crop_y      = ((jd->height - crop_h) / 2U) >> *scale;
+    jc->crop_height = crop_h >> *scale;
+
+    // Decoded rows are kept until the next MCU row starts
+    jc->row_count = (jd->msy * 8U) >> *scale;
+
+    jc->src_x = malloc(jc->frame_width * sizeof(uint16_t));
+    jc->rows  = calloc(jc->row_count, jc->frame_width * 3U);
+
+    if ((jc->src_x == NULL) || (jc->rows == NULL))
+    {
+        ESP_LOGE(TAG, "Not enough memory for %u rows", jc->row_count);
+        return false;
+    }
+
+    for (uint16_t x = 0; x < jc->frame_width; x++)
+    {
+        jc->src_x[x] = crop_x + ((uint32_t) x * crop_w) / jc->frame_width;
+    }
+
+    display_manager_set_rotation(portrait ? FRAME_ROTATION_90 : FRAME_ROTATION_0);
+
+    ESP_LOGI(TAG, "Decoding %ux%u at 1/%u into a %ux%u frame, %u rows buffered",
+             jd->width, jd->height, 1U << *scale, jc->frame_width, jc->frame_height, jc->row_count);
+
+    return true;
+}
+
+bool jpeg_upload_decode(jpeg_upload_read_t read, void* ctx, frame_palette_t palette)
+{
+    int64_t     start   = esp_timer_get_time();
+    size_t      heap    = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    jpeg_ctx_t  jc      = { .read = read, .ctx = ctx, .heap_low = heap };
+    JDEC        jd;
+    uint8_t     scale   = 0;
+    void*       work    = malloc(JPEG_WORK_SIZE);
+    bool        ret     = (work != NULL);
+
+    if (ret && (jd_prepare(&jd, jpeg_input, work, JPEG_WORK_SIZE, &jc) != JDR_OK))
+    {
+        ESP_LOGE(TAG, "Not a baseline JPEG");
+        ret = false;
+    }
+
+    ret = ret && jpeg_setup(&jc, &jd, &scale) && frame_dither_begin(palette, jc.frame_width);
+
+    if (ret)
+    {
+        JRESULT res = jd_decomp(&jd, jpeg_output, scale);
+        if (res != JDR_OK)
+        {
+            ESP_LOGE(TAG, "Decoding failed: %d", res);
+            ret = false;
+        }
+    }
+
+    // Last MCU row
+    if (ret)
+    {
+        jpeg_flush_rows(&jc, UINT16_MAX);
+    }
+
+    frame_dither_end();
+    free(jc.rows);
+    free(jc.src_x);
+    free(work);
+
+    // Free heap is sampled at each MCU row, once every buffer is allocated
+    ESP_LOGI(TAG, "Frame decoded in %" PRId32 " ms, heap used %u bytes of %u free",
+             (int32_t) ((esp_timer_get_time() - start) / 1000),
+             (unsigned) (heap - jc.heap_low), (unsigned) heap);
+
+    return ret;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "frame_dither.h"
+
+// Read up to len bytes of the JPEG stream, returns the count read or <= 0 on error
+typedef int (*jpeg_upload_read_t)(void* ctx, uint8_t* buff, uint32_t len);
+
+// Decode a baseline JPEG stream, crop and resize it to the display then dither it to the framebuffer
+// Portrait pictures are decoded in portrait layout and the framebuffer rotation set to FRAME_ROTATION_90
+// Only a few MCU rows are held in RAM at once
+bool    jpeg_upload_decode(jpeg_upload_read_t read, void* ctx, frame_palette_t palette);
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,6 +3,9 @@
  *  Started from captive_portal example from Espressif
  */
 
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <sys/param.h>
 
 #include "esp_event.h"
@@ -13,6 +16,8 @@
 #include "esp_wifi.h"
 #include "esp_netif.h"
 #include "esp_sleep.h"
+#include "esp_timer.h"
+#include "driver/rtc_io.h"
 #include "lwip/inet.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -20,9 +25,35 @@
 #include "esp_http_server.h"
 #include "dns_server.h"
 
+#include "display_config.h"
 #include "display_manager.h"
+#include "frame_upload.h"
+#include "jpeg_upload.h"
+#include "frame_store.h"
+#include "frame_image.h"
+#include "frame_draw.h"
+#include "metrics.h"
+#include "trace.h"
+#include "mem_report.h"
+#include "station_update.h"
+#include "update_job.h"
 
-// index.html, script.js and style.css binary sources
+// Upload payload is received by chunks of this size
+#define UPLOAD_CHUNK_SIZE       1024U
+
+// Encoded images are sent by chunks of about one TCP segment
+#define IMAGE_CHUNK_SIZE        1436U
+
+// Upload queries, room for a caption of 3 bytes per character once URL-encoded
+#define UPLOAD_QUERY_SIZE       (3U * FRAME_CAPTION_MAX + 32U)
+
+// Longest wait of a request for the framebuffer, the main loop holds it while it saves and sends a frame
+#define FRAMEBUFFER_WAIT_MS     5000U
+
+// Status requests waiting for their job at once, more are answered without waiting
+#define JOB_POLL_MAX            4U
+
+// index.html, script.js, style.css and panel.js binary sources, panel.js is generated from the panel descriptor
 extern const char html_start[] asm("_binary_index_html_start");
 extern const char html_end[] asm("_binary_index_html_end");
 
@@ -32,13 +63,66 @@ extern const char script_end[] asm("_binary_script_js_end");
 extern const char style_start[] asm("_binary_style_css_start");
 extern const char style_end[] asm("_binary_style_css_end");
 
+extern const char panel_start[] asm("_binary_panel_js_start");
+extern const char panel_end[] asm("_binary_panel_js_end");
+
+
+// Boot stages, timed from the start of the application
+typedef enum
+{
+    BOOT_APP_MAIN = 0,
+    BOOT_NVS,
+    BOOT_WIFI_START,
+    BOOT_SSID,
+    BOOT_SERVICES,
+    BOOT_STAGE_COUNT,
+} boot_stage_t;
+
+// Encoded image waiting to be sent
+typedef struct
+{
+    httpd_req_t*    req;
+    uint32_t        len;
+    uint8_t         buff[IMAGE_CHUNK_SIZE];
+} image_response_t;
 
 static esp_err_t common_get_handler(httpd_req_t *req);
+static bool take_framebuffer(httpd_req_t *req);
+static void release_framebuffer(void);
 static esp_err_t buffer_post_handler(httpd_req_t *req);
+static esp_err_t receive_upload(httpd_req_t *req, uint32_t job, const char* caption);
+static void get_caption(const char* query, char* caption, size_t len);
+static bool receive_exact(httpd_req_t *req, uint8_t* buff, uint32_t len);
+static int receive_some(void* ctx, uint8_t* buff, uint32_t len);
+static esp_err_t jpeg_post_handler(httpd_req_t *req);
+static esp_err_t frames_get_handler(httpd_req_t *req);
+static esp_err_t stored_frame_get_handler(httpd_req_t *req);
+static esp_err_t frame_get_handler(httpd_req_t *req);
+static esp_err_t metrics_get_handler(httpd_req_t *req);
+static esp_err_t trace_get_handler(httpd_req_t *req);
+static esp_err_t memory_get_handler(httpd_req_t *req);
+static esp_err_t stored_frame_post_handler(httpd_req_t *req);
+static esp_err_t job_get_handler(httpd_req_t *req);
+static esp_err_t send_job_status(httpd_req_t *req, uint32_t id, bool sleep);
+static void job_poll_task(void* param);
+static esp_err_t send_job_id(httpd_req_t *req, uint32_t id);
+static bool image_response_write(void* ctx, const uint8_t* data, uint32_t len);
+static esp_err_t send_frame_image(httpd_req_t *req, frame_image_format_t format, const frame_store_entry_t* entry);
+static esp_err_t send_thumbnail(httpd_req_t *req, const frame_store_entry_t* entry);
 static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
 static void wifi_init_softap(void);
 static httpd_handle_t start_webserver(void);
 static void goto_power_saving(void);
+static void boot_mark(boot_stage_t stage);
+static void boot_report(void);
+static void services_task(void* param);
+static void init_nvs(void);
+static uint32_t replace_received_frame(void);
+static uint32_t take_received_frame(void);
+static void show_received_frame(uint32_t job);
+#if STATION_UPDATE_ENABLED
+static void station_check(void);
+#endif
 
 // GET uri for all pages
 static const httpd_uri_t common_get_uri = {
@@ -56,22 +140,168 @@ static const httpd_uri_t buffer_post_uri = {
     .user_ctx  = NULL
 };
 
+// POST uri for JPEG upload, decoded on the device
+static const httpd_uri_t jpeg_post_uri = {
+    .uri       = "/upload/jpeg",
+    .method    = HTTP_POST,
+    .handler   = jpeg_post_handler,
+    .user_ctx  = NULL
+};
+
+// GET uri for the index of stored frames
+static const httpd_uri_t frames_get_uri = {
+    .uri       = "/frames",
+    .method    = HTTP_GET,
+    .handler   = frames_get_handler,
+    .user_ctx  = NULL
+};
+
+// GET uri for a stored frame, as thumbnail or image
+static const httpd_uri_t stored_frame_get_uri = {
+    .uri       = "/frames/*",
+    .method    = HTTP_GET,
+    .handler   = stored_frame_get_handler,
+    .user_ctx  = NULL
+};
+
+// GET uri for the framebuffer as an image
+static const httpd_uri_t frame_get_uri = {
+    .uri       = "/frame.*",
+    .method    = HTTP_GET,
+    .handler   = frame_get_handler,
+    .user_ctx  = NULL
+};
+
+// GET uri for the update metrics
+static const httpd_uri_t metrics_get_uri = {
+    .uri       = "/metrics",
+    .method    = HTTP_GET,
+    .handler   = metrics_get_handler,
+    .user_ctx  = NULL
+};
+
+// GET uri for the binary trace dump
+static const httpd_uri_t trace_get_uri = {
+    .uri       = "/trace",
+    .method    = HTTP_GET,
+    .handler   = trace_get_handler,
+    .user_ctx  = NULL
+};
+
+// GET uri for the RAM report
+static const httpd_uri_t memory_get_uri = {
+    .uri       = "/memory",
+    .method    = HTTP_GET,
+    .handler   = memory_get_handler,
+    .user_ctx  = NULL
+};
+
+// GET uri for the status of an update, long-polled
+static const httpd_uri_t job_get_uri = {
+    .uri       = "/jobs/*",
+    .method    = HTTP_GET,
+    .handler   = job_get_handler,
+    .user_ctx  = NULL
+};
+
+// POST uri to show a stored frame, /frames/<id>/show
+static const httpd_uri_t stored_frame_post_uri = {
+    .uri       = "/frames/*",
+    .method    = HTTP_POST,
+    .handler   = stored_frame_post_handler,
+    .user_ctx  = NULL
+};
+
 static const char*          TAG                         = "main";
 static const char*          WIFI_SSID                   = "PaperFrame";
-static bool                 image_received              = false;
+static volatile uint32_t    received_job                = 0;        // Job of the frame waiting in the framebuffer, 0 if none
+                                                                    // Set and cleared with the framebuffer taken
+static volatile int16_t     stored_frame_requested      = -1;       // Stored frame to show, -1 if none
+static volatile int16_t     stored_frame_shown          = -1;       // Stored frame on the display, -1 if from the framebuffer
 static volatile  uint32_t   timeout_start               = 0;        // Startup time, used to make a timeout
+static volatile bool        sleep_requested             = false;    // A client got the end of its update and is done
+static bool                 softap_started              = false;    // WiFi is on as the portal, the station check stops it itself
+static int64_t              boot_times[BOOT_STAGE_COUNT];           // In us, 0 until reached
+static uint8_t              boot_stages_left            = BOOT_STAGE_COUNT;
+static portMUX_TYPE         boot_lock                   = portMUX_INITIALIZER_UNLOCKED;
+
+// A status request held for its job, by job_poll_task
+typedef struct
+{
+    httpd_req_t*        req;        // Async copy of the request, NULL when the slot is free
+    uint32_t            id;
+    update_job_state_t  after;
+    bool                sleep;
+    TickType_t          deadline;
+} job_poll_t;
+
+// Slots are filled by the web server and freed by job_poll_task, under the lock
+static job_poll_t           job_polls[JOB_POLL_MAX];
+static portMUX_TYPE         job_polls_lock              = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t         job_poll_handle             = NULL;
+
+static const char* const    boot_stage_names[BOOT_STAGE_COUNT] = {
+    [BOOT_APP_MAIN]     = "app_main",
+    [BOOT_NVS]          = "nvs",
+    [BOOT_WIFI_START]   = "wifi_start",
+    [BOOT_SSID]         = "ssid",
+    [BOOT_SERVICES]     = "services",
+};
+
+// Our own logs stay at info level, the startup logs of other components are muted by the sdkconfig
+static const char* const    app_log_tags[] = {
+    "main", "display_manager", "display_driver", "frame_store", "frame_upload", "jpeg_upload", "dns_redirect_server",
+    "station_update",
+};
+
+static void boot_report(void)
+{
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++)
+    {
+        ESP_LOGI(TAG, "Boot stage %-10s at %4d ms", boot_stage_names[i], (int) (boot_times[i] / 1000));
+    }
+}
+
+// Record when a boot stage is reached, from any task, the report is printed once the last one is
+static void boot_mark(boot_stage_t stage)
+{
+    int64_t now = esp_timer_get_time();
+    bool last = false;
+
+    taskENTER_CRITICAL(&boot_lock);
+    if (boot_times[stage] == 0)
+    {
+        boot_times[stage] = now;
+        last = (--boot_stages_left == 0);
+    }
+    taskEXIT_CRITICAL(&boot_lock);
+
+    if (last)
+    {
+        boot_report();
+    }
+}
 
 // Handler for WiFi events 
 static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                                int32_t event_id, void *event_data)
 {
-    if (event_id == WIFI_EVENT_AP_STACONNECTED)
+    if (event_id == WIFI_EVENT_AP_START)
+    {
+        // The SSID is broadcast from now on
+        boot_mark(BOOT_SSID);
+        metrics_begin(METRIC_CONNECT);
+    }
+    else if (event_id == WIFI_EVENT_AP_STACONNECTED)
     {
         wifi_event_ap_staconnected_t *event = (wifi_event_ap_staconnected_t *)event_data;
         ESP_LOGI(TAG, "station " MACSTR " join, AID=%d", MAC2STR(event->mac), event->aid);
 
         // Reset power-down timeout to give the user two minutes
         timeout_start = xTaskGetTickCount();
+
+        metrics_end(METRIC_CONNECT);
+        metrics_begin(METRIC_FIRST_GET);
     } 
     else if (event_id == WIFI_EVENT_AP_STADISCONNECTED)
     {
@@ -107,6 +337,8 @@ static void wifi_init_softap(void)
 
     // Start WiFi
     ESP_ERROR_CHECK(esp_wifi_start());
+    softap_started = true;
+    metrics_radio(true);
 
     esp_netif_ip_info_t ip_info;
     esp_netif_get_ip_info(esp_netif_get_handle_from_ifkey("WIFI_AP_DEF"), &ip_info);
@@ -121,10 +353,11 @@ static void wifi_init_softap(void)
 // HTTP GET Handler for allpages to redirect to index.html
 static esp_err_t common_get_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "GET requested: %s", req->uri);
+    TRACE(TRACE_HTTP_GET, trace_chars(req->uri + 1), (strlen(req->uri) > 5) ? trace_chars(req->uri + 5) : 0);
+    metrics_end(METRIC_FIRST_GET);
 
-    uint32_t data_len = 0;
-    char* data_start  = 0;
+    uint32_t    data_len    = 0;
+    const char* data_start  = NULL;
 
     if (strcmp(req->uri, "/script.js") == 0)
     {
@@ -132,6 +365,12 @@ static esp_err_t common_get_handler(httpd_req_t *req)
         data_len   = script_end - script_start;
         httpd_resp_set_type(req, "text/javascript");
     }
+    else if (strcmp(req->uri, "/panel.js") == 0)
+    {
+        data_start = panel_start;
+        data_len   = panel_end - panel_start;
+        httpd_resp_set_type(req, "text/javascript");
+    }
     else if (strcmp(req->uri, "/style.css") == 0)
     {
         data_start = style_start;
@@ -150,49 +389,782 @@ static esp_err_t common_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-// HTTP buffer POST upload handler
+// Receive exactly len bytes of the request body
+static bool receive_exact(httpd_req_t *req, uint8_t* buff, uint32_t len)
+{
+    while (len > 0)
+    {
+        int ret = httpd_req_recv(req, (char*) buff, len);
+
+        if (ret <= 0)
+        {
+            // Retry in case of timeout
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+            {
+                continue;
+            }
+            return false;
+        }
+
+        buff += ret;
+        len  -= ret;
+    }
+
+    return true;
+}
+
+// Receive up to len bytes of the request body, for streamed decoders
+static int receive_some(void* ctx, uint8_t* buff, uint32_t len)
+{
+    httpd_req_t* req = (httpd_req_t*) ctx;
+    int ret;
+
+    // Retry in case of timeout
+    do
+    {
+        ret = httpd_req_recv(req, (char*) buff, len);
+    }
+    while (ret == HTTPD_SOCK_ERR_TIMEOUT);
+
+    return ret;
+}
+
+// Take the framebuffer for a request, or answer it is busy
+static bool take_framebuffer(httpd_req_t *req)
+{
+    if (display_manager_take_framebuffer(pdMS_TO_TICKS(FRAMEBUFFER_WAIT_MS)))
+    {
+        return true;
+    }
+
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_sendstr(req, "Frame busy");
+    return false;
+}
+
+// Free the framebuffer unless an upload is writing it or a received frame waits to be shown
+static void release_framebuffer(void)
+{
+    if (display_manager_take_framebuffer(0))
+    {
+        if (received_job == 0)
+        {
+            display_manager_release_framebuffer();
+        }
+        display_manager_give_framebuffer();
+    }
+}
+
+// Drop the frame waiting in the framebuffer, an upload is overwriting it. Call with the framebuffer taken
+// Return its job, failed, 0 if there was none
+static uint32_t replace_received_frame(void)
+{
+    uint32_t job = received_job;
+
+    if (job != 0)
+    {
+        update_job_advance(job, UPDATE_JOB_FAILED);
+        received_job = 0;
+    }
+
+    return job;
+}
+
+// Take the framebuffer with the frame waiting in it, unless an upload is writing it
+// Return its job, 0 if there is none to show and the framebuffer is not taken
+static uint32_t take_received_frame(void)
+{
+    uint32_t job = 0;
+
+    if ((received_job != 0) && display_manager_take_framebuffer(0))
+    {
+        // Cleared before it is shown, an upload during the refresh sets it again
+        job          = received_job;
+        received_job = 0;
+
+        // Dropped by a failed upload meanwhile
+        if (job == 0)
+        {
+            display_manager_give_framebuffer();
+        }
+    }
+
+    return job;
+}
+
+// Get the caption of an upload query, ?caption=, URL-decoded. Empty if there is none
+static void get_caption(const char* query, char* caption, size_t len)
+{
+    char value[3U * FRAME_CAPTION_MAX + 1U];
+    size_t pos = 0;
+
+    caption[0] = '\0';
+    if (httpd_query_key_value(query, "caption", value, sizeof(value)) != ESP_OK)
+    {
+        return;
+    }
+
+    // '+' is a space, %XX a byte
+    for (const char* c = value; (*c != '\0') && (pos < len - 1U); c++)
+    {
+        if ((c[0] == '%') && isxdigit((unsigned char) c[1]) && isxdigit((unsigned char) c[2]))
+        {
+            char hex[3] = { c[1], c[2], '\0' };
+            caption[pos++] = strtol(hex, NULL, 16);
+            c += 2;
+        }
+        else
+        {
+            caption[pos++] = (*c == '+') ? ' ' : *c;
+        }
+    }
+    caption[pos] = '\0';
+}
+
+// HTTP buffer POST upload handler, ?caption= to stamp a caption on the frame
 static esp_err_t buffer_post_handler(httpd_req_t *req)
 {
-    int ret            = ESP_FAIL;
-    int remaining      = req->content_len;
-    uint32_t idx       = 0;
-    uint8_t* buff      = display_manager_get_framebuffer();
-    uint32_t buff_size = display_manager_get_framebuffer_size();
+    char query[UPLOAD_QUERY_SIZE];
+    char caption[FRAME_CAPTION_MAX + 1U] = "";
+    uint32_t job = update_job_create();
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+    {
+        get_caption(query, caption, sizeof(caption));
+    }
+
+    if (!take_framebuffer(req))
+    {
+        update_job_advance(job, UPDATE_JOB_FAILED);
+        return ESP_FAIL;
+    }
+
+    esp_err_t ret = receive_upload(req, job, caption);
+    display_manager_give_framebuffer();
+
+    return ret;
+}
+
+// Decode an upload into the framebuffer, taken, and stamp its caption if not empty
+static esp_err_t receive_upload(httpd_req_t *req, uint32_t job, const char* caption)
+{
+    static uint8_t chunk[UPLOAD_CHUNK_SIZE];
+    uint32_t remaining = req->content_len;
+
+    metrics_begin(METRIC_UPLOAD);
+    TRACE(TRACE_UPLOAD_BEGIN, remaining, 0);
 
-    // We can't receive more than our buffer
-    if (remaining > buff_size)
+    // Start with the header, it tells how to decode the payload
+    if ((remaining < FRAME_UPLOAD_HEADER_SIZE)
+        || !receive_exact(req, chunk, FRAME_UPLOAD_HEADER_SIZE)
+        || !frame_upload_begin(chunk, remaining))
     {
+        update_job_advance(job, UPDATE_JOB_FAILED);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid upload");
         return ESP_FAIL;
     }
 
+    uint32_t replaced = replace_received_frame();
+
+    remaining -= FRAME_UPLOAD_HEADER_SIZE;
+
     // While we have incoming bytes
     while (remaining > 0)
     {
-        // Read the data for the request
-        if ((ret = httpd_req_recv(req, (char*) buff+idx, MIN(remaining, buff_size))) <= 0) 
+        uint32_t len = MIN(remaining, sizeof(chunk));
+
+        TRACE(TRACE_UPLOAD_CHUNK, remaining, len);
+        if (!receive_exact(req, chunk, len) || !frame_upload_write(chunk, len))
         {
-            // Retry in case of timeout
-            if (ret == HTTPD_SOCK_ERR_TIMEOUT) 
+            frame_upload_end();
+            update_job_advance(job, UPDATE_JOB_FAILED);
+            TRACE(TRACE_UPLOAD_END, req->content_len, false);
+
+            // The client has to send the whole frame
+            if (frame_upload_base_missing())
             {
-                continue;
+                httpd_resp_set_status(req, "409 Conflict");
+                httpd_resp_sendstr(req, "Unknown base frame");
+            }
+            return ESP_FAIL;
+        }
+
+        remaining -= len;
+    }
+    update_job_advance(job, UPDATE_JOB_RECEIVED);
+
+    if (!frame_upload_end())
+    {
+        update_job_advance(job, UPDATE_JOB_FAILED);
+        TRACE(TRACE_UPLOAD_END, req->content_len, false);
+
+        // The base could not be given back, the client has to send the whole frame
+        if (frame_upload_base_missing())
+        {
+            httpd_resp_set_status(req, "409 Conflict");
+            httpd_resp_sendstr(req, "Unknown base frame");
+        }
+        else
+        {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid frame");
+        }
+        return ESP_FAIL;
+    }
+
+    TRACE(TRACE_UPLOAD_END, req->content_len, true);
+    metrics_end(METRIC_UPLOAD);
+    update_job_advance(job, UPDATE_JOB_VALIDATED);
+
+    // A delta without changes leaves the display as it is, unless it applies to a frame not shown yet
+    // or the panel plays a stored frame back
+    uint16_t first_row, last_row;
+    bool changed = frame_upload_changed_rows(&first_row, &last_row);
+    if (changed)
+    {
+        ESP_LOGI(TAG, "Rows %u to %u changed", first_row, last_row);
+    }
+
+    // On the whole frame, it is stored and shown with it
+    if (caption[0] != '\0')
+    {
+        frame_draw_caption(caption);
+        changed = true;
+    }
+
+    if (changed || (replaced != 0) || (stored_frame_shown >= 0))
+    {
+        received_job = job;
+    }
+    else
+    {
+        update_job_advance(job, UPDATE_JOB_REFRESHED);
+    }
+
+    return send_job_id(req, job);
+}
+
+// HTTP JPEG POST upload handler, ?color=0 for black and white, ?caption= to stamp a caption on the frame
+static esp_err_t jpeg_post_handler(httpd_req_t *req)
+{
+    frame_palette_t palette = FRAME_PALETTE_KWR;
+    char query[UPLOAD_QUERY_SIZE];
+    char value[4];
+    char caption[FRAME_CAPTION_MAX + 1U] = "";
+    uint32_t job = update_job_create();
+
+    metrics_begin(METRIC_UPLOAD);
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+    {
+        if ((httpd_query_key_value(query, "color", value, sizeof(value)) == ESP_OK) && (strcmp(value, "0") == 0))
+        {
+            palette = FRAME_PALETTE_KW;
+        }
+        get_caption(query, caption, sizeof(caption));
+    }
+
+    if (!take_framebuffer(req))
+    {
+        update_job_advance(job, UPDATE_JOB_FAILED);
+        return ESP_FAIL;
+    }
+
+    replace_received_frame();
+
+    // The decoder sets the rotation, portrait pictures are turned by the device
+    TRACE(TRACE_JPEG_BEGIN, req->content_len, palette);
+    if (!jpeg_upload_decode(receive_some, req, palette))
+    {
+        display_manager_give_framebuffer();
+        TRACE(TRACE_JPEG_END, false, 0);
+        update_job_advance(job, UPDATE_JOB_FAILED);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JPEG");
+        return ESP_FAIL;
+    }
+
+    TRACE(TRACE_JPEG_END, true, 0);
+    metrics_end(METRIC_UPLOAD);
+
+    // Decoded while it was received
+    update_job_advance(job, UPDATE_JOB_RECEIVED);
+    update_job_advance(job, UPDATE_JOB_VALIDATED);
+
+    if (caption[0] != '\0')
+    {
+        frame_draw_caption(caption);
+    }
+
+    received_job = job;
+    display_manager_give_framebuffer();
+
+    return send_job_id(req, job);
+}
+
+// Answer an upload with the ID of its job, for GET /jobs/<id>
+static esp_err_t send_job_id(httpd_req_t *req, uint32_t id)
+{
+    char json[24];
+
+    snprintf(json, sizeof(json), "{\"job\":%lu}", (unsigned long) id);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, json);
+}
+
+// HTTP GET handler for the JSON index of stored frames, newest first
+static esp_err_t frames_get_handler(httpd_req_t *req)
+{
+    static frame_store_entry_t entries[FRAME_STORE_MAX_SLOTS];
+    uint8_t count = frame_store_list(entries, FRAME_STORE_MAX_SLOTS);
+    char item[64];
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr_chunk(req, "[");
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        snprintf(item, sizeof(item), "%s{\"id\":%u,\"seq\":%lu,\"rotation\":%u}",
+                 (i > 0) ? "," : "", entries[i].id, (unsigned long) entries[i].seq, entries[i].rotation * 90U);
+        httpd_resp_sendstr_chunk(req, item);
+    }
+
+    httpd_resp_sendstr_chunk(req, "]");
+
+    // End response
+    httpd_resp_send_chunk(req, NULL, 0);
+
+    return ESP_OK;
+}
+
+// Coalesce encoded rows into responses chunks of about one TCP segment
+static bool image_response_write(void* ctx, const uint8_t* data, uint32_t len)
+{
+    image_response_t* resp = (image_response_t*) ctx;
+
+    while (len > 0)
+    {
+        uint32_t n = MIN(len, sizeof(resp->buff) - resp->len);
+        memcpy(resp->buff + resp->len, data, n);
+        resp->len += n;
+        data      += n;
+        len       -= n;
+
+        if (resp->len == sizeof(resp->buff))
+        {
+            if (httpd_resp_send_chunk(resp->req, (const char*) resp->buff, resp->len) != ESP_OK)
+            {
+                return false;
             }
+            resp->len = 0;
+        }
+    }
+
+    return true;
+}
+
+// Stream a frame as an image, from the framebuffer or from a stored frame if entry is not NULL
+// Only one row of each plane is held at once
+static esp_err_t send_frame_image(httpd_req_t *req, frame_image_format_t format, const frame_store_entry_t* entry)
+{
+    static frame_image_encoder_t enc;
+    static image_response_t resp;
+    static uint8_t rows[2][DISPLAY_WIDTH / 8U];
+    const uint8_t* framebuffer = (entry != NULL) ? NULL : display_manager_get_framebuffer();
+    frame_rotation_t rotation  = (entry != NULL) ? entry->rotation : display_manager_get_rotation();
+
+    if ((entry == NULL) && (framebuffer == NULL))
+    {
+        return ESP_FAIL;
+    }
+
+    // Portrait frames are stored with their own geometry
+    bool     portrait = (rotation == FRAME_ROTATION_90) || (rotation == FRAME_ROTATION_270);
+    uint16_t width    = portrait ? DISPLAY_HEIGHT : DISPLAY_WIDTH;
+    uint16_t height   = portrait ? DISPLAY_WIDTH : DISPLAY_HEIGHT;
+    uint16_t stride   = width / 8U;
+
+    resp.req = req;
+    resp.len = 0;
+
+    httpd_resp_set_type(req, (format == FRAME_IMAGE_PNG) ? "image/png" : "image/bmp");
+    if (!frame_image_begin(&enc, format, width, height, image_response_write, &resp))
+    {
+        return ESP_FAIL;
+    }
+
+    for (uint32_t offset = 0; offset < FRAMEBUFFER_PLANE_SIZE; offset += stride)
+    {
+        const uint8_t* bw  = rows[0];
+        const uint8_t* red = rows[1];
+
+        if (entry == NULL)
+        {
+            bw  = framebuffer + offset;
+            red = framebuffer + FRAMEBUFFER_PLANE_SIZE + offset;
+        }
+        else if (!frame_store_read(entry, offset, rows[0], stride)
+                 || !frame_store_read(entry, FRAMEBUFFER_PLANE_SIZE + offset, rows[1], stride))
+        {
+            return ESP_FAIL;
+        }
+
+        if (!frame_image_row(&enc, bw, red))
+        {
             return ESP_FAIL;
         }
+    }
+
+    if (!frame_image_end(&enc)
+        || ((resp.len > 0) && (httpd_resp_send_chunk(req, (const char*) resp.buff, resp.len) != ESP_OK)))
+    {
+        return ESP_FAIL;
+    }
+
+    // End response
+    httpd_resp_send_chunk(req, NULL, 0);
+
+    return ESP_OK;
+}
+
+// Stream the thumbnail of a stored frame, as 8-bpp BMP with one pixel per 8x8 block
+// The frame is read from flash one band of rows at a time
+static esp_err_t send_thumbnail(httpd_req_t *req, const frame_store_entry_t* entry)
+{
+    static uint8_t band[2][FRAME_THUMB_BLOCK * DISPLAY_WIDTH / 8U] __attribute__((aligned(4)));
+    static uint8_t header[FRAME_IMAGE_BMP_SIZE(FRAME_THUMB_COLORS)];
+    static uint8_t row[DISPLAY_WIDTH / FRAME_THUMB_BLOCK];
+
+    // Portrait frames are stored with their own geometry
+    bool     portrait = (entry->rotation == FRAME_ROTATION_90) || (entry->rotation == FRAME_ROTATION_270);
+    uint16_t width    = portrait ? DISPLAY_HEIGHT : DISPLAY_WIDTH;
+    uint16_t height   = portrait ? DISPLAY_WIDTH : DISPLAY_HEIGHT;
+    uint16_t stride   = width / 8U;
+    uint32_t len      = FRAME_THUMB_BLOCK * stride;
+
+    frame_image_bmp_header(header, stride, height / FRAME_THUMB_BLOCK, 8, FRAME_THUMB_COLORS);
+    frame_image_thumb_palette(header + FRAME_IMAGE_BMP_HEADER_SIZE);
+
+    httpd_resp_set_type(req, "image/bmp");
+    httpd_resp_send_chunk(req, (const char*) header, sizeof(header));
 
-        remaining -= ret;
-        idx       += ret;
+    for (uint32_t offset = 0; offset < FRAMEBUFFER_PLANE_SIZE; offset += len)
+    {
+        if (!frame_store_read(entry, offset, band[0], len)
+            || !frame_store_read(entry, FRAMEBUFFER_PLANE_SIZE + offset, band[1], len))
+        {
+            return ESP_FAIL;
+        }
 
-        ESP_LOGI(TAG, "Received %d bytes", ret);
+        frame_image_thumb_row(band[0], band[1], stride, row);
+
+        if (httpd_resp_send_chunk(req, (const char*) row, stride) != ESP_OK)
+        {
+            return ESP_FAIL;
+        }
     }
 
     // End response
     httpd_resp_send_chunk(req, NULL, 0);
 
-    image_received = true;
+    return ESP_OK;
+}
+
+// HTTP GET handler for stored frames: /frames/<id>/thumb, /frames/<id>/frame.png or /frames/<id>/frame.bmp
+static esp_err_t stored_frame_get_handler(httpd_req_t *req)
+{
+    frame_store_entry_t entry;
+    unsigned id;
+    char tail[16];
+
+    if ((sscanf(req->uri, "/frames/%u/%15s", &id, tail) != 2)
+        || (id > UINT8_MAX) || !frame_store_get(id, &entry))
+    {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such frame");
+        return ESP_FAIL;
+    }
+
+    if (strcmp(tail, "thumb") == 0)
+    {
+        return send_thumbnail(req, &entry);
+    }
+    else if (strcmp(tail, "frame.png") == 0)
+    {
+        return send_frame_image(req, FRAME_IMAGE_PNG, &entry);
+    }
+    else if (strcmp(tail, "frame.bmp") == 0)
+    {
+        return send_frame_image(req, FRAME_IMAGE_BMP, &entry);
+    }
+
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such frame");
+    return ESP_FAIL;
+}
+
+// HTTP GET handler for the framebuffer as an image, /frame.png or /frame.bmp
+// After a play back, or once the framebuffer is released, the frame shown is read from the store
+static esp_err_t frame_get_handler(httpd_req_t *req)
+{
+    frame_store_entry_t shown;
+    const frame_store_entry_t* entry = NULL;
+    frame_image_format_t format;
+    int16_t id = stored_frame_shown;
+
+    if (strcmp(req->uri, "/frame.png") == 0)
+    {
+        format = FRAME_IMAGE_PNG;
+    }
+    else if (strcmp(req->uri, "/frame.bmp") == 0)
+    {
+        format = FRAME_IMAGE_BMP;
+    }
+    else
+    {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown format");
+        return ESP_FAIL;
+    }
+
+    // Not released nor overwritten while it is sent
+    if (!take_framebuffer(req))
+    {
+        return ESP_FAIL;
+    }
+
+    if ((id >= 0) || !display_manager_framebuffer_resident())
+    {
+        if (!((id >= 0) ? frame_store_get(id, &shown) : frame_store_latest(&shown)))
+        {
+            display_manager_give_framebuffer();
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No frame");
+            return ESP_FAIL;
+        }
+        entry = &shown;
+    }
+
+    esp_err_t ret = send_frame_image(req, format, entry);
+    display_manager_give_framebuffer();
+
+    return ret;
+}
+
+// HTTP GET handler for the metrics of past updates, as text lines
+static esp_err_t metrics_get_handler(httpd_req_t *req)
+{
+    static char text[768];
+
+    httpd_resp_set_type(req, "text/plain");
+    httpd_resp_send(req, text, metrics_format(text, sizeof(text)));
 
     return ESP_OK;
 }
 
+// HTTP GET handler for the trace rings, decoded with host/trace_decode
+static esp_err_t trace_get_handler(httpd_req_t *req)
+{
+    static trace_record_t records[IMAGE_CHUNK_SIZE / sizeof(trace_record_t)];
+    trace_dump_header_t header;
+
+    trace_dump_header(&header);
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    if (httpd_resp_send_chunk(req, (const char*) &header, sizeof(header)) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+
+    // Copied in batches, one send per TCP segment
+    for (uint8_t core = 0; core < TRACE_CORES; core++)
+    {
+        for (uint16_t i = 0; i < header.counts[core];)
+        {
+            uint16_t count = 0;
+            for (; (count < sizeof(records) / sizeof(records[0])) && (i < header.counts[core]); count++, i++)
+            {
+                records[count] = *trace_get(core, i);
+            }
+
+            if (httpd_resp_send_chunk(req, (const char*) records, count * sizeof(trace_record_t)) != ESP_OK)
+            {
+                return ESP_FAIL;
+            }
+        }
+    }
+
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// Budget checks of a RAM report, the framebuffer has to fit when it is not allocated
+static uint32_t memory_check(const mem_report_t* report)
+{
+    return mem_report_check(report, display_manager_framebuffer_resident() ? 0 : FRAMEBUFFER_SIZE);
+}
+
+// HTTP GET handler for the RAM report, as text lines
+static esp_err_t memory_get_handler(httpd_req_t *req)
+{
+    static mem_report_t report;
+    static char text[1024];
+
+    mem_report_collect(&report);
+
+    httpd_resp_set_type(req, "text/plain");
+    httpd_resp_send(req, text, mem_report_format(&report, memory_check(&report), text, sizeof(text)));
+
+    return ESP_OK;
+}
+
+// HTTP POST handler to show a stored frame, played back from flash by the main loop
+static esp_err_t stored_frame_post_handler(httpd_req_t *req)
+{
+    frame_store_entry_t entry;
+    unsigned id;
+    char tail[8];
+
+    if ((sscanf(req->uri, "/frames/%u/%7s", &id, tail) != 2) || (strcmp(tail, "show") != 0)
+        || (id > UINT8_MAX) || !frame_store_get(id, &entry))
+    {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such frame");
+        return ESP_FAIL;
+    }
+
+    stored_frame_requested = id;
+    httpd_resp_send_chunk(req, NULL, 0);
+
+    return ESP_OK;
+}
+
+// HTTP GET handler for the status of an update job, /jobs/<id>
+// With ?after=<state>, it waits up to UPDATE_JOB_POLL_MS for the job to leave this state,
+// the request is handed over to job_poll_task and the web server goes on with others
+// With &sleep=1, the frame goes to deep sleep once it sent a final state
+static esp_err_t job_get_handler(httpd_req_t *req)
+{
+    update_job_state_t after = UPDATE_JOB_STATE_COUNT;
+    update_job_state_t state;
+    unsigned long id;
+    bool sleep = false;
+    char query[48];
+    char value[16];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+    {
+        if (httpd_query_key_value(query, "after", value, sizeof(value)) == ESP_OK)
+        {
+            after = update_job_state_from_name(value);
+        }
+        sleep = (httpd_query_key_value(query, "sleep", value, sizeof(value)) == ESP_OK) && (strcmp(value, "1") == 0);
+    }
+
+    if ((sscanf(req->uri, "/jobs/%lu", &id) != 1) || !update_job_get_state(id, &state))
+    {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such job");
+        return ESP_FAIL;
+    }
+
+    httpd_req_t* poll = NULL;
+    if ((state != after) || (httpd_req_async_handler_begin(req, &poll) != ESP_OK))
+    {
+        return send_job_status(req, id, sleep);
+    }
+
+    bool held = false;
+    taskENTER_CRITICAL(&job_polls_lock);
+    for (uint8_t i = 0; (i < JOB_POLL_MAX) && !held; i++)
+    {
+        if (job_polls[i].req == NULL)
+        {
+            job_polls[i] = (job_poll_t) {
+                .req        = poll,
+                .id         = id,
+                .after      = after,
+                .sleep      = sleep,
+                .deadline   = xTaskGetTickCount() + pdMS_TO_TICKS(UPDATE_JOB_POLL_MS),
+            };
+            held = true;
+        }
+    }
+    taskEXIT_CRITICAL(&job_polls_lock);
+
+    if (held)
+    {
+        xTaskNotifyGive(job_poll_handle);
+    }
+    else
+    {
+        // Every slot is taken, the client asks again
+        send_job_status(poll, id, sleep);
+        httpd_req_async_handler_complete(poll);
+    }
+
+    return ESP_OK;
+}
+
+// Answer a status request with the state of its job, with sleep the frame goes to deep sleep once it is final
+static esp_err_t send_job_status(httpd_req_t *req, uint32_t id, bool sleep)
+{
+    update_job_state_t state;
+    char json[192];
+
+    if (!update_job_get_state(id, &state) || (update_job_format(id, json, sizeof(json)) == 0))
+    {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such job");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    esp_err_t ret = httpd_resp_sendstr(req, json);
+
+    // Nothing left to wait for
+    if (sleep && (ret == ESP_OK) && ((state == UPDATE_JOB_REFRESHED) || (state == UPDATE_JOB_FAILED)))
+    {
+        sleep_requested = true;
+    }
+
+    return ret;
+}
+
+// Answer the status requests held for a job once it leaves their state or their wait ends
+// Woken by the web server when it hands one over, and by update_job each time a job advances
+static void job_poll_task(void* param)
+{
+    update_job_set_listener(xTaskGetCurrentTaskHandle());
+
+    while (1)
+    {
+        TickType_t now  = xTaskGetTickCount();
+        TickType_t wait = portMAX_DELAY;
+
+        for (uint8_t i = 0; i < JOB_POLL_MAX; i++)
+        {
+            update_job_state_t state;
+
+            // Only this task frees a slot, the copy stays valid
+            taskENTER_CRITICAL(&job_polls_lock);
+            job_poll_t poll = job_polls[i];
+            taskEXIT_CRITICAL(&job_polls_lock);
+
+            if (poll.req == NULL)
+            {
+                continue;
+            }
+
+            int32_t left = (int32_t) (poll.deadline - now);
+            if (update_job_get_state(poll.id, &state) && (state == poll.after) && (left > 0))
+            {
+                wait = MIN(wait, (TickType_t) left);
+                continue;
+            }
+
+            send_job_status(poll.req, poll.id, poll.sleep);
+            httpd_req_async_handler_complete(poll.req);
+
+            taskENTER_CRITICAL(&job_polls_lock);
+            job_polls[i].req = NULL;
+            taskEXIT_CRITICAL(&job_polls_lock);
+        }
+
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
 // Start the web server
 static httpd_handle_t start_webserver(void)
 {
@@ -201,23 +1173,137 @@ static httpd_handle_t start_webserver(void)
     config.max_open_sockets = 13;
     config.lru_purge_enable = true;
     config.uri_match_fn     = httpd_uri_match_wildcard;
+    config.stack_size       = 6144;     // Room for the JPEG decoder
+    config.max_uri_handlers = 12;       // Default is 8
 
     // Start the httpd server
     ESP_LOGI(TAG, "Starting server on port: '%d'", config.server_port);
     if (httpd_start(&server, &config) == ESP_OK)
     {
         ESP_LOGI(TAG, "Registering URI handlers");
-        // Set URI handlers
+        // Set URI handlers, the catch-all GET goes last
+        httpd_register_uri_handler(server, &frames_get_uri);
+        httpd_register_uri_handler(server, &stored_frame_get_uri);
+        httpd_register_uri_handler(server, &frame_get_uri);
+        httpd_register_uri_handler(server, &metrics_get_uri);
+        httpd_register_uri_handler(server, &trace_get_uri);
+        httpd_register_uri_handler(server, &memory_get_uri);
+        httpd_register_uri_handler(server, &job_get_uri);
         httpd_register_uri_handler(server, &common_get_uri);
         httpd_register_uri_handler(server, &buffer_post_uri);
+        httpd_register_uri_handler(server, &jpeg_post_uri);
+        httpd_register_uri_handler(server, &stored_frame_post_uri);
     }
     return server;
 }
 
+// Bring up what the portal needs besides WiFi, in parallel with the WiFi start
+static void services_task(void* param)
+{
+    // The handlers read the store, it is mounted before the server takes requests
+    if (!frame_store_init())
+    {
+        ESP_LOGW(TAG, "Frames will not be saved");
+    }
+
+    // Status requests waiting for their job are held by a task of their own
+    xTaskCreatePinnedToCore(job_poll_task, "job_poll", 3072, NULL, 5, &job_poll_handle, 1);
+
+    // Start the server for the first time
+    start_webserver();
+
+    // Start the DNS server that will redirect all queries to the softAP IP
+    start_dns_server();
+
+    boot_mark(BOOT_SERVICES);
+
+    // Everything but the framebuffer is up, check the RAM budget once
+    static mem_report_t report;
+    mem_report_collect(&report);
+    if (memory_check(&report) != 0)
+    {
+        ESP_LOGW(TAG, "RAM budget exceeded, see GET /memory");
+    }
+    vTaskDelete(NULL);
+}
+
+// Initialize NVS needed by Wi-Fi, it holds the RF calibration data so only a partial calibration runs
+static void init_nvs(void)
+{
+    esp_err_t err = nvs_flash_init();
+    if ((err == ESP_ERR_NVS_NO_FREE_PAGES) || (err == ESP_ERR_NVS_NEW_VERSION_FOUND))
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(err);
+    boot_mark(BOOT_NVS);
+}
+
+// Save the frame received in the framebuffer and show it, job 0 if it does not come from an upload
+// Called with the framebuffer taken, it is given back once sent to the display
+static void show_received_frame(uint32_t job)
+{
+    // Save it to the frame store
+    metrics_begin(METRIC_SAVE);
+    bool saved = display_manager_save_framebuffer();
+    if (saved)
+    {
+        metrics_end(METRIC_SAVE);
+        update_job_advance(job, UPDATE_JOB_STORED);
+        ESP_LOGI(TAG, "Framebuffer saved");
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Failed to store framebuffer");
+    }
+
+    // Show it on the display
+    if (display_manager_show(job))
+    {
+        metrics_update_done();
+        update_job_advance(job, UPDATE_JOB_REFRESHED);
+    }
+    else
+    {
+        update_job_advance(job, UPDATE_JOB_FAILED);
+        ESP_LOGE(TAG, "Failed to set display");
+    }
+
+    // Kept in flash, /frame.png reads it from there
+    if (saved)
+    {
+        release_framebuffer();
+    }
+}
+
+#if STATION_UPDATE_ENABLED
+// Woken by the timer: pull a new frame as a station and sleep again, the portal stays off
+static void station_check(void)
+{
+    // Its newest frame gives the ETag
+    if (!frame_store_init())
+    {
+        ESP_LOGW(TAG, "Frames will not be saved");
+    }
+
+    // The radio is already off when the frame is shown
+    if ((station_update_run() == STATION_UPDATE_NEW_FRAME) && display_manager_take_framebuffer(portMAX_DELAY))
+    {
+        show_received_frame(0);
+    }
+
+    goto_power_saving();
+}
+#endif
+
 static void goto_power_saving(void)
 {
+    metrics_begin(METRIC_SLEEP);
+
     // Display to lowest power consumption
     display_manager_power_saving();
+    release_framebuffer();
 
     // Enable deep sleep for all RTC power domains
     /*for (uint8_t domain = 0; domain < ESP_PD_DOMAIN_MAX; domain++)
@@ -227,17 +1313,42 @@ static void goto_power_saving(void)
 
     ESP_LOGI(TAG, "Going to deep sleep");
 
-    // Power-off wifi
-    ESP_ERROR_CHECK(esp_wifi_stop());
+    // Power-off wifi, unless it was never started
+    if (softap_started)
+    {
+        ESP_ERROR_CHECK(esp_wifi_stop());
+        metrics_radio(false);
+    }
 
     vTaskDelay(1);
 
-    // Force deep sleep now. No wakeup configured -> wakeup with reset
+    // Wake up with the button, it pulls the pin low. Or with reset
+    rtc_gpio_pullup_en(PIN_WAKE_BUTTON);
+    rtc_gpio_pulldown_dis(PIN_WAKE_BUTTON);
+    ESP_ERROR_CHECK(esp_sleep_enable_ext0_wakeup(PIN_WAKE_BUTTON, 0));
+
+#if STATION_UPDATE_ENABLED
+    // And with the timer, for the next check
+    ESP_ERROR_CHECK(esp_sleep_enable_timer_wakeup((uint64_t) STATION_INTERVAL_S * 1000000U));
+#endif
+
+    // Radio is off, account this wake up
+    metrics_end(METRIC_SLEEP);
+    metrics_sleep();
+
     esp_deep_sleep_start();
 }
 
 void app_main(void)
 {
+    boot_mark(BOOT_APP_MAIN);
+    metrics_boot();
+
+    for (uint8_t i = 0; i < sizeof(app_log_tags) / sizeof(app_log_tags[0]); i++)
+    {
+        esp_log_level_set(app_log_tags[i], ESP_LOG_INFO);
+    }
+
     /*
         Turn of warnings from HTTP server as redirecting traffic will yield
         lots of invalid requests
@@ -246,6 +1357,7 @@ void app_main(void)
     esp_log_level_set("httpd_txrx", ESP_LOG_ERROR);
     esp_log_level_set("httpd_parse", ESP_LOG_ERROR);
 
+    ESP_LOGI(TAG, "Wakeup cause %d", esp_sleep_get_wakeup_cause());
 
     // Initialize networking stack
     ESP_ERROR_CHECK(esp_netif_init());
@@ -253,26 +1365,27 @@ void app_main(void)
     // Create default event loop needed by the  main app
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
-    // Initialize NVS needed by Wi-Fi
-    ESP_ERROR_CHECK(nvs_flash_init());
+#if STATION_UPDATE_ENABLED
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER)
+    {
+        init_nvs();
+        station_check();
+    }
+#endif
 
-    // Initialize Wi-Fi including netif with default config
+    // Initialize Wi-Fi netif with default config, the DNS server reads its address
     esp_netif_create_default_wifi_ap();
 
+    // Web server, DNS server and frame store come up on the other core
+    xTaskCreatePinnedToCore(services_task, "services", 4096, NULL, 5, NULL, 1);
+
+    init_nvs();
+
     // Initialise ESP32 in SoftAP mode
     wifi_init_softap();
+    boot_mark(BOOT_WIFI_START);
 
-    // Start the server for the first time
-    start_webserver();
-
-    // Start the DNS server that will redirect all queries to the softAP IP
-    start_dns_server();
-
-    // Just initialize the display driver
-    if (!display_manager_init())
-    {
-        ESP_LOGE(TAG, "Failed to initialize display");
-    }
+    // The display is initialized when a frame is shown, or before sleeping
 
     uint32_t timeout_in_ticks = 120*configTICK_RATE_HZ;  // One minute in terms of ticks
     timeout_start = xTaskGetTickCount();
@@ -281,33 +1394,38 @@ void app_main(void)
 
     while (1)
     {
-        // We received a buffer
-        if (image_received)
+        // We received a buffer, unless an upload is still writing it
+        uint32_t job = take_received_frame();
+        if (job != 0)
+        {
+            stored_frame_shown = -1;
+            show_received_frame(job);
+
+            // Send the device and the display to deep sleep
+            //goto_power_saving();
+        }
+
+        // Play back a stored frame, straight from flash
+        if (stored_frame_requested >= 0)
         {
-            // Save it to NVS
-            if(display_manager_save_framebuffer())
+            uint8_t id = stored_frame_requested;
+            stored_frame_requested = -1;
+
+            // Its rotation comes from the store, the framebuffer is not needed anymore
+            release_framebuffer();
+            if (display_manager_show_stored(id))
             {
-                ESP_LOGI(TAG, "Framebuffer saved");
+                stored_frame_shown = id;
+                metrics_update_done();
             }
             else
             {
-                ESP_LOGW(TAG, "Failed to store framebuffer");
+                ESP_LOGE(TAG, "Failed to show stored frame %u", id);
             }
-
-            // Show it on the display
-            if (!display_manager_show())
-            {
-                ESP_LOGE(TAG, "Failed to set display");
-            }
-
-            image_received = false;
-
-            // Send the device and the display to deep sleep
-            //goto_power_saving();
         }
 
-        // Timeout expired
-        if ((xTaskGetTickCount() - timeout_start) >= timeout_in_ticks)
+        // Timeout expired, or the client is done
+        if (sleep_requested || ((xTaskGetTickCount() - timeout_start) >= timeout_in_ticks))
         {
             goto_power_saving();
         }
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "mem_report.h"
+
+static const uint32_t heap_caps[MEM_HEAP_COUNT] = {
+    [MEM_HEAP_INTERNAL] = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+    [MEM_HEAP_DMA]      = MALLOC_CAP_DMA,
+    [MEM_HEAP_32BIT]    = MALLOC_CAP_32BIT,
+    [MEM_HEAP_SPIRAM]   = MALLOC_CAP_SPIRAM,
+};
+
+static const char* const heap_names[MEM_HEAP_COUNT] = {
+    [MEM_HEAP_INTERNAL] = "internal",
+    [MEM_HEAP_DMA]      = "dma",
+    [MEM_HEAP_32BIT]    = "32bit",
+    [MEM_HEAP_SPIRAM]   = "spiram",
+};
+
+static const char* const warning_names[] = {
+    "low_internal",
+    "low_stack",
+    "low_block",
+    "tasks_unknown",
+};
+
+void mem_report_collect(mem_report_t* report)
+{
+    static TaskStatus_t status[MEM_REPORT_MAX_TASKS];
+
+    memset(report, 0, sizeof(*report));
+
+    for (uint8_t i = 0; i < MEM_HEAP_COUNT; i++)
+    {
+        multi_heap_info_t info;
+        heap_caps_get_info(&info, heap_caps[i]);
+
+        report->heaps[i].total      = heap_caps_get_total_size(heap_caps[i]);
+        report->heaps[i].free       = info.total_free_bytes;
+        report->heaps[i].min_free   = info.minimum_free_bytes;
+        report->heaps[i].largest    = info.largest_free_block;
+    }
+
+    // Zero when the array is too small
+    UBaseType_t count = uxTaskGetSystemState(status, MEM_REPORT_MAX_TASKS, NULL);
+    report->tasks_unknown = (count == 0);
+
+    // Insertion sort, least stack left first
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        uint8_t pos = report->task_count++;
+        while ((pos > 0) && (report->tasks[pos - 1].stack_free > status[i].usStackHighWaterMark))
+        {
+            report->tasks[pos] = report->tasks[pos - 1];
+            pos--;
+        }
+
+        strncpy(report->tasks[pos].name, status[i].pcTaskName, MEM_REPORT_NAME_LEN - 1);
+        report->tasks[pos].name[MEM_REPORT_NAME_LEN - 1] = '\0';
+        report->tasks[pos].stack_free = status[i].usStackHighWaterMark;
+    }
+}
+
+uint32_t mem_report_check(const mem_report_t* report, uint32_t block)
+{
+    const mem_report_heap_t* internal = &report->heaps[MEM_HEAP_INTERNAL];
+    uint32_t warnings = 0;
+
+    if (internal->min_free < MEM_REPORT_MIN_INTERNAL)
+    {
+        warnings |= MEM_LOW_INTERNAL;
+    }
+
+    // Sorted, the first task has the least stack left
+    if ((report->task_count > 0) && (report->tasks[0].stack_free < MEM_REPORT_MIN_STACK))
+    {
+        warnings |= MEM_LOW_STACK;
+    }
+
+    if (report->tasks_unknown)
+    {
+        warnings |= MEM_TASKS_UNKNOWN;
+    }
+
+    // The framebuffer goes to PSRAM first, else to DMA capable RAM
+    if ((block > 0)
+        && (report->heaps[MEM_HEAP_SPIRAM].largest < block)
+        && (report->heaps[MEM_HEAP_DMA].largest < block))
+    {
+        warnings |= MEM_LOW_BLOCK;
+    }
+
+    return warnings;
+}
+
+size_t mem_report_format(const mem_report_t* report, uint32_t warnings, char* buff, size_t len)
+{
+    size_t pos = 0;
+
+    pos += snprintf(buff + pos, len - pos, "# heap total free min_free largest\n");
+    for (uint8_t i = 0; (i < MEM_HEAP_COUNT) && (pos < len); i++)
+    {
+        const mem_report_heap_t* heap = &report->heaps[i];
+        pos += snprintf(buff + pos, len - pos, "%s %lu %lu %lu %lu\n", heap_names[i],
+                        (unsigned long) heap->total, (unsigned long) heap->free,
+                        (unsigned long) heap->min_free, (unsigned long) heap->largest);
+    }
+
+    if (pos < len)
+    {
+        pos += snprintf(buff + pos, len - pos, "# task stack_free\n");
+    }
+    for (uint8_t i = 0; (i < report->task_count) && (pos < len); i++)
+    {
+        pos += snprintf(buff + pos, len - pos, "%s %lu\n", report->tasks[i].name,
+                        (unsigned long) report->tasks[i].stack_free);
+    }
+
+    if (pos < len)
+    {
+        pos += snprintf(buff + pos, len - pos, "warnings");
+    }
+    for (uint8_t i = 0; (i < sizeof(warning_names) / sizeof(warning_names[0])) && (pos < len); i++)
+    {
+        if (warnings & (1U << i))
+        {
+            pos += snprintf(buff + pos, len - pos, " %s", warning_names[i]);
+        }
+    }
+    if (pos < len)
+    {
+        pos += snprintf(buff + pos, len - pos, (warnings == 0) ? " none\n" : "\n");
+    }
+
+    return (pos < len) ? pos : len - 1;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MEM_REPORT_MAX_TASKS        24U
+#define MEM_REPORT_NAME_LEN         16U
+
+// Budget checked by mem_report_check
+#define MEM_REPORT_MIN_INTERNAL     16384U      // Free internal RAM left to WiFi and lwIP buffers
+#define MEM_REPORT_MIN_STACK        512U        // Unused stack of each task
+
+// Heaps reported, by capability
+typedef enum
+{
+    MEM_HEAP_INTERNAL = 0,      // Internal 8-bit capable RAM
+    MEM_HEAP_DMA,               // Internal RAM the DMA can read
+    MEM_HEAP_32BIT,             // Includes IRAM, only for 32-bit accesses
+    MEM_HEAP_SPIRAM,            // PSRAM, empty when there is none
+    MEM_HEAP_COUNT,
+} mem_heap_t;
+
+// Failed checks of mem_report_check
+typedef enum
+{
+    MEM_LOW_INTERNAL    = 1 << 0,   // Less than MEM_REPORT_MIN_INTERNAL free, now or since boot
+    MEM_LOW_STACK       = 1 << 1,   // A task used its stack up to MEM_REPORT_MIN_STACK from the end
+    MEM_LOW_BLOCK       = 1 << 2,   // No free block for the allocation asked for
+    MEM_TASKS_UNKNOWN   = 1 << 3,   // More tasks than MEM_REPORT_MAX_TASKS, stacks not reported
+} mem_warning_t;
+
+typedef struct
+{
+    uint32_t    total;
+    uint32_t    free;
+    uint32_t    min_free;       // Low-water mark since boot
+    uint32_t    largest;        // Largest free block
+} mem_report_heap_t;
+
+typedef struct
+{
+    char        name[MEM_REPORT_NAME_LEN];
+    uint32_t    stack_free;     // Stack never used since the task started, in bytes
+} mem_report_task_t;
+
+typedef struct
+{
+    mem_report_heap_t   heaps[MEM_HEAP_COUNT];
+    mem_report_task_t   tasks[MEM_REPORT_MAX_TASKS];    // Least stack left first
+    uint8_t             task_count;
+    bool                tasks_unknown;
+} mem_report_t;
+
+// Take a report of the heaps and task stacks
+void     mem_report_collect(mem_report_t* report);
+
+// Check a report against the budget, block is the size of an allocation to come, 0 if none
+// Return the mem_warning_t flags of the failed checks
+uint32_t mem_report_check(const mem_report_t* report, uint32_t block);
+
+// Write a report and its warnings as text lines, return the length written
+size_t   mem_report_format(const mem_report_t* report, uint32_t warnings, char* buff, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
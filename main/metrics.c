@@ -0,0 +1,150 @@
+#include <stdio.h>
+
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+#include "display_config.h"
+#include "metrics.h"
+#include "trace.h"
+
+// Typical ESP32 currents at 160 MHz, from the datasheet, and the panel while refreshing
+#define CURRENT_RADIO_MA        110U        // CPU awake, radio on as softAP
+#define CURRENT_CPU_MA          40U         // CPU awake, radio off
+#define CURRENT_PANEL_MA        PANEL_REFRESH_MA    // E-Paper refresh, on top of the CPU
+
+// mA.us in a uAh
+#define MA_US_PER_UAH           3600000ULL
+
+typedef struct
+{
+    uint32_t    count;
+    uint32_t    last_us;
+    uint32_t    max_us;
+    uint64_t    total_us;
+} metrics_span_t;
+
+// Kept in RTC slow memory: cleared at power on, kept across deep sleep
+typedef struct
+{
+    metrics_span_t  spans[METRIC_PHASE_COUNT];
+    uint32_t        wakes;
+    uint32_t        updates;
+    uint64_t        awake_us;
+    uint64_t        radio_us;
+} metrics_history_t;
+
+static RTC_DATA_ATTR metrics_history_t history;
+
+static const char* const phase_names[METRIC_PHASE_COUNT] = {
+    [METRIC_CONNECT]    = "connect",
+    [METRIC_FIRST_GET]  = "first_get",
+    [METRIC_UPLOAD]     = "upload",
+    [METRIC_SAVE]       = "save",
+    [METRIC_CONFIGURE]  = "configure",
+    [METRIC_TRANSFER]   = "transfer",
+    [METRIC_REFRESH]    = "refresh",
+    [METRIC_SLEEP]      = "sleep",
+    [METRIC_JOIN]       = "join",
+    [METRIC_PULL]       = "pull",
+};
+
+// Start of running phases, 0 when not running
+static int64_t phase_start[METRIC_PHASE_COUNT];
+static int64_t radio_start = 0;
+
+void metrics_boot(void)
+{
+    history.wakes++;
+}
+
+void metrics_begin(metrics_phase_t phase)
+{
+    phase_start[phase] = esp_timer_get_time();
+    TRACE(TRACE_PHASE_BEGIN, phase, 0);
+}
+
+void metrics_end(metrics_phase_t phase)
+{
+    if (phase_start[phase] == 0)
+    {
+        return;
+    }
+
+    metrics_span_t* span = &history.spans[phase];
+    uint32_t elapsed     = esp_timer_get_time() - phase_start[phase];
+    phase_start[phase]   = 0;
+    TRACE(TRACE_PHASE_END, phase, elapsed);
+
+    span->count++;
+    span->last_us   = elapsed;
+    span->total_us += elapsed;
+    if (elapsed > span->max_us)
+    {
+        span->max_us = elapsed;
+    }
+}
+
+void metrics_radio(bool on)
+{
+    int64_t now = esp_timer_get_time();
+
+    if (on && (radio_start == 0))
+    {
+        radio_start = now;
+    }
+    else if (!on && (radio_start != 0))
+    {
+        history.radio_us += now - radio_start;
+        radio_start = 0;
+    }
+}
+
+void metrics_update_done(void)
+{
+    history.updates++;
+}
+
+void metrics_sleep(void)
+{
+    metrics_radio(false);
+
+    // esp_timer starts at boot
+    history.awake_us += esp_timer_get_time();
+}
+
+size_t metrics_format(char* buff, size_t len)
+{
+    size_t pos = 0;
+
+    // Time awake so far includes this wake up
+    uint64_t awake_us = history.awake_us + esp_timer_get_time();
+    uint64_t radio_us = history.radio_us + ((radio_start != 0) ? esp_timer_get_time() - radio_start : 0);
+
+    uint64_t charge = radio_us * CURRENT_RADIO_MA
+                    + (awake_us - radio_us) * CURRENT_CPU_MA
+                    + history.spans[METRIC_REFRESH].total_us * CURRENT_PANEL_MA;
+    uint64_t uah    = charge / MA_US_PER_UAH;
+
+    pos += snprintf(buff + pos, len - pos, "# phase count last_ms avg_ms max_ms\n");
+    for (uint8_t i = 0; (i < METRIC_PHASE_COUNT) && (pos < len); i++)
+    {
+        const metrics_span_t* span = &history.spans[i];
+        pos += snprintf(buff + pos, len - pos, "%s %lu %lu %lu %lu\n", phase_names[i],
+                        (unsigned long) span->count,
+                        (unsigned long) (span->last_us / 1000),
+                        (unsigned long) (span->count ? span->total_us / span->count / 1000 : 0),
+                        (unsigned long) (span->max_us / 1000));
+    }
+
+    if (pos < len)
+    {
+        pos += snprintf(buff + pos, len - pos,
+                        "wakes %lu\nupdates %lu\nawake_ms %llu\nradio_ms %llu\nuah_total %llu\nuah_per_update %llu\n",
+                        (unsigned long) history.wakes, (unsigned long) history.updates,
+                        (unsigned long long) (awake_us / 1000), (unsigned long long) (radio_us / 1000),
+                        (unsigned long long) uah,
+                        (unsigned long long) (history.updates ? uah / history.updates : 0));
+    }
+
+    return (pos < len) ? pos : len - 1;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Timed phases of an update
+typedef enum
+{
+    METRIC_CONNECT = 0,     // SSID broadcast to client connected
+    METRIC_FIRST_GET,       // Client connected to first page served
+    METRIC_UPLOAD,          // Upload request received and decoded
+    METRIC_SAVE,            // Frame saved to flash
+    METRIC_CONFIGURE,       // display_configure
+    METRIC_TRANSFER,        // display_transfer
+    METRIC_REFRESH,         // display_refresh, mostly waiting for BUSY
+    METRIC_SLEEP,           // Display and radio off, up to deep sleep
+    METRIC_JOIN,            // Station mode: radio on to IP address
+    METRIC_PULL,            // Station mode: request sent to frame received or 304
+    METRIC_PHASE_COUNT,
+} metrics_phase_t;
+
+// Count a wake up, call once at boot
+void    metrics_boot(void);
+
+// Start and stop timing a phase
+void    metrics_begin(metrics_phase_t phase);
+void    metrics_end(metrics_phase_t phase);
+
+// Tell the radio is on or off, its time is accounted for the energy estimate
+void    metrics_radio(bool on);
+
+// Count a frame shown on the display
+void    metrics_update_done(void);
+
+// Account the time awake, right before deep sleep
+void    metrics_sleep(void);
+
+// Write the metrics as text lines, return the length written
+size_t  metrics_format(char* buff, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+// 7.5" black/white/red panel, 800x480, GD7965 controller: Good Display GDEW075Z08, Waveshare 7.5" (B) V2
+// Panel descriptor, picked with PANEL_DESCRIPTOR, see display_config.h
+// Plain decimal and string values are also given to the web page, see webpage/panel_js.cmake
+
+#define PANEL_NAME                  "gd7965_750_kwr"
+
+// Geometry, in pixels of the panel in its native orientation
+#define PANEL_WIDTH                 800U
+#define PANEL_HEIGHT                480U
+
+// White/black plane then red/none plane, 1 bit per pixel each
+#define PANEL_PLANES                2U
+#define PANEL_BITS_PER_PIXEL        1U
+
+// Controller, its command set is driven by display_driver.c
+#define PANEL_CONTROLLER_GD7965     1
+#define PANEL_REVISION              0x0CU           // Last byte read from REV
+
+// Border LDO disabled, VD and VG generated from DC/DC
+// OTP power from VPP pin, slow slew rate, VGH=20V, VGL=-20V, VDH=15V, VDL=-15V
+#define PANEL_PWR                   0x07, 0x07, 0x3F, 0x3F
+// Border output high-Z disabled, border LUT new data to old data copy disabled, LUT
+// VCOM and data interval 10 hsync
+#define PANEL_CDI                   0x11, 0x07
+// Non-overlap periods 12
+#define PANEL_TCON                  0x22
+// LUT from OTP, KWR mode, scan up, shift right, booster on
+#define PANEL_PSR_KWR               0x0FU
+// LUT from registers, KW mode, scan up, shift right, booster on
+#define PANEL_PSR_KW                0x3FU
+
+// KW waveform phase length in frames, by panel temperature, particles move slower in the cold
+#define PANEL_KW_COLD_MAX_C         10
+#define PANEL_KW_COLD_FRAMES        0x20U
+#define PANEL_KW_NORMAL_MAX_C       30
+#define PANEL_KW_NORMAL_FRAMES      0x10U
+#define PANEL_KW_WARM_FRAMES        0x0AU
+
+// Wiring of the panel to the ESP32
+#define PANEL_PIN_SPI_DATA          14U
+#define PANEL_PIN_SPI_CLOCK         13U
+#define PANEL_PIN_CS                15U
+#define PANEL_PIN_DC                27U
+#define PANEL_PIN_RST               26U
+#define PANEL_PIN_BUSY              25U
+
+// Timings
+#define PANEL_SPI_CLOCK_HZ          1000000
+#define PANEL_RESET_PULSE_US        2000U           // RST low pulse width
+#define PANEL_BUSY_SETTLE_US        200U            // Time for BUSY to go low after a command
+#define PANEL_BUSY_TIMEOUT_MS       30000U          // Longest operation is a full KWR refresh
+
+// Current drawn while refreshing, on top of the CPU, for the energy estimate of metrics.c
+#define PANEL_REFRESH_MA            8U
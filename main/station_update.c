@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "esp_attr.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "esp_http_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+#include "frame_store.h"
+#include "frame_upload.h"
+#include "metrics.h"
+#include "station_update.h"
+
+#define STATION_GOT_IP_BIT      BIT0
+#define STATION_FAILED_BIT      BIT1
+
+// Body is received by chunks of this size
+#define STATION_CHUNK_SIZE      1024U
+
+// Access point and lease of the last successful check, kept in RTC slow memory across deep sleep
+typedef struct
+{
+    bool                    valid;
+    uint8_t                 uses;       // Checks done on this lease
+    uint8_t                 channel;
+    uint8_t                 bssid[6];
+    esp_netif_ip_info_t     ip_info;
+    esp_netif_dns_info_t    dns;
+} station_cache_t;
+
+static RTC_DATA_ATTR station_cache_t cache;
+
+static const char*          TAG     = "station_update";
+static EventGroupHandle_t   events  = NULL;
+static esp_netif_t*         netif   = NULL;
+
+static void station_event_handler(void* arg, esp_event_base_t base, int32_t id, void* data)
+{
+    if ((base == WIFI_EVENT) && (id == WIFI_EVENT_STA_DISCONNECTED))
+    {
+        xEventGroupSetBits(events, STATION_FAILED_BIT);
+    }
+    else if ((base == IP_EVENT) && (id == IP_EVENT_STA_GOT_IP))
+    {
+        xEventGroupSetBits(events, STATION_GOT_IP_BIT);
+    }
+}
+
+// Join the access point, the cached one with the cached lease, or after a scan and DHCP
+// The bits stay set: neither one when the join timed out and is still going on
+static bool station_join(bool cached)
+{
+    wifi_config_t config = {
+        .sta = {
+            .ssid           = STATION_SSID,
+            .password       = STATION_PASSWORD,
+            .scan_method    = WIFI_FAST_SCAN,
+        },
+    };
+
+    if (cached)
+    {
+        config.sta.bssid_set = true;
+        config.sta.channel   = cache.channel;
+        memcpy(config.sta.bssid, cache.bssid, sizeof(cache.bssid));
+
+        // Static address: the netif reports it as soon as the link is up
+        esp_netif_dhcpc_stop(netif);
+        esp_netif_set_ip_info(netif, &cache.ip_info);
+        esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &cache.dns);
+    }
+    else
+    {
+        esp_netif_dhcpc_start(netif);
+    }
+
+    xEventGroupClearBits(events, STATION_GOT_IP_BIT | STATION_FAILED_BIT);
+    if ((esp_wifi_set_config(WIFI_IF_STA, &config) != ESP_OK) || (esp_wifi_connect() != ESP_OK))
+    {
+        return false;
+    }
+
+    EventBits_t bits = xEventGroupWaitBits(events, STATION_GOT_IP_BIT | STATION_FAILED_BIT, pdFALSE, pdFALSE,
+                                           pdMS_TO_TICKS(STATION_JOIN_TIMEOUT_MS));
+    return (bits & STATION_GOT_IP_BIT) != 0;
+}
+
+// Give up a join that timed out. Its disconnection is posted later on, it is waited for so that
+// it does not end the next join
+static void station_leave(void)
+{
+    if ((xEventGroupGetBits(events) & STATION_FAILED_BIT) || (esp_wifi_disconnect() != ESP_OK))
+    {
+        return;
+    }
+
+    if (!(xEventGroupWaitBits(events, STATION_FAILED_BIT, pdFALSE, pdFALSE,
+                              pdMS_TO_TICKS(STATION_LEAVE_TIMEOUT_MS)) & STATION_FAILED_BIT))
+    {
+        ESP_LOGW(TAG, "No disconnection after giving up the join");
+    }
+}
+
+// Keep what the next check needs to join without scan nor DHCP
+static void station_save_cache(void)
+{
+    wifi_ap_record_t ap;
+
+    if ((esp_wifi_sta_get_ap_info(&ap) != ESP_OK)
+        || (esp_netif_get_ip_info(netif, &cache.ip_info) != ESP_OK)
+        || (esp_netif_get_dns_info(netif, ESP_NETIF_DNS_MAIN, &cache.dns) != ESP_OK))
+    {
+        cache.valid = false;
+        return;
+    }
+
+    memcpy(cache.bssid, ap.bssid, sizeof(cache.bssid));
+    cache.channel = ap.primary;
+    cache.uses    = 0;
+    cache.valid   = true;
+}
+
+static bool station_read_exact(esp_http_client_handle_t client, uint8_t* buff, uint32_t len)
+{
+    while (len > 0)
+    {
+        int read = esp_http_client_read(client, (char*) buff, len);
+        if (read <= 0)
+        {
+            return false;
+        }
+        buff += read;
+        len  -= read;
+    }
+
+    return true;
+}
+
+// Conditional GET of the frame, streamed into the framebuffer like an upload
+static station_update_result_t station_fetch(void)
+{
+    static uint8_t chunk[STATION_CHUNK_SIZE];
+    station_update_result_t result = STATION_UPDATE_FAILED;
+    frame_store_entry_t latest;
+    char etag[16];
+
+    esp_http_client_config_t config = {
+        .url        = STATION_URL,
+        .timeout_ms = STATION_HTTP_TIMEOUT_MS,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL)
+    {
+        return STATION_UPDATE_FAILED;
+    }
+
+    if (frame_store_latest(&latest))
+    {
+        snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long) latest.crc32);
+        esp_http_client_set_header(client, "If-None-Match", etag);
+    }
+
+    metrics_begin(METRIC_PULL);
+    if (esp_http_client_open(client, 0) != ESP_OK)
+    {
+        esp_http_client_cleanup(client);
+        return STATION_UPDATE_FAILED;
+    }
+
+    int64_t content_len = esp_http_client_fetch_headers(client);
+    int     status      = esp_http_client_get_status_code(client);
+
+    if (status == 304)
+    {
+        result = STATION_UPDATE_NOT_MODIFIED;
+    }
+    else if (status != 200)
+    {
+        ESP_LOGW(TAG, "%s answered %d", STATION_URL, status);
+    }
+    else if ((content_len >= (int64_t) FRAME_UPLOAD_HEADER_SIZE) && (content_len <= UINT32_MAX)
+             && station_read_exact(client, chunk, FRAME_UPLOAD_HEADER_SIZE)
+             && frame_upload_begin(chunk, content_len))
+    {
+        uint32_t remaining = content_len - FRAME_UPLOAD_HEADER_SIZE;
+        bool     ok        = true;
+
+        while (ok && (remaining > 0))
+        {
+            uint32_t len = MIN(remaining, sizeof(chunk));
+            ok = station_read_exact(client, chunk, len) && frame_upload_write(chunk, len);
+            remaining -= len;
+        }
+
+        if (frame_upload_end() && ok)
+        {
+            result = STATION_UPDATE_NEW_FRAME;
+        }
+    }
+
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+
+    if (result != STATION_UPDATE_FAILED)
+    {
+        metrics_end(METRIC_PULL);
+    }
+
+    return result;
+}
+
+station_update_result_t station_update_run(void)
+{
+    station_update_result_t result = STATION_UPDATE_FAILED;
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+
+    events = xEventGroupCreate();
+    netif  = esp_netif_create_default_wifi_sta();
+    if ((events == NULL) || (netif == NULL) || (esp_wifi_init(&cfg) != ESP_OK))
+    {
+        return STATION_UPDATE_FAILED;
+    }
+
+    // Without them the join would only end on its timeout
+    if ((esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &station_event_handler, NULL) != ESP_OK)
+        || (esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &station_event_handler, NULL) != ESP_OK))
+    {
+        esp_wifi_deinit();
+        return STATION_UPDATE_FAILED;
+    }
+
+    // The configuration is given at each wake up, no need to write it to NVS
+    esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    esp_wifi_set_mode(WIFI_MODE_STA);
+    if (esp_wifi_start() != ESP_OK)
+    {
+        esp_wifi_deinit();
+        return STATION_UPDATE_FAILED;
+    }
+    metrics_radio(true);
+    metrics_begin(METRIC_JOIN);
+
+    bool cached = cache.valid && (cache.uses < STATION_CACHE_USES);
+    bool joined = cached && station_join(true);
+    if (!joined)
+    {
+        // Access point moved or lease taken: scan and ask DHCP
+        ESP_LOGI(TAG, "Joining %s with a scan", STATION_SSID);
+        cache.valid = false;
+        if (cached)
+        {
+            station_leave();
+        }
+        joined = station_join(false);
+        if (joined)
+        {
+            station_save_cache();
+        }
+    }
+
+    if (joined)
+    {
+        metrics_end(METRIC_JOIN);
+        result = station_fetch();
+    }
+
+    // A failed check starts from scratch next time
+    if (result == STATION_UPDATE_FAILED)
+    {
+        cache.valid = false;
+    }
+    else
+    {
+        cache.uses++;
+    }
+
+    esp_wifi_disconnect();
+    esp_wifi_stop();
+    metrics_radio(false);
+
+    ESP_LOGI(TAG, "Check done: %s", (result == STATION_UPDATE_NEW_FRAME) ? "new frame"
+                                    : (result == STATION_UPDATE_NOT_MODIFIED) ? "not modified" : "failed");
+    return result;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Set to 1 to wake up on a timer and pull new frames from a local server, as a WiFi station
+#ifndef STATION_UPDATE_ENABLED
+#define STATION_UPDATE_ENABLED      0
+#endif
+
+#ifndef STATION_SSID
+#define STATION_SSID                "HomeNetwork"
+#endif
+#ifndef STATION_PASSWORD
+#define STATION_PASSWORD            ""
+#endif
+
+// Serves a frame as an upload body, see frame_upload.h, with the CRC32 of its planes as ETag
+#ifndef STATION_URL
+#define STATION_URL                 "http://192.168.1.10:8081/frame"
+#endif
+
+#define STATION_INTERVAL_S          3600U   // Between two checks
+#define STATION_JOIN_TIMEOUT_MS     5000U
+#define STATION_LEAVE_TIMEOUT_MS    1000U   // Wait for a join given up to report its disconnection
+#define STATION_HTTP_TIMEOUT_MS     5000U
+#define STATION_CACHE_USES          24U     // Checks on a cached lease before asking DHCP again
+
+typedef enum
+{
+    STATION_UPDATE_FAILED = 0,
+    STATION_UPDATE_NOT_MODIFIED,            // The server has the frame shown, 304
+    STATION_UPDATE_NEW_FRAME,               // A new frame is in the framebuffer
+} station_update_result_t;
+
+// Join the network and fetch the frame if it is not the newest stored one, radio off when done
+// Joins the access point of the last check on its channel, with its IP lease, without scan nor DHCP
+// The netif, event loop and NVS must be initialized, and the frame store for the conditional GET
+station_update_result_t station_update_run(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,74 @@
+#include <string.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#include "trace.h"
+
+#define TRACE_RING_MASK         (TRACE_RING_SIZE - 1)
+
+// Written by the tasks and ISRs of a core, the write index is the count of records ever written
+typedef struct
+{
+    uint32_t        head;
+    trace_record_t  records[TRACE_RING_SIZE];
+} trace_ring_t;
+
+static trace_ring_t rings[TRACE_CORES];
+
+// Write indexes when the dump started
+static uint32_t dump_heads[TRACE_CORES];
+
+void trace_record(trace_event_t event, uint32_t arg0, uint32_t arg1)
+{
+    uint8_t core       = xPortGetCoreID();
+    trace_ring_t* ring = &rings[core];
+
+    // Reserve a record, a task preempting this one, or moved to the other core, gets the next one
+    uint32_t index       = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    trace_record_t* rec  = &ring->records[index & TRACE_RING_MASK];
+
+    rec->timestamp_us   = (uint32_t) esp_timer_get_time();
+    rec->event          = event;
+    rec->core           = core;
+    rec->reserved       = 0;
+    rec->args[0]        = arg0;
+    rec->args[1]        = arg1;
+}
+
+uint32_t trace_chars(const char* str)
+{
+    uint32_t chars = 0;
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        chars <<= 8;
+        if (*str)
+        {
+            chars |= (uint8_t) *str++;
+        }
+    }
+
+    return chars;
+}
+
+void trace_dump_header(trace_dump_header_t* header)
+{
+    memcpy(header->magic, TRACE_MAGIC, sizeof(header->magic));
+    header->version = TRACE_VERSION;
+    header->cores   = TRACE_CORES;
+
+    for (uint8_t core = 0; core < TRACE_CORES; core++)
+    {
+        dump_heads[core]     = __atomic_load_n(&rings[core].head, __ATOMIC_RELAXED);
+        header->counts[core] = (dump_heads[core] < TRACE_RING_SIZE) ? dump_heads[core] : TRACE_RING_SIZE;
+    }
+}
+
+const trace_record_t* trace_get(uint8_t core, uint16_t i)
+{
+    // Events traced while dumping may overwrite the oldest records, the decoder sorts by time
+    uint32_t count = (dump_heads[core] < TRACE_RING_SIZE) ? dump_heads[core] : TRACE_RING_SIZE;
+
+    return &rings[core].records[(dump_heads[core] - count + i) & TRACE_RING_MASK];
+}
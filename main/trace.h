@@ -0,0 +1,90 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Set to 0 to compile TRACE() out
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED           1
+#endif
+
+// Records kept per core, a power of two
+#define TRACE_RING_SIZE         256U
+#define TRACE_CORES             2U
+
+#define TRACE_MAGIC             "PFTR"
+#define TRACE_VERSION           1U
+
+// How the decoder shows an argument
+typedef enum
+{
+    TRACE_ARG_NONE = 0,
+    TRACE_ARG_U32,
+    TRACE_ARG_HEX,
+    TRACE_ARG_CHARS,            // Up to 4 characters, first one in the high byte
+} trace_arg_t;
+
+// Events: id, name, first and second argument
+#define TRACE_EVENTS(X) \
+    X(TRACE_HTTP_GET,       "http_get",     TRACE_ARG_CHARS,    TRACE_ARG_CHARS)    /* URI characters 1-4 and 5-8 */ \
+    X(TRACE_UPLOAD_BEGIN,   "upload_begin", TRACE_ARG_U32,      TRACE_ARG_NONE)     /* Content length */ \
+    X(TRACE_UPLOAD_CHUNK,   "upload_chunk", TRACE_ARG_U32,      TRACE_ARG_U32)      /* Remaining, chunk length */ \
+    X(TRACE_UPLOAD_END,     "upload_end",   TRACE_ARG_U32,      TRACE_ARG_U32)      /* Content length, success */ \
+    X(TRACE_JPEG_BEGIN,     "jpeg_begin",   TRACE_ARG_U32,      TRACE_ARG_U32)      /* Content length, palette */ \
+    X(TRACE_JPEG_END,       "jpeg_end",     TRACE_ARG_U32,      TRACE_ARG_NONE)     /* Success */ \
+    X(TRACE_DNS_QUERY,      "dns_query",    TRACE_ARG_U32,      TRACE_ARG_U32)      /* Query type, rule index */ \
+    X(TRACE_PHASE_BEGIN,    "phase_begin",  TRACE_ARG_U32,      TRACE_ARG_NONE)     /* metrics_phase_t */ \
+    X(TRACE_PHASE_END,      "phase_end",    TRACE_ARG_U32,      TRACE_ARG_U32)      /* metrics_phase_t, duration in us */
+
+typedef enum
+{
+#define TRACE_EVENT_ID(id, name, arg0, arg1) id,
+    TRACE_EVENTS(TRACE_EVENT_ID)
+#undef TRACE_EVENT_ID
+    TRACE_EVENT_COUNT,
+} trace_event_t;
+
+// A traced event
+typedef struct __attribute__((__packed__))
+{
+    uint32_t    timestamp_us;   // esp_timer time, wraps after 71 minutes
+    uint16_t    event;          // trace_event_t
+    uint8_t     core;
+    uint8_t     reserved;
+    uint32_t    args[2];
+} trace_record_t;
+
+// Dump header, followed by the records of each core, oldest first
+typedef struct __attribute__((__packed__))
+{
+    uint8_t     magic[4];       // TRACE_MAGIC
+    uint8_t     version;        // TRACE_VERSION
+    uint8_t     cores;
+    uint16_t    counts[TRACE_CORES];
+} trace_dump_header_t;
+
+#if TRACE_ENABLED
+#define TRACE(event, arg0, arg1)    trace_record((event), (arg0), (arg1))
+#else
+#define TRACE(event, arg0, arg1)    do {} while (0)
+#endif
+
+// Append a record to the ring of the current core, lock-free and ISR safe
+void    trace_record(trace_event_t event, uint32_t arg0, uint32_t arg1);
+
+// Pack up to 4 characters in an argument
+uint32_t trace_chars(const char* str);
+
+// Start a dump, fill its header with the count of records of each core
+void    trace_dump_header(trace_dump_header_t* header);
+
+// Get the i-th oldest record of a core, i below its count in the last dump header
+const trace_record_t* trace_get(uint8_t core, uint16_t i);
+
+#ifdef __cplusplus
+}
+#endif
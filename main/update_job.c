@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "update_job.h"
+
+typedef struct
+{
+    uint32_t                        id;         // 0 when the slot is unused
+    int64_t                         start_us;
+    uint32_t                        times_ms[UPDATE_JOB_STATE_COUNT];   // From the start
+    uint8_t                         reached;    // Bit of each state reached
+    update_job_state_t              state;
+} update_job_t;
+
+static const char* const state_names[UPDATE_JOB_STATE_COUNT] = {
+    [UPDATE_JOB_RECEIVING]      = "receiving",
+    [UPDATE_JOB_RECEIVED]       = "received",
+    [UPDATE_JOB_VALIDATED]      = "validated",
+    [UPDATE_JOB_STORED]         = "stored",
+    [UPDATE_JOB_TRANSFERRED]    = "transferred",
+    [UPDATE_JOB_REFRESHED]      = "refreshed",
+    [UPDATE_JOB_FAILED]         = "failed",
+};
+
+// Written by the web server and the main loop, read by the web server, under the lock
+// A slot is reused after UPDATE_JOB_HISTORY jobs
+static update_job_t         jobs[UPDATE_JOB_HISTORY];
+static uint32_t             last_id     = 0;    // 0 if none
+static portMUX_TYPE         jobs_lock   = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t         listener    = NULL;
+
+static inline bool update_job_final(update_job_state_t state)
+{
+    return (state == UPDATE_JOB_REFRESHED) || (state == UPDATE_JOB_FAILED);
+}
+
+// Call with the lock held
+static update_job_t* update_job_find(uint32_t id)
+{
+    update_job_t* job = &jobs[id % UPDATE_JOB_HISTORY];
+    return ((id != 0) && (job->id == id)) ? job : NULL;
+}
+
+// Copy a job out of the table, false if it is unknown or too old
+static bool update_job_get(uint32_t id, update_job_t* copy)
+{
+    taskENTER_CRITICAL(&jobs_lock);
+    update_job_t* job = update_job_find(id);
+    if (job != NULL)
+    {
+        *copy = *job;
+    }
+    taskEXIT_CRITICAL(&jobs_lock);
+
+    return (job != NULL);
+}
+
+uint32_t update_job_create(void)
+{
+    int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&jobs_lock);
+    uint32_t id = ++last_id;
+    update_job_t* job = &jobs[id % UPDATE_JOB_HISTORY];
+
+    memset(job, 0, sizeof(*job));
+    job->start_us = now;
+    job->id       = id;
+    taskEXIT_CRITICAL(&jobs_lock);
+
+    return id;
+}
+
+void update_job_advance(uint32_t id, update_job_state_t state)
+{
+    int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&jobs_lock);
+    update_job_t* job = update_job_find(id);
+
+    if ((job != NULL) && !update_job_final(job->state))
+    {
+        job->times_ms[state] = (now - job->start_us) / 1000;
+        job->reached        |= 1U << state;
+        job->state           = state;
+    }
+    TaskHandle_t task = listener;
+    taskEXIT_CRITICAL(&jobs_lock);
+
+    if (task != NULL)
+    {
+        xTaskNotifyGive(task);
+    }
+}
+
+void update_job_set_listener(TaskHandle_t task)
+{
+    taskENTER_CRITICAL(&jobs_lock);
+    listener = task;
+    taskEXIT_CRITICAL(&jobs_lock);
+}
+
+update_job_state_t update_job_state_from_name(const char* name)
+{
+    for (uint8_t i = 0; i < UPDATE_JOB_STATE_COUNT; i++)
+    {
+        if (strcmp(name, state_names[i]) == 0)
+        {
+            return i;
+        }
+    }
+
+    return UPDATE_JOB_STATE_COUNT;
+}
+
+bool update_job_get_state(uint32_t id, update_job_state_t* state)
+{
+    update_job_t job;
+
+    if (!update_job_get(id, &job))
+    {
+        return false;
+    }
+
+    *state = job.state;
+    return true;
+}
+
+size_t update_job_format(uint32_t id, char* buff, size_t len)
+{
+    update_job_t job;
+    size_t pos;
+
+    // Formatted from a copy, the main loop may advance it meanwhile
+    if (!update_job_get(id, &job))
+    {
+        return 0;
+    }
+
+    update_job_state_t state = job.state;
+    pos = snprintf(buff, len, "{\"id\":%lu,\"state\":\"%s\",\"final\":%s,\"ms\":{",
+                   (unsigned long) id, state_names[state], update_job_final(state) ? "true" : "false");
+
+    // States reached, in order
+    bool first = true;
+    for (uint8_t i = UPDATE_JOB_RECEIVED; (i < UPDATE_JOB_STATE_COUNT) && (pos < len); i++)
+    {
+        if (job.reached & (1U << i))
+        {
+            pos += snprintf(buff + pos, len - pos, "%s\"%s\":%lu", first ? "" : ",", state_names[i],
+                            (unsigned long) job.times_ms[i]);
+            first = false;
+        }
+    }
+
+    if (pos < len)
+    {
+        pos += snprintf(buff + pos, len - pos, "}}");
+    }
+
+    return (pos < len) ? pos : len - 1;
+}
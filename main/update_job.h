@@ -0,0 +1,53 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define UPDATE_JOB_HISTORY          4U          // Jobs kept for their status
+#define UPDATE_JOB_POLL_MS          5000U       // Longest wait of a status request, held by the task polling jobs
+
+// States of an update, in order. A job may skip some, STORED when the frame could not be saved
+typedef enum
+{
+    UPDATE_JOB_RECEIVING = 0,   // Upload started
+    UPDATE_JOB_RECEIVED,        // Whole upload received
+    UPDATE_JOB_VALIDATED,       // Decoded into the framebuffer, CRC checked
+    UPDATE_JOB_STORED,          // Saved to the frame store
+    UPDATE_JOB_TRANSFERRED,     // Sent to the display
+    UPDATE_JOB_REFRESHED,       // Shown, final
+    UPDATE_JOB_FAILED,          // Final
+    UPDATE_JOB_STATE_COUNT,
+} update_job_state_t;
+
+// Start a job for an upload
+// Return its ID, IDs start at 1
+uint32_t    update_job_create(void);
+
+// Move a job to a state, nothing if it is unknown, too old or ended. Job 0 is none
+void        update_job_advance(uint32_t id, update_job_state_t state);
+
+// Get a state from its name, UPDATE_JOB_STATE_COUNT if unknown
+update_job_state_t update_job_state_from_name(const char* name);
+
+// Notify a task with xTaskNotifyGive each time a job advances, NULL for none
+void        update_job_set_listener(TaskHandle_t task);
+
+// Get the state of a job
+// Return false if the job is unknown or too old
+bool        update_job_get_state(uint32_t id, update_job_state_t* state);
+
+// Write the status of a job as JSON, its state and the time to reach each state so far
+// Return the length written, 0 if the job is unknown or too old
+size_t      update_job_format(uint32_t id, char* buff, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
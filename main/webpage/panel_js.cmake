@@ -0,0 +1,20 @@
+# Generate panel.js from a panel descriptor, its PANEL_ defines with a decimal or string value become @PANEL_...@
+# cmake -DDESCRIPTOR=panels/<panel>.h -DTEMPLATE=panel.js.in -DOUTPUT=panel.js -P panel_js.cmake
+
+file(STRINGS "${DESCRIPTOR}" defines REGEX "^#define[ \t]+PANEL_")
+
+foreach(line IN LISTS defines)
+    if(line MATCHES "^#define[ \t]+(PANEL_[A-Z0-9_]+)[ \t]+([0-9]+)U?([ \t]|$)")
+        set(${CMAKE_MATCH_1} "${CMAKE_MATCH_2}")
+    elseif(line MATCHES "^#define[ \t]+(PANEL_[A-Z0-9_]+)[ \t]+\"([^\"]*)\"")
+        set(${CMAKE_MATCH_1} "${CMAKE_MATCH_2}")
+    endif()
+endforeach()
+
+foreach(name PANEL_WIDTH PANEL_HEIGHT)
+    if(NOT DEFINED ${name})
+        message(FATAL_ERROR "${DESCRIPTOR} has no ${name}")
+    endif()
+endforeach()
+
+configure_file("${TEMPLATE}" "${OUTPUT}" @ONLY)
@@ -1,18 +1,166 @@
-const dest_height = 480;
-const dest_width  = 800;
-const ratio       = dest_width / dest_height;
+// dest_width and dest_height come from panel.js
 
 const canvas = document.querySelector("#img_result");
 const canvas_context = canvas.getContext("2d", {willReadFrequently: true});
 
 const img_preview     = document.querySelector("#img_original");
 const data_upload_msg = document.querySelector("#data_upload_msg");
+const dither_msg      = document.querySelector("#dither_msg");
 
-// The output array is divided in two parts: first half for black/white and second half for red/none
-// Bits set to 1 means white/red, bits to 0 are for black/none
-var output_array    = new Uint8ClampedArray((dest_height*dest_width)/4);
+// The output array holds palette indexes, MSB first: 2 bits per pixel in color, 1 bit in black & white
+// Index bit 0 set means white, bit 1 set means red. The device splits them into its planes
+var output_array    = new Uint8Array((dest_height*dest_width)/4);
 const half_of_array = (dest_height*dest_width)/8;
 
+// Palette indexes
+const index_black = 0x0;
+const index_white = 0x1;
+const index_red   = 0x2;
+
+// Palette colors as RGB, in index order
+const palette = new Int16Array([
+    0,   0,   0,        // Black
+    255, 255, 255,      // White
+    255, 0,   0,        // Red
+]);
+
+// Upload header, see frame_upload.h
+const upload_header_size   = 16;
+const upload_version       = 1;
+const upload_encoding_planar = 0;
+const upload_encoding_packed = 1;
+const upload_plane_bw      = 0x1;
+const upload_plane_red     = 0x2;
+const upload_rotation_0    = 0;
+const upload_rotation_90   = 1;
+
+// CRC32 (IEEE) lookup table
+const crc32_table = new Uint32Array(256);
+for (let n = 0; n < 256; n++) {
+    let c = n;
+    for (let k = 0; k < 8; k++) {
+        c = (c & 1) ? (0xEDB88320 ^ (c >>> 1)) : (c >>> 1);
+    }
+    crc32_table[n] = c >>> 0;
+}
+
+function crc32(data) {
+    let crc = 0xFFFFFFFF;
+    for (let i = 0; i < data.length; i++) {
+        crc = crc32_table[(crc ^ data[i]) & 0xFF] ^ (crc >>> 8);
+    }
+    return (crc ^ 0xFFFFFFFF) >>> 0;
+}
+
+// Build the upload: header followed by the pixels
+// Color frames are sent packed, black & white ones as their only plane
+// Portrait frames are turned by the device
+function buildUpload(frame, color, rotation) {
+    const portrait = (rotation == upload_rotation_90);
+
+    const planes = upload_plane_bw | (color ? upload_plane_red : 0);
+    const payload = color ? frame : frame.subarray(0, half_of_array);
+
+    const upload = new Uint8Array(upload_header_size + payload.length);
+    const header = new DataView(upload.buffer);
+
+    header.setUint8(0, "P".charCodeAt(0));
+    header.setUint8(1, "F".charCodeAt(0));
+    header.setUint8(2, upload_version);
+    header.setUint8(3, color ? upload_encoding_packed : upload_encoding_planar);
+    header.setUint16(4, portrait ? dest_height : dest_width, true);
+    header.setUint16(6, portrait ? dest_width : dest_height, true);
+    header.setUint8(8, planes);
+    header.setUint8(9, rotation);
+    header.setUint32(12, crc32(payload), true);
+
+    upload.set(payload, upload_header_size);
+
+    return upload;
+}
+
+// Quantize the RGBA pixels to the nearest palette color and diffuse the error with Floyd-Steinberg
+// The pixels are replaced by their palette color, the indexes go to output, packed MSB first
+function ditherFrame(pixels, width, height, color, output) {
+    const colors = color ? 3 : 2;
+    const bits_per_pixel = color ? 2 : 1;
+    const packed = new DataView(output.buffer, output.byteOffset);
+
+    // Error of the current and next lines, 3 channels, with a pixel of margin on each side
+    const line_size = (width + 2) * 3;
+    let error_line = new Int16Array(line_size);
+    let error_next = new Int16Array(line_size);
+
+    let word = 0;
+    let word_bits = 0;
+    let offset = 0;
+
+    for (let y = 0, i = 0; y < height; y++) {
+        for (let x = 0, e = 3; x < width; x++, i += 4, e += 3) {
+            // Summed errors are clamped once: red has no green nor blue, so the green and blue
+            // error of red pixels would keep adding up without bound
+            let r = pixels[i]     + error_line[e];
+            let g = pixels[i + 1] + error_line[e + 1];
+            let b = pixels[i + 2] + error_line[e + 2];
+            r = (r < 0) ? 0 : ((r > 255) ? 255 : r);
+            g = (g < 0) ? 0 : ((g > 255) ? 255 : g);
+            b = (b < 0) ? 0 : ((b > 255) ? 255 : b);
+
+            // Nearest color by squared distance
+            let index = 0;
+            let best = 0x7FFFFFFF;
+            for (let c = 0, p = 0; c < colors; c++, p += 3) {
+                const dr = r - palette[p];
+                const dg = g - palette[p + 1];
+                const db = b - palette[p + 2];
+                const distance = dr*dr + dg*dg + db*db;
+                if (distance < best) {
+                    best = distance;
+                    index = c;
+                }
+            }
+
+            const p = index * 3;
+            pixels[i]     = palette[p];
+            pixels[i + 1] = palette[p + 1];
+            pixels[i + 2] = palette[p + 2];
+            pixels[i + 3] = 255;
+
+            // Store the palette index, 32 bits at a time
+            // Frame sides are multiples of 8 pixels, see display_config.h, the last word is full
+            word = (word << bits_per_pixel) | index;
+            word_bits += bits_per_pixel;
+            if (word_bits == 32) {
+                packed.setUint32(offset, word);
+                offset += 4;
+                word = 0;
+                word_bits = 0;
+            }
+
+            // Floyd-Steinberg, the margins take the errors out of the frame
+            const error_r = r - palette[p];
+            const error_g = g - palette[p + 1];
+            const error_b = b - palette[p + 2];
+
+            error_line[e + 3] += (error_r * 7) >> 4;
+            error_line[e + 4] += (error_g * 7) >> 4;
+            error_line[e + 5] += (error_b * 7) >> 4;
+            error_next[e - 3] += (error_r * 3) >> 4;
+            error_next[e - 2] += (error_g * 3) >> 4;
+            error_next[e - 1] += (error_b * 3) >> 4;
+            error_next[e]     += (error_r * 5) >> 4;
+            error_next[e + 1] += (error_g * 5) >> 4;
+            error_next[e + 2] += (error_b * 5) >> 4;
+            error_next[e + 3] += error_r >> 4;
+            error_next[e + 4] += error_g >> 4;
+            error_next[e + 5] += error_b >> 4;
+        }
+
+        [error_line, error_next] = [error_next, error_line];
+        error_next.fill(0);
+    }
+}
+
 function handleFileSelect(evt) {
     var file = document.querySelector("#img_upload").files[0];
     var reader = new FileReader();
@@ -34,35 +182,25 @@ function handleFileSelect(evt) {
                 // Show the original image preview
                 img_preview.src = canvas.toDataURL();
 
-                let dx = 0;
-                let dy = 0;
-
-                // Portrait image, to be rotated around its center
-                if (img.width < img.height)
-                {
-                    canvas.height = img.width;
-                    canvas.width = img.height;
-                    canvas_context.translate(canvas.width/2, canvas.height/2);
-                    canvas_context.rotate(Math.PI/2);
-                    dx = -img.width/2;
-                    dy = -img.height/2;
-                }
-
-                // Draw image to canvas
-                canvas_context.drawImage(img, dx, dy);
+                // Portrait image, kept as is and rotated by the device
+                const portrait = (img.width < img.height);
+                const rotation = portrait ? upload_rotation_90 : upload_rotation_0;
+                const frame_width = portrait ? dest_height : dest_width;
+                const frame_height = portrait ? dest_width : dest_height;
+                const frame_ratio = frame_width / frame_height;
 
                 // Crop in the x axis
                 let clip_width = canvas.width;
                 let clip_height = canvas.height;
 
-                if (canvas.width > (canvas.height * ratio))
+                if (canvas.width > (canvas.height * frame_ratio))
                 {
-                    clip_width = canvas.height * ratio;
+                    clip_width = canvas.height * frame_ratio;
                 }
                 // Crop on the y axis
                 else
                 {
-                    clip_height = 1/ratio * canvas.width;
+                    clip_height = 1/frame_ratio * canvas.width;
                 }
 
                 let clip_x = (canvas.width - clip_width) / 2;
@@ -81,112 +219,23 @@ function handleFileSelect(evt) {
 
                 // Now scale image to target sizes
                 canvas_context.resetTransform();
-                canvas.height = dest_height;
-                canvas.width = dest_width;
+                canvas.height = frame_height;
+                canvas.width = frame_width;
                 
-                canvas_context.scale(dest_width/clip_width, dest_height/clip_height);
+                canvas_context.scale(frame_width/clip_width, frame_height/clip_height);
                 canvas_context.drawImage(tmp_canvas, 0, 0);
                 
                 // Quantize image to black-white-red
                 
                 // Get raw pixels
-                resulting_img = canvas_context.getImageData(0, 0, dest_width, dest_height);
-                const pixels = resulting_img.data;
-
-                // Reset array
-                output_array.fill(0);
-
-                let output_array_idx = 0;
-                let output_array_sub = 0;
-
-                // Each pixel is RGBA
-                for (let y = 0; y < dest_height; y++) {
-                    for (let x = 0; x < dest_width; x++) {
-                        // Get the pixel index
-                        let i = y*dest_width*4 + x*4;
-
-                        pixels[i+3] = 255; // Set alpha to max
-
-                        // Compute colors ratio
-                        const gb = Math.sqrt(Math.pow(pixels[i + 1], 2) + Math.pow(pixels[i + 2],2));
-                        const rgb = Math.sqrt(Math.pow(pixels[i], 2) + Math.pow(pixels[i + 1], 2) + Math.pow(pixels[i + 2],2));
-
-                        // Reduce channels to black and white, from grayscale
-                        let newpixel_gb = (gb > 128) ? 255 : 0;
-                        let newpixel_r  = (rgb > 128) ? 255 : 0;
-
-                        // Full color palette
-                        if (document.querySelector('input[name="color"]:checked').value == "1")
-                        {
-                            // If red is major, set it full blast and no black channel
-                            if ((pixels[i] >= 128) && (gb < 128))
-                            {
-                                newpixel_r  = 255;
-                                newpixel_gb = 0;
-                                // Store the nibbles
-                                output_array[output_array_idx + half_of_array] |= 0x1 << (7 - output_array_sub);
-                            }
-                            else
-                            {
-                                output_array[output_array_idx] |= (newpixel_gb & 0x1) << (7 - output_array_sub);
-                            }
-                        }
-                        // Black & white
-                        else
-                        {
-                            newpixel_gb = newpixel_r;
-                            output_array[output_array_idx] |= (newpixel_gb & 0x1) << (7 - output_array_sub);
-                        }
-
-                        // Increment sub-iterator and iterator
-                        output_array_sub = (output_array_sub+1) % 8;
-                        output_array_idx = (output_array_sub == 0) ? (output_array_idx+1) : output_array_idx;
-
-                        // Set pixels
-                        pixels[i] = newpixel_r;
-                        pixels[i + 1] = newpixel_gb;
-                        pixels[i + 2] = newpixel_gb;
-
-
-                        // Compute quantization errors
-                        error_gb = gb - newpixel_gb;
-                        error_r = Math.sqrt(Math.pow(pixels[i]) - Math.pow(newpixel_r));
-
-                        // Floyd-Steinberg dithering
-                        if ((x+1) < dest_width)
-                        {         
-                            let right = y*dest_width*4 + (x+1)*4;
-                            pixels[right] += (error_r * 7) >> 4;
-                            pixels[right + 1] += (error_gb * 7) >> 4;
-                            pixels[right + 2] += (error_gb * 7) >> 4;
-                        }
-                        
-                        if ((y+1) != dest_height)
-                        {
-                            if (x > 0)
-                            {
-                                let bottomleft = (y+1)*dest_width*4 + (x-1)*4;
-                                pixels[bottomleft] += (error_r *  3) >> 4;
-                                pixels[bottomleft + 1] += (error_gb * 3) >> 4;
-                                pixels[bottomleft + 2] += (error_gb * 3) >> 4;
-                            }
-                            
-                            let bottom = (y+1)*dest_width*4 + x*4;
-                            pixels[bottom] += (error_r * 5) >> 4;
-                            pixels[bottom + 1] += (error_gb * 5) >> 4;
-                            pixels[bottom + 2] += (error_gb * 5) >> 4;
-                            
-                            if ((x+1) < (dest_width-1))
-                            {
-                                let bottomright = (y+1)*dest_width*4 + (x+1)*4;
-                                pixels[bottomright] += error_r >> 4;
-                                pixels[bottomright + 1] += error_gb >> 4;
-                                pixels[bottomright + 2] += error_gb >> 4;
-                            }
-                        }
-                    }
-                }
-                
+                resulting_img = canvas_context.getImageData(0, 0, frame_width, frame_height);
+
+                const color_mode = (document.querySelector('input[name="color"]:checked').value == "1");
+
+                const start = performance.now();
+                ditherFrame(resulting_img.data, frame_width, frame_height, color_mode, output_array);
+                dither_msg.innerHTML = "DITHERED IN " + Math.round(performance.now() - start) + " MS";
+
                 // Clear canvas and set its contents to the quantized pixels
                 canvas_context.clearRect(0, 0, canvas.width, canvas.height);
                 canvas_context.putImageData(resulting_img, 0, 0);
@@ -196,10 +245,16 @@ function handleFileSelect(evt) {
                 req.open("POST", "/upload", true);
 
                 req.onload = (event) => {
+                    if (req.status != 200) {
+                        data_upload_msg.innerHTML = "UPLOAD FAILED";
+                        return;
+                    }
+
                     data_upload_msg.innerHTML = "UPLOAD SUCCEEDED";
+                    followJob(JSON.parse(req.responseText).job, "validated");
                 };
 
-                req.send(output_array);
+                req.send(buildUpload(output_array, color_mode, rotation));
             };
 
             img.src = reader.result;
@@ -210,4 +265,58 @@ function handleFileSelect(evt) {
     }
 }
     
+// Follow an update job until its frame is shown, each request returns when it moves on
+function followJob(id, state) {
+    const req = new XMLHttpRequest();
+    req.open("GET", "/jobs/" + id + "?after=" + state, true);
+    req.responseType = "json";
+
+    req.onload = (event) => {
+        if (req.status != 200) {
+            data_upload_msg.innerHTML = "UPDATE FAILED";
+            return;
+        }
+
+        const job = req.response;
+        if (job.state == "refreshed") {
+            data_upload_msg.innerHTML = "FRAME SHOWN IN " + (job.ms.refreshed / 1000).toFixed(1) + " S";
+            loadGallery();
+        }
+        else if (job.state == "failed") {
+            data_upload_msg.innerHTML = "UPDATE FAILED";
+        }
+        else {
+            data_upload_msg.innerHTML = "FRAME " + job.state.toUpperCase();
+            followJob(id, job.state);
+        }
+    };
+
+    req.send();
+}
+
+// Show the thumbnails of the stored frames
+function loadGallery() {
+    const gallery = document.getElementById("div_gallery");
+    const req = new XMLHttpRequest();
+    req.open("GET", "/frames", true);
+    req.responseType = "json";
+
+    req.onload = (event) => {
+        if (req.status != 200) {
+            return;
+        }
+
+        gallery.replaceChildren();
+        for (const frame of req.response) {
+            const img = document.createElement("img");
+            img.className = "border";
+            img.src = "/frames/" + frame.id + "/thumb";
+            gallery.appendChild(img);
+        }
+    };
+
+    req.send();
+}
+
 document.getElementById("img_upload").addEventListener("change", handleFileSelect, false);
+loadGallery();